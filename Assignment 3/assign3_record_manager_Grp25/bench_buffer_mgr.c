@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+/* microbenchmark for buffer pool page lookups */
+
+#define BENCH_FILE "bench_buffer_pagefile.bin"
+#define BENCH_PINS 2000000 // pin/unpin pairs per pool size
+#define BENCH_FILE_PAGES 4096 // file size of the miss workload
+#define BENCH_MISSES 200000   // pins of the miss workload
+#define BENCH_TRACE "bench_buffer_trace.txt"
+#define BENCH_TRACE_PINS 400000 // pins of the generated trace
+#define BENCH_TRACE_FRAMES 128  // pool size the traces are replayed with
+#define BENCH_SCALE_FRAMES 4096  // pool and file size of the multi-threaded lookup workload
+#define BENCH_SCALE_PINS 1000000 // pin/unpin pairs per thread
+#define BENCH_SCAN_AHEAD 8        // pages the prefetching scan reads ahead, as a record manager scan does
+
+// wall clock in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *path, int frames, int pins, double seconds)
+{
+    printf("%-9s %6d frames %8d pins %8.3f s %8.1f ns/pin %12.0f pages/s\n", path, frames, pins, seconds,
+           seconds * 1e9 / pins, pins / seconds);
+}
+
+// the previous lookup: scan the frames for the page number
+static int linearFindPage(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    PageFrame *frames = ((BM_MGMT_DATA *)bm->mgmtData)->frames;
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (frames[i].pageNum == pageNum)
+            return i;
+    }
+    return -1;
+}
+
+// pin and unpin random resident pages of a pool that holds the whole file
+static void runHits(int numFrames)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    unsigned *pages = (unsigned *)malloc(sizeof(unsigned) * BENCH_PINS);
+    long sum = 0;
+    int i;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(numFrames, &fh));
+    CHECK(closePageFile(&fh));
+
+    CHECK(initBufferPool(&bm, BENCH_FILE, numFrames, RS_FIFO, NULL));
+    for (i = 0; i < numFrames; i++)
+    {
+        CHECK(pinPage(&bm, &h, i));
+        CHECK(unpinPage(&bm, &h));
+    }
+
+    srand(42);
+    for (i = 0; i < BENCH_PINS; i++)
+        pages[i] = rand() % numFrames;
+
+    double start = now();
+    for (i = 0; i < BENCH_PINS; i++)
+    {
+        CHECK(pinPage(&bm, &h, pages[i]));
+        CHECK(unpinPage(&bm, &h));
+    }
+    report("table", numFrames, BENCH_PINS, now() - start);
+
+    // only the frame lookups that pinPage and unpinPage each did before; fewer of them on large pools
+    int linearPins = numFrames > 1024 ? BENCH_PINS / (numFrames / 1024) : BENCH_PINS;
+    start = now();
+    for (i = 0; i < linearPins; i++)
+    {
+        sum += linearFindPage(&bm, pages[i]);
+        sum += linearFindPage(&bm, pages[i]);
+    }
+    report("linear", numFrames, linearPins, now() - start);
+
+    if (getNumReadIO(&bm) != numFrames || sum == 42)
+        printf("unexpected reads\n");
+    CHECK(shutdownBufferPool(&bm));
+    CHECK(destroyPageFile(BENCH_FILE));
+    free(pages);
+}
+
+// pin random pages of a file much larger than the pool, so that nearly every pin evicts a page
+static void runMisses(ReplacementStrategy strategy, const char *path, int numFrames)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    int i;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(BENCH_FILE_PAGES, &fh));
+    CHECK(closePageFile(&fh));
+
+    CHECK(initBufferPool(&bm, BENCH_FILE, numFrames, strategy, NULL));
+    srand(42);
+    double start = now();
+    for (i = 0; i < BENCH_MISSES; i++)
+    {
+        CHECK(pinPage(&bm, &h, rand() % BENCH_FILE_PAGES));
+        if (i % 4 == 0)
+            CHECK(markDirty(&bm, &h));
+        CHECK(unpinPage(&bm, &h));
+    }
+    report(path, numFrames, BENCH_MISSES, now() - start);
+    CHECK(shutdownBufferPool(&bm));
+    CHECK(destroyPageFile(BENCH_FILE));
+}
+
+// the miss workload with every pin dirtying its page, with and without the background writer; reports how many
+// victims the pins had to write back themselves
+static void runWriterMisses(const char *path, int numFrames, bool writer)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    int i;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(BENCH_FILE_PAGES, &fh));
+    CHECK(closePageFile(&fh));
+
+    CHECK(initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL));
+    if (writer)
+        CHECK(startBackgroundWriter(&bm, NULL));
+    srand(42);
+    double start = now();
+    for (i = 0; i < BENCH_MISSES; i++)
+    {
+        CHECK(pinPage(&bm, &h, rand() % BENCH_FILE_PAGES));
+        CHECK(markDirty(&bm, &h));
+        CHECK(unpinPage(&bm, &h));
+    }
+    report(path, numFrames, BENCH_MISSES, now() - start);
+    printf("%-9s %d victims written back by pins, %d pages in %d batches by the writer\n", path,
+           getNumEvictionWrites(&bm), getNumWriterPages(&bm), getNumWriterBatches(&bm));
+    CHECK(shutdownBufferPool(&bm));
+    CHECK(destroyPageFile(BENCH_FILE));
+}
+
+// dirty half of the pages of a pool that holds the whole file, in random order, and write them back: with
+// forceFlushPool (page order, runs coalesced, one sync) or with forcePage per page in frame order and one sync
+static void runFlush(const char *path, bool pool)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    int numFrames = BENCH_FILE_PAGES, round, i;
+    double seconds = 0;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(BENCH_FILE_PAGES, &fh));
+
+    CHECK(initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL));
+    srand(42);
+    for (i = 0; i < BENCH_FILE_PAGES; i++)
+    {
+        CHECK(pinPage(&bm, &h, (i * 2654435761u) % BENCH_FILE_PAGES));
+        CHECK(unpinPage(&bm, &h));
+    }
+    for (round = 0; round < 8; round++)
+    {
+        for (i = 0; i < BENCH_FILE_PAGES / 2; i++)
+        {
+            CHECK(pinPage(&bm, &h, rand() % BENCH_FILE_PAGES));
+            CHECK(markDirty(&bm, &h));
+            CHECK(unpinPage(&bm, &h));
+        }
+        double start = now();
+        if (pool)
+        {
+            CHECK(forceFlushPool(&bm));
+        }
+        else
+        {
+            PageNumber *contents = getFrameContents(&bm);
+            bool *dirty = getDirtyFlags(&bm);
+            for (i = 0; i < numFrames; i++)
+            {
+                if (!dirty[i])
+                    continue;
+                CHECK(pinPage(&bm, &h, contents[i]));
+                CHECK(forcePage(&bm, &h));
+                CHECK(unpinPage(&bm, &h));
+            }
+            CHECK(syncPageFile(&fh));
+            free(contents);
+            free(dirty);
+        }
+        seconds += now() - start;
+    }
+    printf("%-9s %6d frames %8d writes %8.3f s %8.1f us/page\n", path, numFrames, getNumWriteIO(&bm), seconds,
+           seconds * 1e6 / getNumWriteIO(&bm));
+    CHECK(shutdownBufferPool(&bm));
+    CHECK(closePageFile(&fh));
+    CHECK(destroyPageFile(BENCH_FILE));
+}
+
+// cold sequential scans over the whole file, each page summed once pinned, with and without prefetchPages
+// reading ahead of the scan. The file is written out and dropped from the page cache before every pass; through a
+// handle opened with openFlags SM_OPEN_DIRECT the kernel does not read ahead either, and every read waits for the disk
+static void runScan(const char *path, int numFrames, bool prefetch, int openFlags)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    PageNumber ahead[BENCH_SCAN_AHEAD];
+    char page[PAGE_SIZE];
+    long sum = 0;
+    int i, k, pass;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    for (i = 0; i < BENCH_FILE_PAGES; i++)
+    {
+        memset(page, i, PAGE_SIZE);
+        CHECK(writeBlock(i, &fh, page));
+    }
+    CHECK(syncPageFile(&fh));
+    CHECK(closePageFile(&fh));
+    int fd = open(BENCH_FILE, O_RDONLY);
+
+    CHECK(initBufferPoolWithFlags(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL, openFlags));
+    double start = now();
+    for (pass = 0; pass < 8; pass++)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        for (i = 0; i < BENCH_FILE_PAGES; i++)
+        {
+            if (prefetch)
+            {
+                for (k = 0; k < BENCH_SCAN_AHEAD && i + k + 1 < BENCH_FILE_PAGES; k++)
+                    ahead[k] = i + k + 1;
+                prefetchPages(&bm, ahead, k);
+            }
+            CHECK(pinPage(&bm, &h, i));
+            for (k = 0; k < PAGE_SIZE / (int)sizeof(int); k++)
+                sum += ((int *)h.data)[k];
+            CHECK(unpinPage(&bm, &h));
+        }
+    }
+    report(path, numFrames, 8 * BENCH_FILE_PAGES, now() - start);
+    printf("%-9s %d pages read by the prefetcher (sum %ld)\n", path, getNumPrefetchReads(&bm), sum);
+    CHECK(shutdownBufferPool(&bm));
+    close(fd);
+    CHECK(destroyPageFile(BENCH_FILE));
+}
+
+// index lookups on a small hot set mixed with a sequential scan over the rest of the file; reports the hit ratio.
+// The scan pins its pages with scanAccess
+static void runMixed(ReplacementStrategy strategy, const char *path, void *stratData, BM_AccessStrategy scanAccess)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    int hot = 32, numFrames = 64, scanPage = hot, i;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(BENCH_FILE_PAGES, &fh));
+    CHECK(closePageFile(&fh));
+
+    CHECK(initBufferPool(&bm, BENCH_FILE, numFrames, strategy, stratData));
+    srand(42);
+    double start = now();
+    for (i = 0; i < BENCH_MISSES; i++)
+    {
+        PageNumber pageNum;
+        BM_AccessStrategy access = BM_ACCESS_NORMAL;
+        if (rand() % 4 == 0)
+            pageNum = rand() % hot;
+        else
+        {
+            pageNum = scanPage;
+            scanPage = scanPage + 1 < BENCH_FILE_PAGES ? scanPage + 1 : hot;
+            access = scanAccess;
+        }
+        CHECK(pinPageWithAccess(&bm, &h, pageNum, access));
+        CHECK(unpinPage(&bm, &h));
+    }
+    double seconds = now() - start;
+    printf("%-9s %6d frames %8d pins %8.3f s %8.1f%% hits %12.0f pages/s\n", path, numFrames, BENCH_MISSES, seconds,
+           100.0 * (BENCH_MISSES - getNumReadIO(&bm)) / BENCH_MISSES, BENCH_MISSES / seconds);
+    CHECK(shutdownBufferPool(&bm));
+    CHECK(destroyPageFile(BENCH_FILE));
+}
+
+typedef struct ScaleWorker
+{
+    BM_BufferPool *bm;
+    unsigned seed;
+    int pins;
+} ScaleWorker;
+
+// pin and unpin uniformly random pages
+static void *scaleWorker(void *arg)
+{
+    ScaleWorker *w = (ScaleWorker *)arg;
+    BM_PageHandle h;
+
+    for (int i = 0; i < w->pins; i++)
+    {
+        CHECK(pinPage(w->bm, &h, rand_r(&w->seed) % BENCH_SCALE_FRAMES));
+        CHECK(unpinPage(w->bm, &h));
+    }
+    return NULL;
+}
+
+// uniform random lookups from numThreads threads on a pool of numFrames frames split into numPartitions sub-pools;
+// pins/s should grow with the threads as long as there are cores for them and partitions to spread them over.
+// A pool smaller than the file misses on most pins and measures the victim search under contention; it is given a
+// tenth of the pins
+static void runScaling(const char *name, ReplacementStrategy strategy, int numFrames, int numThreads, int numPartitions)
+{
+    int pins = numFrames > BENCH_SCALE_FRAMES ? BENCH_SCALE_PINS : BENCH_SCALE_PINS / 10;
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    SM_FileHandle fh;
+    pthread_t threads[64];
+    ScaleWorker workers[64];
+    char path[32];
+    int i;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(BENCH_SCALE_FRAMES, &fh));
+    CHECK(closePageFile(&fh));
+
+    CHECK(initBufferPoolPartitioned(&bm, BENCH_FILE, numFrames, strategy, NULL, SM_OPEN_DEFAULT, numPartitions));
+    for (i = 0; i < BENCH_SCALE_FRAMES && i < numFrames; i++)
+    {
+        CHECK(pinPage(&bm, &h, i));
+        CHECK(unpinPage(&bm, &h));
+    }
+
+    double start = now();
+    for (i = 0; i < numThreads; i++)
+    {
+        workers[i] = (ScaleWorker){&bm, 42 + i, pins};
+        pthread_create(&threads[i], NULL, scaleWorker, &workers[i]);
+    }
+    for (i = 0; i < numThreads; i++)
+        pthread_join(threads[i], NULL);
+    double seconds = now() - start;
+
+    snprintf(path, sizeof(path), "%s%dt/%dp", name, numThreads, numPartitions);
+    report(path, bm.numPages, numThreads * pins, seconds);
+    if (numFrames > BENCH_SCALE_FRAMES && getNumReadIO(&bm) != BENCH_SCALE_FRAMES)
+        printf("unexpected reads\n");
+    CHECK(shutdownBufferPool(&bm));
+    CHECK(destroyPageFile(BENCH_FILE));
+}
+
+// Write a trace of OLTP lookups, 80% of them on 64 hot pages and the rest on 256 warm ones, where every fourth
+// period of 20000 pins also runs a reporting scan over the rest of the file
+static void writeTrace(const char *path)
+{
+    FILE *trace = fopen(path, "w");
+    int scanPage = 256, i;
+
+    srand(7);
+    for (i = 0; i < BENCH_TRACE_PINS; i++)
+    {
+        PageNumber pageNum;
+        if ((i / 20000) % 4 == 3 && i % 4 != 0)
+        {
+            pageNum = scanPage;
+            scanPage = scanPage + 1 < BENCH_FILE_PAGES ? scanPage + 1 : 256;
+        }
+        else
+            pageNum = rand() % 5 != 0 ? rand() % 64 : rand() % 256;
+        fprintf(trace, "%d\n", pageNum);
+    }
+    fclose(trace);
+}
+
+// Replay a recorded trace, one page number per line, with every replacement strategy and report the hit ratios
+static void runTrace(const char *path)
+{
+    static const ReplacementStrategy strategies[] = {RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q, RS_CLOCK_SWEEP};
+    static const char *names[] = {"fifo", "lru", "clock", "lfu", "lru-k", "arc", "2q", "sweep"};
+    FILE *trace = fopen(path, "r");
+    PageNumber *pages = NULL, maxPage = 0;
+    int numPins = 0, capacity = 0, s, i;
+
+    if (trace == NULL)
+    {
+        printf("cannot open trace %s\n", path);
+        return;
+    }
+    for (PageNumber pageNum; fscanf(trace, "%d", &pageNum) == 1;)
+    {
+        if (numPins == capacity)
+        {
+            capacity = capacity > 0 ? 2 * capacity : 65536;
+            pages = (PageNumber *)realloc(pages, sizeof(PageNumber) * capacity);
+        }
+        pages[numPins++] = pageNum;
+        maxPage = pageNum > maxPage ? pageNum : maxPage;
+    }
+    fclose(trace);
+
+    SM_FileHandle fh;
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(maxPage + 1, &fh));
+    CHECK(closePageFile(&fh));
+
+    printf("trace %s: %d pins over %d pages\n", path, numPins, maxPage + 1);
+    for (s = 0; s < (int)(sizeof(strategies) / sizeof(strategies[0])); s++)
+    {
+        BM_BufferPool bm;
+        BM_PageHandle h;
+
+        CHECK(initBufferPool(&bm, BENCH_FILE, BENCH_TRACE_FRAMES, strategies[s], NULL));
+        double start = now();
+        for (i = 0; i < numPins; i++)
+        {
+            CHECK(pinPage(&bm, &h, pages[i]));
+            CHECK(unpinPage(&bm, &h));
+        }
+        double seconds = now() - start;
+        printf("%-9s %6d frames %8d pins %8.3f s %8.1f%% hits %12.0f pages/s\n", names[s], BENCH_TRACE_FRAMES, numPins,
+               seconds, 100.0 * (numPins - getNumReadIO(&bm)) / numPins, numPins / seconds);
+        CHECK(shutdownBufferPool(&bm));
+    }
+    CHECK(destroyPageFile(BENCH_FILE));
+    free(pages);
+}
+
+int main(int argc, char **argv)
+{
+    initStorageManager();
+
+    // with arguments, only replay the given traces
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+            runTrace(argv[i]);
+        return 0;
+    }
+
+    runMisses(RS_FIFO, "miss-fifo", 64);
+    runMisses(RS_CLOCK, "miss-clock", 64);
+    runMisses(RS_CLOCK_SWEEP, "miss-sweep", 64);
+    runMisses(RS_LRU_K, "miss-lru-k", 64);
+    runMisses(RS_LFU, "miss-lfu", 64);
+    runMisses(RS_LFU, "miss-lfu", 2048);
+    runWriterMisses("dirty", 256, false);
+    runWriterMisses("dirty+bgw", 256, true);
+    runFlush("flush-pg", false);
+    runFlush("flush", true);
+    runScan("scan", 64, false, SM_OPEN_DEFAULT);
+    runScan("scan+pf", 64, true, SM_OPEN_DEFAULT);
+    runScan("dscan", 64, false, SM_OPEN_DIRECT);
+    runScan("dscan+pf", 64, true, SM_OPEN_DIRECT);
+    runMixed(RS_LRU, "mix-lru", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_CLOCK, "mix-clock", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_CLOCK_SWEEP, "mix-sweep", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_LRU_K, "mix-lru-k", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_ARC, "mix-arc", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_2Q, "mix-2q", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_LFU, "mix-lfu", NULL, BM_ACCESS_NORMAL);
+    runMixed(RS_LRU, "ring-lru", NULL, BM_ACCESS_BULKREAD);
+    runMixed(RS_CLOCK, "ring-clock", NULL, BM_ACCESS_BULKREAD);
+    runMixed(RS_ARC, "ring-arc", NULL, BM_ACCESS_BULKREAD);
+
+    runHits(16);
+    runHits(256);
+    runHits(4096);
+    runHits(32768);
+
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        // a few more frames than pages, so that an uneven hash still keeps every page resident
+        runScaling("", RS_CLOCK, BENCH_SCALE_FRAMES + BENCH_SCALE_FRAMES / 4, threads, 1);
+        runScaling("", RS_CLOCK, BENCH_SCALE_FRAMES + BENCH_SCALE_FRAMES / 4, threads, 16);
+    }
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        runScaling("clk", RS_CLOCK, 512, threads, 1);
+        runScaling("swp", RS_CLOCK_SWEEP, 512, threads, 1);
+    }
+
+    writeTrace(BENCH_TRACE);
+    runTrace(BENCH_TRACE);
+    remove(BENCH_TRACE);
+    return 0;
+}
@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "crc32c.h"
+
+/* microbenchmark for the storage manager page I/O paths */
+
+#define BENCH_FILE "bench_pagefile.bin"
+#define BENCH_PAGES 4096   // 16 MB page file
+#define BENCH_LOOKUPS 20000 // random single page reads
+#define BENCH_RUN 64        // pages per readBlocks call
+#define BENCH_DEPTH 32      // queue depth of the async lookups
+
+// wall clock in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *path, const char *workload, int pages, double seconds)
+{
+    printf("%-9s %-12s %8d pages %8.3f s %12.0f pages/s\n", path, workload, pages, seconds, pages / seconds);
+}
+
+/* the previous stdio path: every call reopens the file, seeks and closes it again */
+
+static RC legacyReadBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    FILE *file = fopen(fHandle->fileName, "r+");
+    if (file == NULL)
+        return RC_FILE_NOT_FOUND;
+    if (fseek(file, (long)pageNum * PAGE_SIZE, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    fread(memPage, sizeof(char), PAGE_SIZE, file);
+    fHandle->curPagePos = pageNum;
+    fclose(file);
+    return RC_OK;
+}
+
+static RC legacyWriteBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    FILE *file = fopen(fHandle->fileName, "r+");
+    if (file == NULL)
+        return RC_FILE_NOT_FOUND;
+    if (fseek(file, (long)pageNum * PAGE_SIZE, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return RC_WRITE_FAILED;
+    }
+    fwrite(memPage, 1, PAGE_SIZE, file);
+    fHandle->curPagePos = pageNum;
+    fclose(file);
+    return RC_OK;
+}
+
+// the previous append: reopen the file, calloc a zero page and write it at the end
+static RC legacyAppendEmptyBlock(SM_FileHandle *fHandle)
+{
+    FILE *file = fopen(fHandle->fileName, "r+");
+    if (file == NULL)
+        return RC_FILE_NOT_FOUND;
+    char *emptyPage = (char *)calloc(PAGE_SIZE, sizeof(char));
+    fseek(file, 0, SEEK_END);
+    fwrite(emptyPage, sizeof(char), PAGE_SIZE, file);
+    free(emptyPage);
+    fHandle->totalNumPages++;
+    fclose(file);
+    return RC_OK;
+}
+
+// bulk load growth: BENCH_PAGES appends one page at a time, and one ensureCapacity for all of them
+static void runGrowth(void)
+{
+    SM_FileHandle fh;
+    SM_GrowthPolicy none = {0, 0};
+    double start;
+    int i;
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(legacyAppendEmptyBlock(&fh));
+    fsync(((SM_FileMgmt *)fh.mgmtInfo)->fd);
+    report("before", "append", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(setGrowthPolicy(&fh, none));
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(appendEmptyBlock(&fh));
+    fsync(((SM_FileMgmt *)fh.mgmtInfo)->fd);
+    report("no-resv", "append", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(appendEmptyBlock(&fh));
+    fsync(((SM_FileMgmt *)fh.mgmtInfo)->fd);
+    report("after", "append", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    start = now();
+    CHECK(ensureCapacity(BENCH_PAGES, &fh));
+    fsync(((SM_FileMgmt *)fh.mgmtInfo)->fd);
+    report("after", "ensure-cap", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+}
+
+// point lookups at random pages with BENCH_DEPTH reads kept in flight
+static void runAsyncLookups(SM_AsyncBackend backend, SM_FileHandle *fh)
+{
+    SM_AsyncQueue *queue;
+    SM_AsyncCompletion done[BENCH_DEPTH];
+    SM_PageHandle frames[BENCH_DEPTH];
+    int issued = 0, completed = 0, i, n;
+
+    if (initAsyncQueue(&queue, BENCH_DEPTH, backend) != RC_OK)
+    {
+        printf("async backend %d not available\n", backend);
+        return;
+    }
+    for (i = 0; i < BENCH_DEPTH; i++)
+        frames[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+
+    srand(42);
+    double start = now();
+    // fill the queue, then issue one new read for every completion
+    for (i = 0; i < BENCH_DEPTH; i++, issued++)
+        CHECK(queueReadBlock(queue, rand() % BENCH_PAGES, fh, frames[i], frames[i]));
+    CHECK(submitAsyncQueue(queue));
+    while (completed < BENCH_LOOKUPS)
+    {
+        n = reapCompletions(queue, done, BENCH_DEPTH, 1);
+        for (i = 0; i < n; i++, completed++)
+        {
+            CHECK(done[i].rc);
+            if (issued < BENCH_LOOKUPS)
+            {
+                CHECK(queueReadBlock(queue, rand() % BENCH_PAGES, fh, done[i].memPage, done[i].memPage));
+                issued++;
+            }
+        }
+        CHECK(submitAsyncQueue(queue));
+    }
+    report(getAsyncBackend(queue) == SM_ASYNC_IO_URING ? "uring" : "threads", "rand-read-q", BENCH_LOOKUPS, now() - start);
+
+    CHECK(shutdownAsyncQueue(queue));
+    for (i = 0; i < BENCH_DEPTH; i++)
+        free(frames[i]);
+}
+
+// add up every cache line of a page so that views are actually touched, not just handed out
+static long touchPage(SM_PageHandle page)
+{
+    long sum = 0;
+    for (int i = 0; i < PAGE_SIZE; i += 64)
+        sum += page[i];
+    return sum;
+}
+
+// scan and random lookups over the same file, comparing pread copies with mapped copies and views
+static void runMappedReads(void)
+{
+    SM_FileHandle fh, mapped;
+    SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+    SM_PageHandle view;
+    long sum = 0;
+    double start;
+    int i;
+
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(openPageFileWithFlags(BENCH_FILE, &mapped, SM_OPEN_MMAP));
+
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+    {
+        CHECK(readBlock(i, &fh, page));
+        sum += touchPage(page);
+    }
+    report("pread", "scan", BENCH_PAGES, now() - start);
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+    {
+        CHECK(readBlock(i, &mapped, page));
+        sum += touchPage(page);
+    }
+    report("mmap", "scan", BENCH_PAGES, now() - start);
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+    {
+        CHECK(mapBlock(i, &mapped, &view));
+        sum += touchPage(view);
+    }
+    report("mmap-view", "scan", BENCH_PAGES, now() - start);
+
+    srand(42);
+    start = now();
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        CHECK(readBlock(rand() % BENCH_PAGES, &fh, page));
+        sum += touchPage(page);
+    }
+    report("pread", "rand-lookup", BENCH_LOOKUPS, now() - start);
+    srand(42);
+    start = now();
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        CHECK(readBlock(rand() % BENCH_PAGES, &mapped, page));
+        sum += touchPage(page);
+    }
+    report("mmap", "rand-lookup", BENCH_LOOKUPS, now() - start);
+    srand(42);
+    start = now();
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        CHECK(mapBlock(rand() % BENCH_PAGES, &mapped, &view));
+        sum += touchPage(view);
+    }
+    report("mmap-view", "rand-lookup", BENCH_LOOKUPS, now() - start);
+
+    if (sum == 42) // keep the sums alive
+        printf("\n");
+    CHECK(closePageFile(&mapped));
+    CHECK(closePageFile(&fh));
+    free(page);
+}
+
+// checksum cost: CRC32C of a page, and a scan with and without verification of every page read
+static void runChecksums(void)
+{
+    SM_FileHandle fh;
+    SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+    uint32_t sum = 0;
+    double start;
+    int i;
+
+    memset(page, 'x', PAGE_SIZE);
+    start = now();
+    for (i = 0; i < BENCH_LOOKUPS * 10; i++)
+        sum += crc32c(page, PAGE_SIZE);
+    report(crc32cHardware() ? "crc-sse42" : "crc-table", "crc32c", BENCH_LOOKUPS * 10, now() - start);
+    start = now();
+    for (i = 0; i < BENCH_LOOKUPS * 10; i++)
+        sum += crc32cPortable(page, PAGE_SIZE);
+    report("crc-table", "crc32c", BENCH_LOOKUPS * 10, now() - start);
+
+    // write every page with checksums, then scan with and without verification
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFileWithFlags(BENCH_FILE, &fh, SM_OPEN_CHECKSUM));
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(writeBlock(i, &fh, page));
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(readBlock(i, &fh, page));
+    report("no-verify", "scan", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+
+    CHECK(openPageFileWithFlags(BENCH_FILE, &fh, SM_OPEN_VERIFY));
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(readBlock(i, &fh, page));
+    report("verify", "scan", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+
+    if (sum == 42) // keep the sums alive
+        printf("\n");
+    free(page);
+}
+
+// one readNextBlock scan over the file; cold scans first drop the file's pages from the page cache
+static void scanNext(const char *path, int openFlags, int readahead, int cold)
+{
+    SM_FileHandle fh;
+    SM_PageHandle page;
+    double start;
+    int i;
+
+    posix_memalign((void **)&page, PAGE_SIZE, PAGE_SIZE);
+    CHECK(openPageFileWithFlags(BENCH_FILE, &fh, openFlags));
+    CHECK(setReadahead(&fh, readahead));
+    if (cold)
+    {
+        fdatasync(((SM_FileMgmt *)fh.mgmtInfo)->fd);
+        posix_fadvise(((SM_FileMgmt *)fh.mgmtInfo)->fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    start = now();
+    CHECK(readFirstBlock(&fh, page));
+    for (i = 1; i < BENCH_PAGES; i++)
+        CHECK(readNextBlock(&fh, page));
+    report(path, cold ? "cold-scan" : "warm-scan", BENCH_PAGES, now() - start);
+    CHECK(closePageFile(&fh));
+    free(page);
+}
+
+// sequential scans page by page, with and without the readahead window
+static void runReadahead(void)
+{
+    SM_FileHandle fh;
+    SM_PageHandle page = (SM_PageHandle)calloc(PAGE_SIZE, 1);
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    for (int i = 0; i < BENCH_PAGES; i++)
+        CHECK(writeBlock(i, &fh, page));
+    CHECK(closePageFile(&fh));
+    free(page);
+
+    scanNext("no-ra", SM_OPEN_DEFAULT, 0, 1);
+    scanNext("ra", SM_OPEN_DEFAULT, SM_READAHEAD_MAX_PAGES, 1);
+    scanNext("no-ra", SM_OPEN_DEFAULT, 0, 0);
+    scanNext("ra", SM_OPEN_DEFAULT, SM_READAHEAD_MAX_PAGES, 0);
+    scanNext("direct", SM_OPEN_DIRECT, 0, 0);
+    scanNext("direct-ra", SM_OPEN_DIRECT, SM_READAHEAD_MAX_PAGES, 0);
+}
+
+// scan of the same 16 MB of data stored in pages of 4 KB up to SM_MAX_PAGE_SIZE, cold and warm
+static void runPageSizes(void)
+{
+    SM_FileHandle fh;
+    SM_PageHandle page;
+    char label[16];
+    size_t bytes = (size_t)BENCH_PAGES * PAGE_SIZE;
+
+    posix_memalign((void **)&page, PAGE_SIZE, SM_MAX_PAGE_SIZE);
+    memset(page, 'x', SM_MAX_PAGE_SIZE);
+    for (int pageSize = PAGE_SIZE; pageSize <= SM_MAX_PAGE_SIZE; pageSize *= 2)
+    {
+        int numPages = (int)(bytes / pageSize);
+        sprintf(label, "%dKB", pageSize / 1024);
+
+        CHECK(createPageFileWithPageSize(BENCH_FILE, pageSize));
+        CHECK(openPageFile(BENCH_FILE, &fh));
+        for (int i = 0; i < numPages; i++)
+            CHECK(writeBlock(i, &fh, page));
+        fdatasync(((SM_FileMgmt *)fh.mgmtInfo)->fd);
+
+        for (int cold = 1; cold >= 0; cold--)
+        {
+            if (cold)
+                posix_fadvise(((SM_FileMgmt *)fh.mgmtInfo)->fd, 0, 0, POSIX_FADV_DONTNEED);
+            double start = now();
+            for (int i = 0; i < numPages; i++)
+                CHECK(readBlock(i, &fh, page));
+            double seconds = now() - start;
+            // pages/s do not compare across page sizes, report bytes
+            printf("%-9s %-12s %8d pages %8.3f s %12.0f MB/s\n", label, cold ? "cold-scan" : "warm-scan", numPages, seconds,
+                   bytes / seconds / (1024 * 1024));
+        }
+        CHECK(closePageFile(&fh));
+    }
+    free(page);
+}
+
+typedef RC (*BlockIO)(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+
+static void runWorkloads(const char *path, BlockIO readFn, BlockIO writeFn, SM_FileHandle *fh, SM_PageHandle page)
+{
+    double start;
+    int i;
+
+    // sequential write of every page
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+    {
+        page[0] = (char)i;
+        CHECK(writeFn(i, fh, page));
+    }
+    report(path, "seq-write", BENCH_PAGES, now() - start);
+
+    // sequential read of every page
+    start = now();
+    for (i = 0; i < BENCH_PAGES; i++)
+        CHECK(readFn(i, fh, page));
+    report(path, "seq-read", BENCH_PAGES, now() - start);
+
+    // point lookups at random pages
+    srand(42);
+    start = now();
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        CHECK(readFn(rand() % BENCH_PAGES, fh, page));
+    report(path, "rand-read", BENCH_LOOKUPS, now() - start);
+}
+
+int main(void)
+{
+    SM_FileHandle fh;
+    SM_PageHandle page = (SM_PageHandle)calloc(PAGE_SIZE, 1);
+
+    initStorageManager();
+
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+
+    printf("page size %d, file %d pages\n", PAGE_SIZE, BENCH_PAGES);
+    runWorkloads("before", legacyReadBlock, legacyWriteBlock, &fh, page);
+    runWorkloads("after", readBlock, writeBlock, &fh, page);
+
+    // sequential scan in runs of BENCH_RUN pages, one preadv per run
+    SM_PageHandle run[BENCH_RUN];
+    int i, j;
+    for (j = 0; j < BENCH_RUN; j++)
+        run[j] = (SM_PageHandle)malloc(PAGE_SIZE);
+    double start = now();
+    for (i = 0; i < BENCH_PAGES; i += BENCH_RUN)
+        CHECK(readBlocks(i, BENCH_RUN, &fh, run));
+    report("after", "seq-readv", BENCH_PAGES, now() - start);
+    for (j = 0; j < BENCH_RUN; j++)
+        free(run[j]);
+
+    runAsyncLookups(SM_ASYNC_IO_URING, &fh);
+    runAsyncLookups(SM_ASYNC_THREADS, &fh);
+
+    CHECK(closePageFile(&fh));
+    runMappedReads();
+    runGrowth();
+    runChecksums();
+    runReadahead();
+    runPageSizes();
+    CHECK(destroyPageFile(BENCH_FILE));
+    free(page);
+    return 0;
+}
@@ -1,338 +1,952 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include <math.h>
 #include "buffer_mgr_helper.c"
 
+static void stopPrefetcher(BM_BufferPool *const bm);
+static void warmStart(BM_BufferPool *const bm);
+static void warmSave(BM_BufferPool *const bm);
+
 // ***** BUFFER POOL FUNCTIONS ***** //
 
 /*
    This function creates and initializes a buffer pool with numPages page frames.
    pageFileName stores the name of the page file whose pages are being cached in memory.
    strategy represents the page replacement strategy (FIFO, LRU, LFU, CLOCK) that will be used by this buffer pool
-   stratData is used to pass parameters if any to the page replacement strategy
+   stratData is used to pass parameters if any to the page replacement strategy,
+   a BM_LRUKParams for RS_LRU_K, a BM_2QParams for RS_2Q or a BM_LFUParams for RS_LFU (or NULL for their defaults)
 */
 extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                          const int numPages, ReplacementStrategy strategy,
                          void *stratData)
 {
-    PageFrame *page;
+    return initBufferPoolWithFlags(bm, pageFileName, numPages, strategy, stratData, SM_OPEN_DEFAULT);
+}
+
+/*
+   Same as initBufferPool, with openFlags selecting how the page file is opened.
+   With SM_OPEN_DIRECT the pool is the only cache of the file's pages: the kernel page cache is bypassed
+   and the memory used for page data is bounded by numPages aligned frames.
+   With BM_OPEN_WARM_RESTART the pool starts reading the pages a pool of the same file had when it was shut down
+   with the flag, in page order and without waiting for them, and takes up their place in the replacement order
+   and their counts; shutdownBufferPool records the pages for the next one. A pool without a record starts cold.
+*/
+extern RC initBufferPoolWithFlags(BM_BufferPool *const bm, const char *const pageFileName,
+                                  const int numPages, ReplacementStrategy strategy,
+                                  void *stratData, int openFlags)
+{
+    BM_MGMT_DATA *mgmtData;
     bm->pageFile = (char *)pageFileName;
     bm->numPages = numPages;
     bm->strategy = strategy;
-    int bufferSize, i = 0;
-
-    // Reserve memory space = number of pages x space required for one page
-    size_t pageFrameSize = sizeof(PageFrame) * numPages;
-    page = malloc(pageFrameSize);
+    bm->pageSize = PAGE_SIZE; // until the page file is opened and its header read
 
-    // Buffer size is the total number of pages in memory or the buffer pool.
+    // Reserve the frame table for the most frames the pool can be resized to, and set up numPages of them.
+    // The page file is opened on first I/O and then kept open until shutdownBufferPool
+    mgmtData = (BM_MGMT_DATA *)calloc(1, sizeof(BM_MGMT_DATA));
+    if (mgmtData == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    if (reserveFrames(mgmtData, numPages > BM_MAX_POOL_PAGES ? numPages : BM_MAX_POOL_PAGES) != RC_OK ||
+        setUpFrames(mgmtData, 0, numPages) != RC_OK || pageTableInit(&mgmtData->pageTable, numPages) != RC_OK)
+    {
+        releaseFrames(mgmtData);
+        free(mgmtData);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    mgmtData->numFrames = numPages;
+    mgmtData->freeFrames = (int *)malloc(sizeof(int) * numPages);
+    mgmtData->frameFree = (bool *)calloc(numPages, sizeof(bool));
+    if (mgmtData->freeFrames == NULL || mgmtData->frameFree == NULL || pageTableInit(&mgmtData->writeBacks, numPages) != RC_OK)
+    {
+        free(mgmtData->freeFrames);
+        free(mgmtData->frameFree);
+        pageTableFree(&mgmtData->pageTable);
+        releaseFrames(mgmtData);
+        free(mgmtData);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    // the pool prefetches by itself; the staging of a readahead handle would hand out pages other handles changed
+    mgmtData->openFlags = openFlags & ~(BM_OPEN_WARM_RESTART | SM_OPEN_READAHEAD);
+    mgmtData->prefetchFailedPage = NO_PAGE;
+    mgmtData->warmRestart = (openFlags & BM_OPEN_WARM_RESTART) != 0 && pageFileName != NULL;
 
-    bufferSize = numPages;
+    if (strategy == RS_LRU_K)
+    {
+        RC result = lrukInit(mgmtData, numPages, (const BM_LRUKParams *)stratData);
+        if (result != RC_OK)
+        {
+            pageTableFree(&mgmtData->pageTable);
+            pageTableFree(&mgmtData->writeBacks);
+            free(mgmtData->freeFrames);
+            free(mgmtData->frameFree);
+            releaseFrames(mgmtData);
+            free(mgmtData);
+            return result;
+        }
+    }
+    else if (strategy == RS_LFU)
+    {
+        RC result = lfuInit(mgmtData, numPages, (const BM_LFUParams *)stratData);
+        if (result != RC_OK)
+        {
+            pageTableFree(&mgmtData->pageTable);
+            pageTableFree(&mgmtData->writeBacks);
+            free(mgmtData->freeFrames);
+            free(mgmtData->frameFree);
+            releaseFrames(mgmtData);
+            free(mgmtData);
+            return result;
+        }
+    }
+    else if (strategy == RS_ARC || strategy == RS_2Q)
+    {
+        RC result = queuesInit(mgmtData, strategy, numPages, strategy == RS_2Q ? (const BM_2QParams *)stratData : NULL);
+        if (result != RC_OK)
+        {
+            pageTableFree(&mgmtData->pageTable);
+            pageTableFree(&mgmtData->writeBacks);
+            free(mgmtData->freeFrames);
+            free(mgmtData->frameFree);
+            releaseFrames(mgmtData);
+            free(mgmtData);
+            return result;
+        }
+    }
 
-    // Initializing all pages in the buffer pool. The values of fields (variables) in the page are either NULL or 0
+    pthread_mutex_init(&mgmtData->latch, NULL);
+    pthread_cond_init(&mgmtData->ioDone, NULL);
+    pthread_rwlock_init(&mgmtData->ioLatch, NULL);
+    pthread_cond_init(&mgmtData->writerWake, NULL);
+    pthread_cond_init(&mgmtData->prefetchWake, NULL);
+    pthread_mutex_init(&mgmtData->resizeLatch, NULL);
 
-    while (i < bufferSize)
+    bm->mgmtData = mgmtData;
+    if (mgmtData->warmRestart)
     {
-        PageFrame *currentPage = &page[i];
-        currentPage->data = NULL;
-        currentPage->pageNum = -1;
-        currentPage->dirtyBit = 0;
-        currentPage->fixCount = 0;
-        currentPage->hitNum = 0;
-        currentPage->refNum = 0;
-        ++i;
+        warmStart(bm);
     }
-
-    bm->mgmtData = page;
     return RC_OK;
 }
 
-// Function to shut down the buffer pool
-extern RC shutdownBufferPool(BM_BufferPool *const bm)
+/*
+   Same as initBufferPoolWithFlags, with the numPages frames split over numPartitions independent sub-pools.
+   Every page is hashed to one sub-pool, which has its own page table, replacement state, latches and handle on
+   the page file, so threads pinning different pages rarely contend. stratData applies to each sub-pool.
+   With numPartitions <= 1 this is an ordinary pool
+*/
+extern RC initBufferPoolPartitioned(BM_BufferPool *const bm, const char *const pageFileName,
+                                    const int numPages, ReplacementStrategy strategy,
+                                    void *stratData, int openFlags, int numPartitions)
 {
-    PageFrame *pageFrame;
-    int i = 0;
-    pageFrame = (PageFrame *)bm->mgmtData;
-
-    // Write all dirty pages (modified pages) back to disk
-    forceFlushPool(bm);
+    BM_MGMT_DATA *mgmtData;
+    RC result;
+    int p;
 
-    int numPages = bm->numPages;
+    if (numPartitions <= 1)
+    {
+        return initBufferPoolWithFlags(bm, pageFileName, numPages, strategy, stratData, openFlags);
+    }
+    // every sub-pool needs at least one frame
+    if (numPartitions > numPages)
+    {
+        return RC_ERROR;
+    }
 
-    while (i < numPages && pageFrame[i].fixCount == 0)
+    mgmtData = (BM_MGMT_DATA *)calloc(1, sizeof(BM_MGMT_DATA));
+    if (mgmtData == NULL || (mgmtData->partitions = (BM_BufferPool *)calloc(numPartitions, sizeof(BM_BufferPool))) == NULL)
     {
-        i++;
+        free(mgmtData);
+        return RC_MEMORY_ALLOCATION_FAILED;
     }
 
-    if (i < numPages)
+    // The frames are spread evenly, the first numPages % numPartitions sub-pools get one more
+    for (p = 0; p < numPartitions; p++)
     {
-        return RC_PINNED_PAGES_IN_BUFFER;
+        int frames = numPages / numPartitions + (p < numPages % numPartitions ? 1 : 0);
+        result = initBufferPoolWithFlags(&mgmtData->partitions[p], pageFileName, frames, strategy, stratData,
+                                         openFlags & ~BM_OPEN_WARM_RESTART);
+        if (result != RC_OK)
+        {
+            while (--p >= 0)
+            {
+                shutdownBufferPool(&mgmtData->partitions[p]);
+            }
+            free(mgmtData->partitions);
+            free(mgmtData);
+            return result;
+        }
     }
+    mgmtData->numPartitions = numPartitions;
+    mgmtData->warmRestart = (openFlags & BM_OPEN_WARM_RESTART) != 0;
 
-    // Release space occupied by the page
-    free(pageFrame);
-    bm->mgmtData = NULL;
+    bm->pageFile = (char *)pageFileName;
+    bm->numPages = numPages;
+    bm->strategy = strategy;
+    bm->pageSize = PAGE_SIZE;
+    bm->mgmtData = mgmtData;
+    if (mgmtData->warmRestart)
+    {
+        warmStart(bm);
+    }
     return RC_OK;
 }
 
-// Function to write all dirty pages (having fixCount = 0) to disk
-extern RC forceFlushPool(BM_BufferPool *const bm)
+/*
+   Create a buffer pool of numPages frames shared by several page files, so that all open tables and indexes draw
+   on one memory budget instead of a pool each. Files are attached to it with attachBufferPool and their pages are
+   pinned through the views that sets up; the replacement strategy, given by strategy and stratData as for
+   initBufferPool, chooses its victims among the pages of all files
+*/
+extern RC initSharedBufferPool(BM_BufferPool *const pool, const int numPages, ReplacementStrategy strategy,
+                               void *stratData)
 {
-    int i = 0;
-    PageFrame *pageFrame;
-    pageFrame = (PageFrame *)bm->mgmtData;
-
-    // Store all dirty pages (modified pages) in memory to the page file on disk
-
-    int fixCount, dirtyBit, pageNum;
-    SM_FileHandle fh;
-    char *data;
+    BM_MGMT_DATA *mgmtData;
+    RC result = initBufferPoolWithFlags(pool, NULL, numPages, strategy, stratData, SM_OPEN_DEFAULT);
 
-    while (i < bm->numPages)
+    if (result != RC_OK)
     {
-        fixCount = pageFrame[i].fixCount;
-        dirtyBit = pageFrame[i].dirtyBit;
-        pageNum = pageFrame[i].pageNum;
-        data = pageFrame[i].data;
-
-        if (fixCount == 0 && dirtyBit == 1)
-        {
-            SM_FileHandle fh;
-            // Opening page file available on disk
-            openPageFile(bm->pageFile, &fh);
-            // Writing a block of data to the page file on disk
-            writeBlock(pageNum, &fh, data);
-            // Mark the page as not dirty.
-            pageFrame[i].dirtyBit = 0;
-        }
-        i++;
+        return result;
+    }
+    mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    mgmtData->files = (BM_SharedFile *)calloc(BM_MAX_SHARED_FILES, sizeof(BM_SharedFile));
+    if (mgmtData->files == NULL)
+    {
+        shutdownBufferPool(pool);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (int id = 0; id < BM_MAX_SHARED_FILES; id++)
+    {
+        pthread_rwlock_init(&mgmtData->files[id].latch, NULL);
     }
     return RC_OK;
 }
 
-// Function to update page replacement information
-void updatePageReplacementInfo(BM_BufferPool *const bm, const int pageIndex)
+/*
+   Attach page file pageFileName, opened with openFlags, to the shared pool pool and set up bm as the file's view:
+   a pool handle used like one from initBufferPool, while the file's pages take their frames from the shared pool.
+   forceFlushPool on the view writes back only the file's pages, dropFilePages discards them, and
+   shutdownBufferPool detaches the file. Every file attached must have the page size of the first one.
+   BM_OPEN_WARM_RESTART is refused, the pages of a shared pool are not recorded per file
+*/
+extern RC attachBufferPool(BM_BufferPool *const bm, BM_BufferPool *const pool, const char *const pageFileName,
+                           int openFlags)
 {
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+    BM_MGMT_DATA *mgmtData, *view;
+    BM_SharedFile *file;
+    SM_FileHandle fileHandle;
+    RC result;
+    int id, pageSize = 0;
 
-    if (bm->strategy == RS_LRU)
+    if (!bufferPoolExists(pool))
     {
-        // LRU algorithm uses the value of hit to determine the least recently used page
-        pageFrame[pageIndex].hitNum = pageFrame[pageIndex].hitNum + 1;
+        return RC_BUFFER_POOL_NOT_EXISTING;
     }
-    else if (bm->strategy == RS_CLOCK)
+    mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    if (mgmtData->files == NULL || (openFlags & BM_OPEN_WARM_RESTART))
     {
-        // hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
-        pageFrame[pageIndex].hitNum = 1;
+        return RC_ERROR;
     }
-    else if (bm->strategy == RS_LFU)
+    view = (BM_MGMT_DATA *)calloc(1, sizeof(BM_MGMT_DATA));
+    if (view == NULL)
     {
-        // Incrementing refNum to add one more to the count of the number of times the page is used (referenced)
-        pageFrame[pageIndex].refNum++;
+        return RC_MEMORY_ALLOCATION_FAILED;
     }
-    // Add additional conditions for other replacement strategies if needed
-}
 
-// Function to apply page replacement strategy
-void applyPageReplacementStrategy(BM_BufferPool *const bm, PageFrame *const newPage)
-{
-    if (bm->strategy == RS_FIFO)
+    // the file is opened before the pool is latched, pins of the files already attached go on meanwhile
+    result = openPageFileWithFlags((char *)pageFileName, &fileHandle, openFlags & ~SM_OPEN_READAHEAD);
+    if (result != RC_OK)
     {
-        FIFO(bm, newPage);
+        free(view);
+        return result;
     }
-    else if (bm->strategy == RS_LRU)
+
+    pthread_mutex_lock(&mgmtData->latch);
+    for (id = 0; id < BM_MAX_SHARED_FILES && mgmtData->files[id].attached; id++)
     {
-        LRU(bm, newPage);
     }
-    else if (bm->strategy == RS_CLOCK)
+    if (id == BM_MAX_SHARED_FILES)
     {
-        CLOCK(bm, newPage);
+        result = RC_ERROR;
     }
-    else if (bm->strategy == RS_LFU)
+    else if ((mgmtData->numChunks > 0 || mgmtData->numAttached > 0) && fileHandle.pageSize != pool->pageSize)
     {
-        LFU(bm, newPage);
+        result = RC_INVALID_PAGE_SIZE;
     }
-    else if (bm->strategy == RS_LRU_K)
+    else
     {
-        printf("\nLRU-k algorithm not implemented");
+        file = &mgmtData->files[id];
+        pthread_rwlock_wrlock(&file->latch);
+        file->fileHandle = fileHandle;
+        file->attached = 1;
+        pthread_rwlock_unlock(&file->latch);
+        file->numReadIO = file->numWriteIO = 0;
+        mgmtData->numAttached++;
+        // the frames are cut for the page size of the files on the first pin
+        pageSize = pool->pageSize = fileHandle.pageSize;
     }
-    else
+    pthread_mutex_unlock(&mgmtData->latch);
+    if (result != RC_OK)
     {
-        printf("\nAlgorithm Not Implemented\n");
+        closePageFile(&fileHandle);
+        free(view);
+        return result;
     }
+
+    view->sharedPool = pool;
+    view->fileId = id;
+    bm->pageFile = (char *)pageFileName;
+    bm->numPages = pool->numPages;
+    bm->strategy = pool->strategy;
+    bm->pageSize = pageSize;
+    bm->mgmtData = view;
+    return RC_OK;
 }
-/*
-// Function to pin a page with a page number pageNum
-extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
-                  const PageNumber pageNum)
-{
-    PageFrame *pageFrame;
-    pageFrame = (PageFrame *)bm->mgmtData;
 
-    int isFirstPageInvalid = (pageFrame[0].pageNum == -1);
+// Shut down the sub-pools of a partitioned pool, none of them unless no page of any is pinned
+static RC shutdownPartitions(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int *fixCounts;
+    int i, p;
 
-    // Checking if the buffer pool is empty and this is the first page to be pinned
-    if (isFirstPageInvalid)
+    stopBackgroundWriter(bm);
+    for (p = 0; p < mgmtData->numPartitions; p++)
     {
-        // Reading the page from disk and initializing the page frame's content in the buffer pool
-        SM_FileHandle fh;
-        openPageFile(bm->pageFile, &fh);
-        pageFrame[0].data = (SM_PageHandle)malloc(PAGE_SIZE);
-        ensureCapacity(pageNum, &fh);
-        readBlock(pageNum, &fh, pageFrame[0].data);
-        pageFrame[0].pageNum = pageNum;
-        pageFrame[0].fixCount++;
-        pageFrame[0].hitNum = 0;
-        pageFrame[0].refNum = 0;
-        page->pageNum = pageNum;
-        page->data = pageFrame[0].data;
+        stopPrefetcher(&mgmtData->partitions[p]);
+    }
+    forceFlushPool(bm);
 
-        return RC_OK;
+    fixCounts = getFixCounts(bm);
+    if (fixCounts == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
     }
-    else
+    for (i = 0; i < bm->numPages && fixCounts[i] == 0; i++)
     {
-        int i;
-        bool isBufferFull = true;
-
-        for (i = 0; i < bm->numPages; i++)
-        {
-            if (pageFrame[i].pageNum != -1)
-            {
-                // Checking if the page is in memory
-                if (pageFrame[i].pageNum == pageNum)
-                {
-                    // Increasing fixCount, i.e., now there is one more client accessing this page
-                    pageFrame[i].fixCount++;
-                    isBufferFull = false;
+    }
+    free(fixCounts);
+    if (i < bm->numPages)
+    {
+        return RC_PINNED_PAGES_IN_BUFFER;
+    }
+    if (mgmtData->warmRestart)
+    {
+        warmSave(bm);
+    }
 
-                    // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
-                    pageFrame[i].hitNum++;
+    for (p = 0; p < mgmtData->numPartitions; p++)
+    {
+        shutdownBufferPool(&mgmtData->partitions[p]);
+    }
+    free(mgmtData->partitions);
+    free(mgmtData);
+    bm->mgmtData = NULL;
+    return RC_OK;
+}
 
-                    // Updating algorithm-specific values
-                    updatePageReplacementInfo(bm, i);
+// Drop the unpinned pages of file fileId from shared pool bm without writing them back, once the reads and
+// write-backs of the file's pages under way are done. Returns RC_PINNED_PAGES_IN_BUFFER if pinned pages remain
+static RC dropPages(BM_BufferPool *const bm, int fileId)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame = mgmtData->frames;
+    bool busy = true, pinned = false;
+    unsigned slot;
+    int i;
 
-                    page->pageNum = pageNum;
-                    page->data = pageFrame[i].data;
+    pthread_mutex_lock(&mgmtData->latch);
+    while (busy)
+    {
+        busy = false;
+        for (i = 0; i < mgmtData->numFrames && !busy; i++)
+        {
+            busy = pageFrame[i].ioInProgress && keyFile(pageFrame[i].pageNum) == fileId;
+        }
+        for (slot = 0; slot <= mgmtData->writeBacks.mask && !busy; slot++)
+        {
+            BM_PageKey key = mgmtData->writeBacks.slots[slot].pageNum;
+            busy = key != NO_PAGE && keyFile(key) == fileId;
+        }
+        if (busy)
+        {
+            pthread_cond_wait(&mgmtData->ioDone, &mgmtData->latch);
+        }
+    }
 
-                    break;
-                }
-            }
-            else
+    for (i = 0; i < mgmtData->numFrames; i++)
+    {
+        if (pageFrame[i].pageNum == NO_PAGE || keyFile(pageFrame[i].pageNum) != fileId)
+        {
+            continue;
+        }
+        if (frameUnpinned(&pageFrame[i]))
+        {
+            dropFrame(bm, i);
+            if (i >= bm->numPages)
             {
-                SM_FileHandle fh;
-                openPageFile(bm->pageFile, &fh);
-                pageFrame[i].data = (SM_PageHandle)malloc(PAGE_SIZE);
-                readBlock(pageNum, &fh, pageFrame[i].data);
-                pageFrame[i].pageNum = pageNum;
-                pageFrame[i].fixCount = 1;
-                pageFrame[i].refNum = 0;
-
-                // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
-                pageFrame[i].hitNum++;
-
-                // Updating algorithm-specific values
-                updatePageReplacementInfo(bm, i);
-
-                page->pageNum = pageNum;
-                page->data = pageFrame[i].data;
-
-                isBufferFull = false;
-                break;
+                // the frame was retired by a shrink, and takeFreeFrame passes it over
+                releaseFrameData(bm, i);
+                mgmtData->numRetiring--;
             }
         }
-
-        // If isBufferFull is true, then the buffer is full, and we must replace an existing page using the page replacement strategy
-        if (isBufferFull)
+        else
         {
-            // Create a new page to store data read from the file.
-            PageFrame *newPage = (PageFrame *)malloc(sizeof(PageFrame));
-
-            // Reading the page from disk and initializing the page frame's content in the buffer pool
-            SM_FileHandle fh;
-            openPageFile(bm->pageFile, &fh);
-            newPage->data = (SM_PageHandle)malloc(PAGE_SIZE);
-            readBlock(pageNum, &fh, newPage->data);
-            newPage->pageNum = pageNum;
-            newPage->dirtyBit = 0;
-            newPage->fixCount = 1;
-            newPage->refNum = 0;
-
-            // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
-            newPage->hitNum++;
-
-            // Updating algorithm-specific values
-            updatePageReplacementInfo(bm, bm->numPages - 1);
-
-            page->pageNum = pageNum;
-            page->data = newPage->data;
-
-            // Call the appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
-            applyPageReplacementStrategy(bm, newPage);
+            pinned = true;
         }
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+    return pinned ? RC_PINNED_PAGES_IN_BUFFER : RC_OK;
+}
 
-        return RC_OK;
+// Detach the file of view bm from its shared pool: write back and drop its pages, then close it. Fails, and leaves
+// the file attached, while pages of it are pinned
+static RC detachView(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *view = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_BufferPool *pool = view->sharedPool;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    BM_SharedFile *file = &mgmtData->files[view->fileId];
+    SM_FileHandle fileHandle;
+    RC result;
+
+    forceFlushPool(bm);
+    if ((result = dropPages(pool, view->fileId)) != RC_OK)
+    {
+        return result;
     }
+
+    // the handle is taken out under the latches and closed after, like attachBufferPool opens it
+    pthread_mutex_lock(&mgmtData->latch);
+    pthread_rwlock_wrlock(&file->latch);
+    fileHandle = file->fileHandle;
+    file->attached = 0;
+    pthread_rwlock_unlock(&file->latch);
+    mgmtData->numAttached--;
+    pthread_mutex_unlock(&mgmtData->latch);
+    closePageFile(&fileHandle);
+
+    free(view);
+    bm->mgmtData = NULL;
+    return RC_OK;
 }
-*/
 
-// Function to pin a page with a page number pageNum
-extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
-                  const PageNumber pageNum)
+// Function to shut down the buffer pool; no other thread may use the pool any more. Shutting down a view detaches
+// its file from the shared pool; a shared pool closes the files still attached, whose views must not be used again
+extern RC shutdownBufferPool(BM_BufferPool *const bm)
 {
     PageFrame *pageFrame;
-    pageFrame = (PageFrame *)bm->mgmtData;
+    BM_MGMT_DATA *mgmtData;
+    int i = 0;
+    if (poolPartitioned(bm))
+    {
+        return shutdownPartitions(bm);
+    }
+    if (poolView(bm))
+    {
+        return detachView(bm);
+    }
+    mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    pageFrame = mgmtData->frames;
 
-    int isFirstPageInvalid = (pageFrame[0].pageNum == -1);
+    stopBackgroundWriter(bm);
+    stopPrefetcher(bm);
 
-    // Checking if the buffer pool is empty and this is the first page to be pinned
-    if (isFirstPageInvalid)
-    {
-        // Load the page from the disk and initialize the page frame's buffer pool content
-        SM_FileHandle fh;
+    // Write all dirty pages (modified pages) back to disk
+    forceFlushPool(bm);
 
-        openPageFile(bm->pageFile, &fh);
+    // frames retired by a shrink may still hold pinned pages
+    int numFrames = mgmtData->numFrames;
 
+    while (i < numFrames && pageFrame[i].fixCount == 0)
+    {
+        i++;
+    }
+
+    if (i < numFrames)
+    {
+        return RC_PINNED_PAGES_IN_BUFFER;
+    }
+    if (mgmtData->warmRestart)
+    {
+        warmSave(bm);
+    }
+
+    // Close the page file kept open by the pool
+    if (mgmtData->fileHandle.mgmtInfo != NULL)
+    {
+        closePageFile(&mgmtData->fileHandle);
+    }
+    for (i = 0; mgmtData->files != NULL && i < BM_MAX_SHARED_FILES; i++)
+    {
+        if (mgmtData->files[i].attached)
+        {
+            closePageFile(&mgmtData->files[i].fileHandle);
+        }
+    }
+
+    // Release space occupied by the pages and their data
+    freeFrameArena(mgmtData);
+    pageTableFree(&mgmtData->pageTable);
+    pageTableFree(&mgmtData->writeBacks);
+    for (i = 0; i < numFrames; i++)
+    {
+        pthread_rwlock_destroy(&mgmtData->frameLatches[i]);
+    }
+    releaseFrames(mgmtData);
+    pthread_mutex_destroy(&mgmtData->latch);
+    pthread_cond_destroy(&mgmtData->ioDone);
+    pthread_rwlock_destroy(&mgmtData->ioLatch);
+    pthread_cond_destroy(&mgmtData->writerWake);
+    pthread_cond_destroy(&mgmtData->prefetchWake);
+    pthread_mutex_destroy(&mgmtData->resizeLatch);
+    lrukFree(mgmtData);
+    queuesFree(mgmtData);
+    lfuFree(mgmtData);
+    ringsFree(mgmtData);
+    for (i = 0; mgmtData->files != NULL && i < BM_MAX_SHARED_FILES; i++)
+    {
+        pthread_rwlock_destroy(&mgmtData->files[i].latch);
+    }
+    free(mgmtData->files);
+    free(mgmtData->freeFrames);
+    free(mgmtData->frameFree);
+    free(mgmtData);
+    bm->mgmtData = NULL;
+    return RC_OK;
+}
+
+// Discard the pages of the file of view bm from its shared pool without writing them back, e.g. before the file is
+// destroyed. Pinned pages stay, after the others are dropped RC_PINNED_PAGES_IN_BUFFER is returned
+RC dropFilePages(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (!poolView(bm))
+    {
+        return RC_ERROR;
+    }
+    BM_MGMT_DATA *view = (BM_MGMT_DATA *)bm->mgmtData;
+    return dropPages(view->sharedPool, view->fileId);
+}
+
+static RC flushPool(BM_BufferPool *const bm, int fileId, int firstFrame);
+
+// Function to write all dirty pages (having fixCount = 0) to disk. The dirty set is collected under the latch and
+// written in page-number order, each run of consecutive pages with one writeBlocks call, and the flush ends with a
+// single syncPageFile instead of leaving the pages in the page cache. A view writes only the pages of its file
+extern RC forceFlushPool(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC result = RC_OK;
+    int i;
+
+    if (poolView(bm))
+    {
+        return flushPool(mgmtData->sharedPool, mgmtData->fileId, 0);
+    }
+    if (poolPartitioned(bm))
+    {
+        // every sub-pool writes and syncs through its own handle
+        for (i = 0; i < mgmtData->numPartitions; i++)
+        {
+            RC partitionResult = forceFlushPool(&mgmtData->partitions[i]);
+            if (partitionResult != RC_OK)
+            {
+                result = partitionResult;
+            }
+        }
+        return result;
+    }
+    return flushPool(bm, -1, 0);
+}
+
+// forceFlushPool of the pages of file fileId of a shared pool, or with fileId -1 of all pages of the pool, in the
+// frames from firstFrame on. Each file written to is synced once, and frames retired by a shrink whose pages are
+// clean then are dropped
+static RC flushPool(BM_BufferPool *const bm, int fileId, int firstFrame)
+{
+    int i = 0, n = 0, batches = 0, written;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame;
+    pageFrame = mgmtData->frames;
+    BM_FrameRef *refs;
+    RC result = RC_OK;
+    // frames resizeBufferPool sets up meanwhile are empty
+    int numFrames = __atomic_load_n(&mgmtData->numFrames, __ATOMIC_ACQUIRE);
+
+    refs = (BM_FrameRef *)malloc(sizeof(BM_FrameRef) * numFrames);
+    if (refs == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    // Each page is pinned for the write, so that it is not evicted while it is written without the latch held
+    pthread_mutex_lock(&mgmtData->latch);
+    for (i = firstFrame; i < numFrames; i++)
+    {
+        if (frameUnpinned(&pageFrame[i]) && __atomic_load_n(&pageFrame[i].dirtyBit, __ATOMIC_ACQUIRE) == 1 && pageFrame[i].pageNum != NO_PAGE &&
+            (fileId < 0 || keyFile(pageFrame[i].pageNum) == fileId))
+        {
+            __atomic_add_fetch(&pageFrame[i].fixCount, 1, __ATOMIC_ACQ_REL);
+            refs[n].pageNum = pageFrame[i].pageNum;
+            refs[n].frame = i;
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    // Store all dirty pages (modified pages) in memory to the page file on disk
+    written = n > 0 ? writeFrames(bm, refs, n, true, &batches) : 0;
+    if (written < n)
+    {
+        result = RC_WRITE_FAILED;
+    }
+
+    if (written > 0)
+    {
+        if (mgmtData->files == NULL)
+        {
+            pthread_rwlock_rdlock(&mgmtData->ioLatch);
+            if (syncPageFile(&mgmtData->fileHandle) != RC_OK)
+            {
+                result = RC_WRITE_FAILED;
+            }
+            pthread_rwlock_unlock(&mgmtData->ioLatch);
+        }
+        // writeFrames sorted refs by key, i.e. by file
+        for (i = 0; mgmtData->files != NULL && i < n; i++)
+        {
+            BM_SharedFile *file = &mgmtData->files[keyFile(refs[i].pageNum)];
+            if (i > 0 && keyFile(refs[i].pageNum) == keyFile(refs[i - 1].pageNum))
+            {
+                continue;
+            }
+            pthread_rwlock_rdlock(&file->latch);
+            if (file->attached && syncPageFile(&file->fileHandle) != RC_OK)
+            {
+                result = RC_WRITE_FAILED;
+            }
+            pthread_rwlock_unlock(&file->latch);
+        }
+    }
+    free(refs);
+
+    pthread_mutex_lock(&mgmtData->latch);
+    retireFrames(bm);
+    pthread_mutex_unlock(&mgmtData->latch);
+    return result;
+}
+
+void updatePageReplacementInfo(BM_BufferPool *const bm, const int pageIndex);
+
+// Grow the pool to numPages frames. Frames past those set up so far are set up, with every table indexed by frame
+// extended for them; frames a shrink retired are taken back, and those still holding a page rejoin the replacement
+// state as if just referenced. The empty frames, those never used yet included, then become free frames, which
+// pins take before the replacement strategy is asked for a victim. Called with the latch held
+static RC growFrames(BM_BufferPool *const bm, int numPages)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int oldPages = bm->numPages, oldFrames = mgmtData->numFrames, i;
+    RC result;
+
+    if (numPages > oldFrames)
+    {
+        // nothing indexes the new frames before numFrames is raised, so a failure leaves the pool as it was
+        if (setUpFrames(mgmtData, oldFrames, numPages) != RC_OK ||
+            pageTableGrow(&mgmtData->pageTable, numPages) != RC_OK ||
+            pageTableGrow(&mgmtData->writeBacks, numPages) != RC_OK ||
+            !growArray(&mgmtData->freeFrames, sizeof(int), numPages) ||
+            !growArray(&mgmtData->frameFree, sizeof(bool), numPages) ||
+            (mgmtData->frameRing != NULL && !growArray(&mgmtData->frameRing, sizeof(int), numPages)) ||
+            (mgmtData->lruk != NULL && lrukGrow(mgmtData, oldFrames, numPages) != RC_OK) ||
+            (mgmtData->queues != NULL && queuesGrow(mgmtData, bm->strategy, oldFrames, numPages) != RC_OK) ||
+            (mgmtData->lfu != NULL && lfuGrow(mgmtData, oldFrames, numPages) != RC_OK))
+        {
+            return RC_MEMORY_ALLOCATION_FAILED;
+        }
+        if (mgmtData->numChunks > 0 && (result = mapArenaChunk(bm, oldFrames, numPages - oldFrames)) != RC_OK)
+        {
+            return result;
+        }
+        if (mgmtData->prefetchQueue != NULL)
+        {
+            // the queued reads move to the front of a queue with an entry per frame
+            BM_Prefetch *queue = (BM_Prefetch *)malloc(sizeof(BM_Prefetch) * numPages);
+            if (queue == NULL)
+            {
+                return RC_MEMORY_ALLOCATION_FAILED;
+            }
+            for (i = 0; i < mgmtData->prefetchCount; i++)
+            {
+                queue[i] = mgmtData->prefetchQueue[(mgmtData->prefetchHead + i) % mgmtData->prefetchSize];
+            }
+            free(mgmtData->prefetchQueue);
+            mgmtData->prefetchQueue = queue;
+            mgmtData->prefetchHead = 0;
+            mgmtData->prefetchSize = numPages;
+        }
+        for (i = oldFrames; i < numPages; i++)
+        {
+            mgmtData->frameFree[i] = false;
+            if (mgmtData->frameRing != NULL)
+            {
+                mgmtData->frameRing[i] = -1;
+            }
+        }
+        __atomic_store_n(&mgmtData->numFrames, numPages, __ATOMIC_RELEASE);
+    }
+
+    for (i = oldPages; i < numPages && i < oldFrames; i++)
+    {
+        if (mgmtData->frames[i].pageNum != NO_PAGE)
+        {
+            mgmtData->numRetiring--;
+            updatePageReplacementInfo(bm, i);
+        }
+    }
+    // pushed from the top, so the lowest free frame is taken first
+    for (i = numPages - 1; i >= mgmtData->numUsedFrames; i--)
+    {
+        if (mgmtData->frames[i].pageNum == NO_PAGE)
+        {
+            freeFrame(mgmtData, i);
+        }
+    }
+    mgmtData->numUsedFrames = numPages;
+    __atomic_store_n(&bm->numPages, numPages, __ATOMIC_RELEASE);
+    ringsResize(bm);
+    return RC_OK;
+}
+
+// Shrink the pool to numPages frames. The frames past it are retired: they leave the replacement state, the rings
+// and the frames handed out in order, so no page goes into them any more, and the empty ones give their memory back
+// at once. The pages of the others stay in the pool until retireFrames drops them. Called with the latch held
+static void shrinkFrames(BM_BufferPool *const bm, int numPages)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    for (int i = numPages; i < bm->numPages; i++)
+    {
+        unlinkFrame(mgmtData, i);
+        if (mgmtData->frames[i].pageNum != NO_PAGE)
+        {
+            mgmtData->numRetiring++;
+        }
+        else
+        {
+            releaseFrameData(bm, i);
+        }
+    }
+    if (mgmtData->numUsedFrames > numPages)
+    {
+        mgmtData->numUsedFrames = numPages;
+    }
+    if (mgmtData->queues != NULL && mgmtData->queues->target > numPages)
+    {
+        mgmtData->queues->target = numPages;
+    }
+    __atomic_store_n(&bm->numPages, numPages, __ATOMIC_RELEASE);
+    ringsResize(bm);
+    retireFrames(bm);
+}
+
+/*
+   Change the number of frames of the pool to numPages while it is in use, e.g. when a memory governor moves memory
+   between pools, without dropping the pages it caches. Growing sets up empty frames, which the next misses take; the
+   latch is held only while the bookkeeping is extended, and no pin waits for I/O or for a pinned page. Shrinking
+   retires the frames past numPages: no page goes into them any more, their unpinned pages are written back if dirty
+   and dropped before the call returns, and their pinned pages once unpinned, by the next miss, flush or background
+   writer round that finds them clean. Until then the pages stay usable. A partitioned pool spreads numPages over its
+   sub-pools as initBufferPoolPartitioned does. Returns RC_ERROR for a view, whose shared pool is resized instead, or
+   for numPages below 1 or above BM_MAX_POOL_PAGES (or the initial size, if that was larger)
+*/
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC result = RC_OK;
+    int retiring;
+
+    if (poolView(bm))
+    {
+        return RC_ERROR;
+    }
+    if (poolPartitioned(bm))
+    {
+        int p, total = 0;
+
+        if (numPages < mgmtData->numPartitions)
+        {
+            return RC_ERROR;
+        }
+        for (p = 0; p < mgmtData->numPartitions; p++)
+        {
+            int frames = numPages / mgmtData->numPartitions + (p < numPages % mgmtData->numPartitions ? 1 : 0);
+            RC partitionResult = resizeBufferPool(&mgmtData->partitions[p], frames);
+            if (partitionResult != RC_OK)
+            {
+                result = partitionResult;
+            }
+            total += mgmtData->partitions[p].numPages;
+        }
+        bm->numPages = total;
+        return result;
+    }
+    if (numPages < 1 || numPages > mgmtData->maxPages)
+    {
+        return RC_ERROR;
+    }
+
+    pthread_mutex_lock(&mgmtData->resizeLatch);
+    pthread_mutex_lock(&mgmtData->latch);
+    if (numPages > bm->numPages)
+    {
+        result = growFrames(bm, numPages);
+    }
+    else if (numPages < bm->numPages)
+    {
+        shrinkFrames(bm, numPages);
+    }
+    retiring = mgmtData->numRetiring;
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    // the dirty pages of the retired frames are written back, and flushPool drops them with the clean ones
+    if (retiring > 0)
+    {
+        result = flushPool(bm, -1, numPages);
+    }
+    pthread_mutex_unlock(&mgmtData->resizeLatch);
+    return result;
+}
+
+// Function to update page replacement information
+void updatePageReplacementInfo(BM_BufferPool *const bm, const int pageIndex)
+{
+    PageFrame *pageFrame = ((BM_MGMT_DATA *)bm->mgmtData)->frames;
+
+    if (bm->strategy == RS_LRU)
+    {
+        // LRU algorithm uses the value of hit to determine the least recently used page
+        pageFrame[pageIndex].hitNum = pageFrame[pageIndex].hitNum + 1;
+    }
+    else if (bm->strategy == RS_CLOCK)
+    {
+        // hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
+        pageFrame[pageIndex].hitNum = 1;
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        // Incrementing refNum, the count of the number of times the page is used (referenced), moves it to the next bucket
+        lfuReference(bm, pageIndex);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        // LRU-K keeps the times of the page's last K references
+        lrukReference(bm, pageIndex);
+    }
+    else if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        // ARC and 2Q move the page between their lists
+        queuesReference(bm, pageIndex);
+    }
+    else if (bm->strategy == RS_CLOCK_SWEEP)
+    {
+        // the usage count is lowered by the clock hand without the latch
+        sweepReference(bm, pageIndex);
+    }
+    // Add additional conditions for other replacement strategies if needed
+}
+
+// Function to apply page replacement strategy; returns the frame to evict for page pageNum, or -1 if there is none
+int applyPageReplacementStrategy(BM_BufferPool *const bm, const BM_PageKey pageNum)
+{
+    if (bm->strategy == RS_FIFO)
+    {
+        return FIFO(bm);
+    }
+    else if (bm->strategy == RS_LRU)
+    {
+        return LRU(bm);
+    }
+    else if (bm->strategy == RS_CLOCK)
+    {
+        return CLOCK(bm);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        return LFU(bm);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        return LRU_K(bm);
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        return ARC(bm, pageNum);
+    }
+    else if (bm->strategy == RS_2Q)
+    {
+        return TWO_Q(bm);
+    }
+    else
+    {
+        printf("\nAlgorithm Not Implemented\n");
+    }
+    return -1;
+}
+/*
+// Function to pin a page with a page number pageNum
+extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
+                  const PageNumber pageNum)
+{
+    PageFrame *pageFrame;
+    pageFrame = (PageFrame *)bm->mgmtData;
+
+    int isFirstPageInvalid = (pageFrame[0].pageNum == -1);
+
+    // Checking if the buffer pool is empty and this is the first page to be pinned
+    if (isFirstPageInvalid)
+    {
+        // Reading the page from disk and initializing the page frame's content in the buffer pool
+        SM_FileHandle fh;
+        openPageFile(bm->pageFile, &fh);
         pageFrame[0].data = (SM_PageHandle)malloc(PAGE_SIZE);
-        char *dataPointer;
         ensureCapacity(pageNum, &fh);
-        dataPointer = pageFrame[0].data;
-        readBlock(pageNum, &fh, dataPointer);
-
-        // Update the first page frame with new information
-        pageFrame[0].fixCount++;
-        pageFrame[0].refNum = 0;
+        readBlock(pageNum, &fh, pageFrame[0].data);
         pageFrame[0].pageNum = pageNum;
+        pageFrame[0].fixCount++;
         pageFrame[0].hitNum = 0;
-
-        // Update the page itself with the new page number
-
-        page->data = pageFrame[0].data;
+        pageFrame[0].refNum = 0;
         page->pageNum = pageNum;
+        page->data = pageFrame[0].data;
 
         return RC_OK;
     }
     else
     {
-
-        bool isBufferFull;
-        isBufferFull = !false;
         int i;
+        bool isBufferFull = true;
 
         for (i = 0; i < bm->numPages; i++)
         {
-            int isPageNumValid = (pageFrame[i].pageNum != -1);
-
-            if (isPageNumValid)
+            if (pageFrame[i].pageNum != -1)
             {
-                int isPageNumEqual = (pageFrame[i].pageNum == pageNum);
                 // Checking if the page is in memory
-                if (isPageNumEqual)
+                if (pageFrame[i].pageNum == pageNum)
                 {
                     // Increasing fixCount, i.e., now there is one more client accessing this page
                     pageFrame[i].fixCount++;
-                    isBufferFull = !true;
+                    isBufferFull = false;
 
                     // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
                     pageFrame[i].hitNum++;
@@ -340,8 +954,8 @@ extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
                     // Updating algorithm-specific values
                     updatePageReplacementInfo(bm, i);
 
-                    page->data = pageFrame[i].data;
                     page->pageNum = pageNum;
+                    page->data = pageFrame[i].data;
 
                     break;
                 }
@@ -351,23 +965,21 @@ extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
                 SM_FileHandle fh;
                 openPageFile(bm->pageFile, &fh);
                 pageFrame[i].data = (SM_PageHandle)malloc(PAGE_SIZE);
-                char *dataPointer = pageFrame[i].data;
-                readBlock(pageNum, &fh, dataPointer);
-
-                // Update page frame information
-                pageFrame[i].fixCount = 1;
+                readBlock(pageNum, &fh, pageFrame[i].data);
                 pageFrame[i].pageNum = pageNum;
-                pageFrame[i].hitNum++;
-
+                pageFrame[i].fixCount = 1;
                 pageFrame[i].refNum = 0;
 
+                // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
+                pageFrame[i].hitNum++;
+
                 // Updating algorithm-specific values
                 updatePageReplacementInfo(bm, i);
 
                 page->pageNum = pageNum;
                 page->data = pageFrame[i].data;
 
-                isBufferFull = !true;
+                isBufferFull = false;
                 break;
             }
         }
@@ -376,70 +988,881 @@ extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
         if (isBufferFull)
         {
             // Create a new page to store data read from the file.
-            PageFrame *newPage;
-            // newPage = (PageFrame *)malloc(sizeof(PageFrame));
-            size_t sizeOfPageFrame = sizeof(PageFrame);
-
-            // Allocate memory for a new PageFrame
-            newPage = (PageFrame *)malloc(sizeOfPageFrame);
-
-            char *pageFile;
+            PageFrame *newPage = (PageFrame *)malloc(sizeof(PageFrame));
 
             // Reading the page from disk and initializing the page frame's content in the buffer pool
             SM_FileHandle fh;
-
-            pageFile = bm->pageFile;
-            openPageFile(pageFile, &fh);
-
+            openPageFile(bm->pageFile, &fh);
             newPage->data = (SM_PageHandle)malloc(PAGE_SIZE);
-            char *dataPtr = newPage->data;
-            readBlock(pageNum, &fh, dataPtr);
-
-            // Update new page information
-            newPage->dirtyBit = 0;
+            readBlock(pageNum, &fh, newPage->data);
             newPage->pageNum = pageNum;
+            newPage->dirtyBit = 0;
+            newPage->fixCount = 1;
+            newPage->refNum = 0;
+
+            // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
             newPage->hitNum++;
 
-            newPage->refNum = 0;
-            newPage->fixCount = 1;
+            // Updating algorithm-specific values
+            updatePageReplacementInfo(bm, bm->numPages - 1);
+
+            page->pageNum = pageNum;
+            page->data = newPage->data;
+
+            // Call the appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
+            applyPageReplacementStrategy(bm, newPage);
+        }
+
+        return RC_OK;
+    }
+}
+*/
+
+// Pin the resident page in frame i once more, under the latch. A bulk access does not count as a reference to
+// the page; a normal one takes the page out of the ring it was read into
+static void referenceFrame(BM_BufferPool *const bm, const int i, BM_AccessStrategy access)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame = mgmtData->frames;
+
+    // Increasing fixCount, i.e., now there is one more client accessing this page
+    __atomic_add_fetch(&pageFrame[i].fixCount, 1, __ATOMIC_ACQ_REL);
+
+    // a frame retired by a shrink only keeps its page until it is unpinned
+    if (access != BM_ACCESS_NORMAL || i >= bm->numPages)
+    {
+        return;
+    }
+    if (mgmtData->frameRing != NULL)
+    {
+        mgmtData->frameRing[i] = -1;
+    }
+
+    // Incrementing hit (used by the LRU algorithm to determine the least recently used page);
+    // CLOCK_SWEEP keeps its usage count in hitNum and raises it itself
+    if (bm->strategy != RS_CLOCK_SWEEP)
+    {
+        pageFrame[i].hitNum++;
+    }
+
+    // Updating algorithm-specific values
+    updatePageReplacementInfo(bm, i);
+}
+
+// Give a frame to page pageNum, which is neither resident nor being written back. The frame is pinned once for
+// the caller, who must load it with loadFrame; pins of the page wait until then. *evicted is set to the dirty page
+// the frame held, or NO_PAGE. A bulk access takes the next frame of its ring, or one from the pool that joins the
+// ring. Called and returns with the latch held. Returns the frame, -1 if every frame is pinned, or -2 if the page
+// turned up while the latch was released and the caller must look it up again
+static int claimFrame(BM_BufferPool *const bm, const BM_PageKey pageNum, BM_AccessStrategy access,
+                      BM_PageKey *evicted)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame = mgmtData->frames;
+    bool bulk = access != BM_ACCESS_NORMAL, fromRing = false;
+    int i;
+
+    if (mgmtData->numRetiring > 0)
+    {
+        retireFrames(bm);
+    }
+    if (bulk && (i = ringFrame(bm, access)) >= 0)
+    {
+        // the ring's own frame, its page is replaced without asking the replacement strategy
+        fromRing = true;
+    }
+    else if (mgmtData->numUsedFrames < bm->numPages)
+    {
+        // Frames are filled in order, take the first one that was never used
+        i = mgmtData->numUsedFrames++;
+    }
+    else if (mgmtData->numFreeFrames > 0 && (i = takeFreeFrame(bm)) >= 0)
+    {
+        // a frame whose page was dropped, see dropFilePages, or one resizeBufferPool added
+    }
+    else if (bm->strategy != RS_CLOCK_SWEEP)
+    {
+        // The buffer is full, and we must replace an existing page using the page replacement strategy
+        i = applyPageReplacementStrategy(bm, pageNum);
+        if (i < 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        // CLOCK_SWEEP finds its victim without the latch. The claimed frame is taken unless its page was pinned
+        // or a shrink retired it while the latch was released; under the latch nobody else can pin it any more
+        pthread_mutex_unlock(&mgmtData->latch);
+        i = CLOCK_SWEEP(bm);
+        pthread_mutex_lock(&mgmtData->latch);
+        if (i < 0)
+        {
+            return -1;
+        }
+        if (__atomic_load_n(&pageFrame[i].fixCount, __ATOMIC_ACQUIRE) != 1 || i >= bm->numPages ||
+            pageTableLookup(&mgmtData->pageTable, pageNum) >= 0 ||
+            pageTableLookup(&mgmtData->writeBacks, pageNum) >= 0)
+        {
+            unpinFrame(mgmtData, i);
+            return -2;
+        }
+    }
+    if (bulk && !fromRing)
+    {
+        ringAdopt(bm, access, i);
+    }
+    else if (!bulk && mgmtData->frameRing != NULL)
+    {
+        mgmtData->frameRing[i] = -1;
+    }
+
+    // If page in memory has been modified (dirtyBit = 1), then it is written to disk before the new page is read
+    *evicted = NO_PAGE;
+    if (__atomic_load_n(&pageFrame[i].dirtyBit, __ATOMIC_ACQUIRE) == 1)
+    {
+        *evicted = pageFrame[i].pageNum;
+        pageTableInsert(&mgmtData->writeBacks, *evicted, i);
+        // the background writer fell behind
+        pthread_cond_signal(&mgmtData->writerWake);
+    }
+
+    // Update page frame information. The frame now belongs to pageNum, pins of the page wait until it is read
+    setFramePage(bm, i, pageNum);
+    __atomic_store_n(&pageFrame[i].dirtyBit, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&pageFrame[i].fixCount, 1, __ATOMIC_RELEASE);
+    // CLOCK_SWEEP lowers hitNum without the latch, and a page it loads starts at usage 1 once referenced below.
+    // A page read for a bulk access starts at 0, the first frame the frame-scanning strategies give up
+    __atomic_store_n(&pageFrame[i].hitNum, bm->strategy == RS_CLOCK_SWEEP || bulk ? 0 : 1, __ATOMIC_RELAXED);
+    pageFrame[i].refNum = 0;
+    pageFrame[i].ioInProgress = 1;
+
+    // Updating algorithm-specific values
+    if (bulk)
+    {
+        bulkReference(bm, i);
+    }
+    else
+    {
+        updatePageReplacementInfo(bm, i);
+    }
+    return i;
+}
+
+// Write back the page evicted from frame i by claimFrame, if it evicted one
+static RC writeEvicted(BM_BufferPool *const bm, const int i, const BM_PageKey evicted)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame old = {0};
+
+    if (evicted == NO_PAGE)
+    {
+        return RC_OK;
+    }
+    old.data = mgmtData->frames[i].data;
+    old.pageNum = evicted;
+    // Increase the writeCount which records the number of writes done by the buffer manager.
+    __atomic_add_fetch(&mgmtData->writeCount, 1, __ATOMIC_RELAXED);
+    return writePageToFile(bm, &old);
+}
+
+// The end of loadFrame, once the evicted page was written back, if written, and pageNum read with result
+static RC finishLoad(BM_BufferPool *const bm, const int i, const BM_PageKey pageNum, const BM_PageKey evicted,
+                     const bool written, const RC result, const bool prefetched)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame = mgmtData->frames;
+
+    pthread_mutex_lock(&mgmtData->latch);
+    if (evicted != NO_PAGE)
+    {
+        pageTableRemove(&mgmtData->writeBacks, evicted);
+    }
+    if (!written)
+    {
+        // The write-back failed: the frame keeps the evicted page, still dirty, and threads waiting for pageNum retry
+        setFramePage(bm, i, evicted);
+        pageFrame[i].dirtyBit = 1;
+    }
+    else if (result != RC_OK)
+    {
+        // The read failed: the frame is freed, threads waiting for pageNum retry and read it again themselves
+        if (mgmtData->frameRing != NULL)
+        {
+            mgmtData->frameRing[i] = -1;
+        }
+        dropFrame(bm, i);
+    }
+    if (result != RC_OK || prefetched)
+    {
+        unpinFrame(mgmtData, i);
+    }
+    if (result == RC_OK && prefetched)
+    {
+        __atomic_add_fetch(&mgmtData->prefetchPagesRead, 1, __ATOMIC_RELAXED);
+    }
+    if (result != RC_OK && prefetched)
+    {
+        __atomic_add_fetch(&mgmtData->prefetchErrors, 1, __ATOMIC_RELAXED);
+        mgmtData->prefetchFailedPage = pageNum;
+        mgmtData->prefetchFailure = result;
+    }
+    else if (result == RC_OK && mgmtData->prefetchFailedPage == pageNum)
+    {
+        mgmtData->prefetchFailedPage = NO_PAGE;
+    }
+    if (prefetched)
+    {
+        mgmtData->prefetchPending--;
+    }
+    pageFrame[i].ioInProgress = 0;
+    pthread_cond_broadcast(&mgmtData->ioDone);
+    pthread_mutex_unlock(&mgmtData->latch);
+    return result;
+}
+
+// Write back the page evicted from frame i by claimFrame and read pageNum into the frame, then let the pins
+// waiting for the page go on. Called without the latch. The pin claimFrame took is kept for the caller, unless the
+// read was started by prefetchPages; on failure the pin is dropped, and the frame gets the evicted page back if it
+// could not be written, or is freed if pageNum could not be read (e.g. RC_PAGE_CHECKSUM_MISMATCH), so that a page
+// read wrong never becomes resident
+static RC loadFrame(BM_BufferPool *const bm, const int i, const BM_PageKey pageNum, const BM_PageKey evicted,
+                    const bool prefetched)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC result = writeEvicted(bm, i, evicted);
+
+    // Reading the page from disk straight into the frame, which is reused in place
+    bool written = result == RC_OK;
+    if (written)
+    {
+        result = readPageFromFile(bm, pageNum, mgmtData->frames[i].data);
+    }
+    return finishLoad(bm, i, pageNum, evicted, written, result, prefetched);
+}
+
+// Function to pin a page with a page number pageNum. Safe for concurrent callers: the lookup and the choice of a
+// frame are made under the pool latch, the I/O of a miss after it is released
+extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
+                  const PageNumber pageNum)
+{
+    return pinPageWithAccess(bm, page, pageNum, BM_ACCESS_NORMAL);
+}
+
+// Pins the page with key pageNum in the pool bm, which is not partitioned, and sets page->data
+static RC pinKey(BM_BufferPool *const bm, BM_PageHandle *const page, const BM_PageKey pageNum,
+                 BM_AccessStrategy access)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame;
+    pageFrame = mgmtData->frames;
+    BM_PageKey evicted = NO_PAGE;
+    RC result;
+    int i;
+
+    pthread_mutex_lock(&mgmtData->latch);
+
+    // The frames get their data from one arena on the first pin, once the page size of the file is known
+    if ((result = allocFrameArena(bm)) != RC_OK ||
+        (access != BM_ACCESS_NORMAL && (result = ringsInit(bm)) != RC_OK))
+    {
+        pthread_mutex_unlock(&mgmtData->latch);
+        return result;
+    }
+
+    for (;;)
+    {
+        // Checking if the page is in memory: one page table lookup instead of a scan over all frames
+        i = pageTableLookup(&mgmtData->pageTable, pageNum);
+
+        if (i >= 0)
+        {
+            referenceFrame(bm, i, access);
+
+            // Another thread missed on the page and is reading it: wait for that read instead of reading it again
+            while (pageFrame[i].ioInProgress)
+            {
+                pthread_cond_wait(&mgmtData->ioDone, &mgmtData->latch);
+            }
+            if (pageFrame[i].pageNum != pageNum)
+            {
+                // the read was abandoned, see loadFrame. The last pin of a frame left empty returns it to the free
+                // frames, takeFreeFrame passed it over while it was pinned
+                unpinFrame(mgmtData, i);
+                if (pageFrame[i].pageNum == NO_PAGE && frameUnpinned(&pageFrame[i]) && i < bm->numPages)
+                {
+                    freeFrame(mgmtData, i);
+                }
+                continue;
+            }
+            pthread_mutex_unlock(&mgmtData->latch);
+
+            page->data = pageFrame[i].data;
+            return RC_OK;
+        }
+
+        // An evicted page that is still being written back cannot be read before the write is done
+        if (pageTableLookup(&mgmtData->writeBacks, pageNum) >= 0)
+        {
+            pthread_cond_wait(&mgmtData->ioDone, &mgmtData->latch);
+            continue;
+        }
+
+        i = claimFrame(bm, pageNum, access, &evicted);
+        if (i == -1 && mgmtData->prefetchPending > 0)
+        {
+            // frames pinned only for reads of the prefetcher, e.g. while a warm restart preloads a full pool, are
+            // given up as soon as the pages are in
+            pthread_cond_wait(&mgmtData->ioDone, &mgmtData->latch);
+            continue;
+        }
+        if (i == -1)
+        {
+            pthread_mutex_unlock(&mgmtData->latch);
+            return RC_NO_AVAILABLE_FRAME;
+        }
+        if (i >= 0)
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    if ((result = loadFrame(bm, i, pageNum, evicted, false)) != RC_OK)
+    {
+        return result;
+    }
+    page->data = pageFrame[i].data;
+    return RC_OK;
+}
+
+/*
+   Same as pinPage, for a caller that accesses many pages once, e.g. a table scan (BM_ACCESS_BULKREAD) or a bulk
+   load (BM_ACCESS_BULKWRITE). The pages it reads cycle through a small ring of frames of their own instead of
+   replacing the pages the replacement strategy keeps, and pinning a resident page does not count as a reference.
+   So one pass over a large table evicts at most the ring's frames. A bulk write ring is larger, since its frames
+   are written back as they are reused; a bulk read ring leaves a frame whose page was dirtied to the pool
+*/
+extern RC pinPageWithAccess(BM_BufferPool *const bm, BM_PageHandle *const page,
+                            const PageNumber pageNum, BM_AccessStrategy access)
+{
+    BM_BufferPool *pool;
+    BM_PageKey key;
+    RC result;
+
+    if (access < BM_ACCESS_NORMAL || access > BM_ACCESS_BULKWRITE)
+    {
+        return RC_ERROR;
+    }
+    if (poolPartitioned(bm))
+    {
+        BM_BufferPool *partition = poolPartition(bm, pageNum);
+        result = pinPageWithAccess(partition, page, pageNum, access);
+        // the sub-pools learn the page size of the file on their first pin
+        __atomic_store_n(&bm->pageSize, partition->pageSize, __ATOMIC_RELAXED);
+        return result;
+    }
+    // A view pins the page in its shared pool under the key of its file
+    if ((pool = pagePool(bm, pageNum, &key)) == NULL)
+    {
+        return RC_ERROR;
+    }
+    if ((result = pinKey(pool, page, key, access)) == RC_OK)
+    {
+        page->pageNum = pageNum;
+    }
+    return result;
+}
+
+// Count a read of the page keyed pageNum, for the pool and, in a shared pool, for its file
+static void countRead(BM_BufferPool *const bm, const BM_PageKey pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    __atomic_add_fetch(&mgmtData->numReadIO, 1, __ATOMIC_RELAXED);
+    if (mgmtData->files != NULL)
+    {
+        __atomic_add_fetch(&mgmtData->files[keyFile(pageNum)].numReadIO, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Start the read of page pageNum into frame i on the prefetcher's queue io; true if it was queued, the file's handle
+// is then held, see poolFile, until the read is reaped. A page past the end of the file reads as zeros at once, a
+// read the queue does not take (e.g. into a frame not aligned for SM_OPEN_DIRECT) is done right away
+static bool startPrefetchRead(BM_BufferPool *const bm, SM_AsyncQueue *io, const int i, const BM_PageKey pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageNumber filePage;
+    SM_FileHandle *fileHandle;
+    BM_SharedFile *file;
+    RC result = poolFile(bm, pageNum, &filePage, &fileHandle, &file);
+
+    if (result == RC_OK)
+    {
+        result = queueReadBlock(io, filePage, fileHandle, mgmtData->frames[i].data, (void *)(intptr_t)i);
+        if (result == RC_OK)
+        {
+            return true;
+        }
+        releasePoolFile(bm, pageNum);
+    }
+    if (result == RC_READ_NON_EXISTING_PAGE)
+    {
+        memset(mgmtData->frames[i].data, 0, bm->pageSize);
+        countRead(bm, pageNum);
+        finishLoad(bm, i, pageNum, NO_PAGE, true, RC_OK, true);
+    }
+    else
+    {
+        loadFrame(bm, i, pageNum, NO_PAGE, true);
+    }
+    return false;
+}
+
+// Finish the n prefetch reads reaped into done. The frame of each still holds the page claimFrame gave it
+static void finishPrefetchReads(BM_BufferPool *const bm, const SM_AsyncCompletion *done, int n)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    for (int k = 0; k < n; k++)
+    {
+        int i = (int)(intptr_t)done[k].userData;
+        BM_PageKey pageNum = __atomic_load_n(&mgmtData->frames[i].pageNum, __ATOMIC_ACQUIRE);
+        RC result = done[k].rc;
+
+        releasePoolFile(bm, pageNum);
+        if (result == RC_READ_NON_EXISTING_PAGE)
+        {
+            memset(done[k].memPage, 0, bm->pageSize);
+            result = RC_OK;
+        }
+        countRead(bm, pageNum);
+        finishLoad(bm, i, pageNum, NO_PAGE, true, result, true);
+    }
+}
+
+// Load the reads queued by prefetchPages until stopPrefetcher. Each batch is taken from the queue at once and
+// started in page-number order, so a prefetched run of pages reaches the storage manager as a sequential scan.
+// Up to BM_PREFETCH_DEPTH reads are under way at a time on an asynchronous queue of the storage manager; they are
+// reaped while the next batch is taken, and waited for only when there is none. Without a queue, and for a frame
+// whose dirty page must be written back first, the read is done right away as a miss does it
+static void *prefetcher(void *arg)
+{
+    BM_BufferPool *const bm = (BM_BufferPool *)arg;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    SM_AsyncCompletion done[BM_PREFETCH_DEPTH];
+    SM_AsyncQueue *io;
+    int k, n, inFlight = 0;
+
+    if (initAsyncQueue(&io, BM_PREFETCH_DEPTH, SM_ASYNC_AUTO) != RC_OK)
+    {
+        io = NULL;
+    }
+
+    pthread_mutex_lock(&mgmtData->latch);
+    for (;;)
+    {
+        while (mgmtData->prefetchCount == 0 && inFlight == 0 && !mgmtData->prefetcherStop)
+        {
+            pthread_cond_wait(&mgmtData->prefetchWake, &mgmtData->latch);
+        }
+        // queued reads hold pinned frames, so they are done even when stopping
+        if (mgmtData->prefetchCount == 0 && inFlight == 0)
+        {
+            break;
+        }
+        n = mgmtData->prefetchCount;
+        // resizeBufferPool grew the queue; should the batch not grow along, it is read in parts
+        if (n > mgmtData->prefetchBatchSize && growArray(&mgmtData->prefetchBatch, sizeof(BM_Prefetch), mgmtData->prefetchSize))
+        {
+            mgmtData->prefetchBatchSize = mgmtData->prefetchSize;
+        }
+        n = n < mgmtData->prefetchBatchSize ? n : mgmtData->prefetchBatchSize;
+        for (k = 0; k < n; k++)
+        {
+            mgmtData->prefetchBatch[k] = mgmtData->prefetchQueue[(mgmtData->prefetchHead + k) % mgmtData->prefetchSize];
+        }
+        mgmtData->prefetchHead = (mgmtData->prefetchHead + n) % mgmtData->prefetchSize;
+        mgmtData->prefetchCount -= n;
+        pthread_mutex_unlock(&mgmtData->latch);
+
+        qsort(mgmtData->prefetchBatch, n, sizeof(BM_Prefetch), comparePrefetches);
+        for (k = 0; k < n; k++)
+        {
+            BM_Prefetch *read = &mgmtData->prefetchBatch[k];
+            if (io == NULL || read->evicted != NO_PAGE)
+            {
+                loadFrame(bm, read->frame, read->pageNum, read->evicted, true);
+                continue;
+            }
+            if (inFlight == BM_PREFETCH_DEPTH)
+            {
+                submitAsyncQueue(io);
+                int reaped = reapCompletions(io, done, BM_PREFETCH_DEPTH, 1);
+                finishPrefetchReads(bm, done, reaped);
+                inFlight -= reaped;
+            }
+            inFlight += startPrefetchRead(bm, io, read->frame, read->pageNum);
+        }
+        if (inFlight > 0)
+        {
+            submitAsyncQueue(io);
+            int reaped = reapCompletions(io, done, BM_PREFETCH_DEPTH, n == 0 ? 1 : 0);
+            finishPrefetchReads(bm, done, reaped);
+            inFlight -= reaped;
+        }
+        pthread_mutex_lock(&mgmtData->latch);
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+    shutdownAsyncQueue(io);
+    return NULL;
+}
+
+// Queue a read of page pageNum for the prefetcher unless the page is resident or on its way, starting the
+// prefetcher on first use. Called with the latch held
+static RC prefetchPage(BM_BufferPool *const bm, const BM_PageKey pageNum, BM_AccessStrategy access)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_PageKey evicted;
+    BM_Prefetch *read;
+    int i;
+
+    if (!mgmtData->prefetcherRunning)
+    {
+        mgmtData->prefetchQueue = (BM_Prefetch *)malloc(sizeof(BM_Prefetch) * mgmtData->numFrames);
+        mgmtData->prefetchBatch = (BM_Prefetch *)malloc(sizeof(BM_Prefetch) * mgmtData->numFrames);
+        if (mgmtData->prefetchQueue == NULL || mgmtData->prefetchBatch == NULL)
+        {
+            free(mgmtData->prefetchQueue);
+            free(mgmtData->prefetchBatch);
+            mgmtData->prefetchQueue = mgmtData->prefetchBatch = NULL;
+            return RC_MEMORY_ALLOCATION_FAILED;
+        }
+        mgmtData->prefetchSize = mgmtData->prefetchBatchSize = mgmtData->numFrames;
+        mgmtData->prefetchHead = 0;
+        mgmtData->prefetcherStop = 0;
+        if (pthread_create(&mgmtData->prefetcher, NULL, prefetcher, bm) != 0)
+        {
+            free(mgmtData->prefetchQueue);
+            free(mgmtData->prefetchBatch);
+            mgmtData->prefetchQueue = mgmtData->prefetchBatch = NULL;
+            return RC_ERROR;
+        }
+        mgmtData->prefetcherRunning = 1;
+    }
+
+    do
+    {
+        if (pageTableLookup(&mgmtData->pageTable, pageNum) >= 0 ||
+            pageTableLookup(&mgmtData->writeBacks, pageNum) >= 0)
+        {
+            return RC_OK;
+        }
+        i = claimFrame(bm, pageNum, access, &evicted);
+    } while (i == -2);
+    if (i < 0)
+    {
+        return RC_NO_AVAILABLE_FRAME;
+    }
+
+    read = &mgmtData->prefetchQueue[(mgmtData->prefetchHead + mgmtData->prefetchCount) % mgmtData->prefetchSize];
+    read->frame = i;
+    read->pageNum = pageNum;
+    read->evicted = evicted;
+    mgmtData->prefetchCount++;
+    mgmtData->prefetchPending++;
+    pthread_cond_signal(&mgmtData->prefetchWake);
+    return RC_OK;
+}
+
+// Claim frames for the n warm pages of a pool that holds its frames itself, in their order, so that the replacement
+// state takes them up from the least to the most recently referenced, and give the frames the pages' counts if
+// sameStrategy. Only the most recent pages fit into a smaller pool, pages past the end of the file are left out.
+// The prefetcher gets all reads as one batch once the latch is released and reads them in page order
+static void warmPool(BM_BufferPool *const bm, const BM_WarmPage *pages, int n, bool sameStrategy)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int k, first = n > bm->numPages ? n - bm->numPages : 0;
+
+    pthread_mutex_lock(&mgmtData->latch);
+    if (allocFrameArena(bm) == RC_OK)
+    {
+        for (k = first; k < n; k++)
+        {
+            if (pages[k].pageNum >= 0 && pages[k].pageNum < mgmtData->fileHandle.totalNumPages &&
+                prefetchPage(bm, pages[k].pageNum, BM_ACCESS_NORMAL) != RC_OK)
+            {
+                break;
+            }
+        }
+        if (sameStrategy)
+        {
+            warmRestore(bm, pages + first, k - first);
+        }
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+}
+
+// Start preloading the pages recorded in the warm restart file of the pool's page file; a partitioned pool hands
+// each sub-pool its pages. Without a file, or one that is not whole, the pool starts cold
+static void warmStart(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_WarmHeader header;
+    BM_WarmPage *pages = readWarmFile(bm->pageFile, &header);
+    bool sameStrategy;
+    int k, m, p;
+
+    if (pages == NULL)
+    {
+        return;
+    }
+    sameStrategy = header.strategy == (int)bm->strategy;
+    if (!poolPartitioned(bm))
+    {
+        warmPool(bm, pages, header.numPages, sameStrategy);
+        free(pages);
+        return;
+    }
+
+    BM_WarmPage *partitionPages = (BM_WarmPage *)malloc(sizeof(BM_WarmPage) * (header.numPages > 0 ? header.numPages : 1));
+    for (p = 0; partitionPages != NULL && p < mgmtData->numPartitions; p++)
+    {
+        for (k = 0, m = 0; k < header.numPages; k++)
+        {
+            if (pages[k].pageNum >= 0 && poolPartition(bm, pages[k].pageNum) == &mgmtData->partitions[p])
+            {
+                partitionPages[m++] = pages[k];
+            }
+        }
+        warmPool(&mgmtData->partitions[p], partitionPages, m, sameStrategy);
+    }
+    free(partitionPages);
+    free(pages);
+}
+
+// Record the pages resident in the pool in its warm restart file, at shutdown once no page is pinned. Each
+// sub-pool of a partitioned pool adds its pages in its own order
+static void warmSave(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_WarmPage *pages = (BM_WarmPage *)malloc(sizeof(BM_WarmPage) * bm->numPages);
+    int n = 0;
+
+    if (pages == NULL)
+    {
+        return;
+    }
+    if (poolPartitioned(bm))
+    {
+        for (int p = 0; p < mgmtData->numPartitions; p++)
+        {
+            BM_BufferPool *partition = &mgmtData->partitions[p];
+            BM_MGMT_DATA *partitionData = (BM_MGMT_DATA *)partition->mgmtData;
+            pthread_mutex_lock(&partitionData->latch);
+            n += warmOrder(partition, pages + n);
+            pthread_mutex_unlock(&partitionData->latch);
+        }
+    }
+    else
+    {
+        pthread_mutex_lock(&mgmtData->latch);
+        n = warmOrder(bm, pages);
+        pthread_mutex_unlock(&mgmtData->latch);
+    }
+    writeWarmFile(bm->pageFile, bm->strategy, pages, n);
+    free(pages);
+}
+
+// Start reading the n pages pageNums into the pool without pinning them or waiting for the reads. Each page gets
+// a free frame or one the replacement strategy gives up, as on a miss; pages already in the pool are skipped. A pin
+// of a page whose read is under way waits for it. Returns RC_NO_AVAILABLE_FRAME, after starting the reads it could,
+// when every frame is pinned
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber *pageNums, const int n)
+{
+    return prefetchPagesWithAccess(bm, pageNums, n, BM_ACCESS_NORMAL);
+}
+
+// Same as prefetchPages, for a caller that pins the pages with pinPageWithAccess: the reads of a bulk access go to
+// its ring, which must be larger than the number of pages read ahead for them to stay until they are pinned
+RC prefetchPagesWithAccess(BM_BufferPool *const bm, const PageNumber *pageNums, const int n,
+                           BM_AccessStrategy access)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    RC result = RC_OK;
+    int k;
+
+    if (n < 0 || (n > 0 && pageNums == NULL) || access < BM_ACCESS_NORMAL || access > BM_ACCESS_BULKWRITE)
+    {
+        return RC_ERROR;
+    }
+    for (k = 0; k < n; k++)
+    {
+        if (pageNums[k] < 0)
+        {
+            return RC_ERROR;
+        }
+    }
+
+    if (poolPartitioned(bm))
+    {
+        // a full sub-pool does not keep the others from reading their pages
+        for (k = 0; k < n; k++)
+        {
+            BM_BufferPool *partition = poolPartition(bm, pageNums[k]);
+            RC partitionResult = prefetchPagesWithAccess(partition, &pageNums[k], 1, access);
+            __atomic_store_n(&bm->pageSize, partition->pageSize, __ATOMIC_RELAXED);
+            if (partitionResult != RC_OK)
+            {
+                result = partitionResult;
+            }
+        }
+        return result;
+    }
+
+    // A view reads the pages into its shared pool under the keys of its file
+    BM_BufferPool *pool = poolView(bm) ? viewPool(bm) : bm;
+    BM_MGMT_DATA *poolData = (BM_MGMT_DATA *)pool->mgmtData;
+    BM_PageKey key;
+
+    pthread_mutex_lock(&poolData->latch);
+    result = allocFrameArena(pool);
+    if (result == RC_OK && access != BM_ACCESS_NORMAL)
+    {
+        result = ringsInit(pool);
+    }
+    for (k = 0; k < n && result == RC_OK; k++)
+    {
+        pagePool(bm, pageNums[k], &key);
+        result = prefetchPage(pool, key, access);
+    }
+    pthread_mutex_unlock(&poolData->latch);
+    return result;
+}
+
+// Pin page pageNum if it is in the pool and loaded, without waiting otherwise: then its read is started as by
+// prefetchPages and RC_PAGE_NOT_READY returned, and the page is not pinned. Try again later, or pinPage to wait.
+// Should the read fail, e.g. with RC_PAGE_CHECKSUM_MISMATCH, the next call for the page returns its RC
+RC pinPageAsync(BM_BufferPool *const bm, BM_PageHandle *const page,
+                const PageNumber pageNum)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    RC result;
+    int i;
+
+    if (page == NULL || pageNum < 0)
+    {
+        return RC_ERROR;
+    }
+    if (poolPartitioned(bm))
+    {
+        BM_BufferPool *partition = poolPartition(bm, pageNum);
+        result = pinPageAsync(partition, page, pageNum);
+        __atomic_store_n(&bm->pageSize, partition->pageSize, __ATOMIC_RELAXED);
+        return result;
+    }
 
-            // Incrementing hit (used by the LRU algorithm to determine the least recently used page)
+    // A view pins the page in its shared pool under the key of its file
+    BM_PageKey key;
+    BM_BufferPool *pool = pagePool(bm, pageNum, &key);
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    PageFrame *pageFrame = mgmtData->frames;
 
-            // Updating algorithm-specific values
-            updatePageReplacementInfo(bm, bm->numPages - 1);
+    pthread_mutex_lock(&mgmtData->latch);
+    if ((result = allocFrameArena(pool)) != RC_OK)
+    {
+        pthread_mutex_unlock(&mgmtData->latch);
+        return result;
+    }
+    i = pageTableLookup(&mgmtData->pageTable, key);
+    if (i >= 0 && !pageFrame[i].ioInProgress)
+    {
+        referenceFrame(pool, i, BM_ACCESS_NORMAL);
+        pthread_mutex_unlock(&mgmtData->latch);
 
-            page->pageNum = pageNum;
-            page->data = newPage->data;
+        page->data = pageFrame[i].data;
+        page->pageNum = pageNum;
+        return RC_OK;
+    }
+    if (i < 0 && mgmtData->prefetchFailedPage == key)
+    {
+        // the read this call started failed; reported once, the next call reads the page again
+        mgmtData->prefetchFailedPage = NO_PAGE;
+        pthread_mutex_unlock(&mgmtData->latch);
+        return mgmtData->prefetchFailure;
+    }
+    if (i < 0)
+    {
+        result = prefetchPage(pool, key, BM_ACCESS_NORMAL);
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+    return result != RC_OK ? result : RC_PAGE_NOT_READY;
+}
 
-            // Call the appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
-            applyPageReplacementStrategy(bm, newPage);
-        }
+// Wait for the prefetcher to finish the reads it has been given and stop it
+static void stopPrefetcher(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
-        return RC_OK;
+    pthread_mutex_lock(&mgmtData->latch);
+    if (!mgmtData->prefetcherRunning)
+    {
+        pthread_mutex_unlock(&mgmtData->latch);
+        return;
     }
+    mgmtData->prefetcherStop = 1;
+    pthread_cond_signal(&mgmtData->prefetchWake);
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    pthread_join(mgmtData->prefetcher, NULL);
+    mgmtData->prefetcherRunning = 0;
+    free(mgmtData->prefetchQueue);
+    free(mgmtData->prefetchBatch);
+    mgmtData->prefetchQueue = mgmtData->prefetchBatch = NULL;
 }
 
 // Author: Pradaap Shiva Kumar Shobha
 
 // Helper function to find a page's index in the buffer pool
-int findPageIndex(BM_MGMT_DATA *mgmtData, int targetPageNum, BM_BufferPool *const bm)
+int findPageIndex(BM_MGMT_DATA *mgmtData, BM_PageKey targetPageNum)
 {
-    // Pointer to the array of PAGE_FRAME
-    PAGE_FRAME *frames = mgmtData->frames;
-    // Total number of pages in the buffer manager
-    int numPages = bm->numPages;
+    int frameIndex;
 
-    for (int i = 0; i < numPages; i++)
+    // The page table maps the page number to its frame, or gives -1 if the page is not in the pool
+    pthread_mutex_lock(&mgmtData->latch);
+    frameIndex = pageTableLookup(&mgmtData->pageTable, targetPageNum);
+    pthread_mutex_unlock(&mgmtData->latch);
+    return frameIndex;
+}
+
+// Frame of a page the caller has pinned. The handle's data points into a chunk of the frame arena, which gives the
+// frame without taking the pool latch; handles that do not point at their page's frame fall back to the page table
+static int handleFrame(BM_MGMT_DATA *mgmtData, BM_PageHandle *const page, const BM_PageKey key,
+                       BM_BufferPool *const bm)
+{
+    int numChunks = __atomic_load_n(&mgmtData->numChunks, __ATOMIC_ACQUIRE);
+
+    for (int c = 0; c < numChunks; c++)
     {
-        // Checking if the current page's pageNum matching the targetPageNum
-        if (frames[i].pageNum == targetPageNum)
+        BM_ArenaChunk *chunk = &mgmtData->arena[c];
+        if (page->data >= chunk->data && page->data < chunk->data + (size_t)chunk->numFrames * bm->pageSize)
         {
-            // If a match is found, return the index of the page in the buffer
-            return i; // Page found, return its index
+            int frameIndex = chunk->firstFrame + (page->data - chunk->data) / bm->pageSize;
+            if ((page->data - chunk->data) % bm->pageSize == 0 &&
+                __atomic_load_n(&mgmtData->frames[frameIndex].pageNum, __ATOMIC_ACQUIRE) == key)
+            {
+                return frameIndex;
+            }
+            break;
         }
     }
-
-    return -1; // Page not found
+    return findPageIndex(mgmtData, key);
 }
 
 RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
@@ -449,10 +1872,21 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
     {
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
+    if (poolPartitioned(bm))
+    {
+        return markDirty(poolPartition(bm, page->pageNum), page);
+    }
+    // A view finds the page in its shared pool under the key of its file
+    BM_PageKey key;
+    BM_BufferPool *pool = pagePool(bm, page->pageNum, &key);
+    if (pool == NULL)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
     // Get the mgmtData pointer from the buffer pool
-    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
     // Find the index of the frame that contains the page with the specified page number.
-    int frameIndex = findPageIndex(mgmtData, page->pageNum, bm);
+    int frameIndex = handleFrame(mgmtData, page, key, pool);
 
     // If the frame index is -1, it means the page does not exist in the buffer pool.
     if (frameIndex == -1)
@@ -461,7 +1895,7 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
     }
 
     // Mark the page as dirty
-    mgmtData->frames[frameIndex].isDirty = true;
+    __atomic_store_n(&mgmtData->frames[frameIndex].dirtyBit, 1, __ATOMIC_RELEASE);
 
     return RC_OK;
 }
@@ -473,11 +1907,20 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
     {
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
-
+    if (poolPartitioned(bm))
+    {
+        return unpinPage(poolPartition(bm, page->pageNum), page);
+    }
+    BM_PageKey key;
+    BM_BufferPool *pool = pagePool(bm, page->pageNum, &key);
+    if (pool == NULL)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
     // Get the mgmtData pointer from the buffer pool
-    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
     // Find the index of the frame that contains the page with the specified page number.
-    int frameIndex = findPageIndex(mgmtData, page->pageNum, bm);
+    int frameIndex = handleFrame(mgmtData, page, key, pool);
 
     // If the frameIndex is -1, it means the page doesn't exist in the buffer pool.
     if (frameIndex == -1)
@@ -486,10 +1929,7 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
     }
     // Check if the page is currently pinned (fixCount > 0)
     // if yes, decrement the fixCount.
-    if (mgmtData->frames[frameIndex].fixCount > 0)
-    {
-        mgmtData->frames[frameIndex].fixCount--;
-    }
+    unpinFrame(mgmtData, frameIndex);
 
     return RC_OK;
 }
@@ -501,24 +1941,190 @@ RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
     {
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
+    if (poolPartitioned(bm))
+    {
+        return forcePage(poolPartition(bm, page->pageNum), page);
+    }
+    BM_PageKey key;
+    BM_BufferPool *pool = pagePool(bm, page->pageNum, &key);
+    if (pool == NULL)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
     // Get the mgmtData pointer from the buffer pool
-    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
-    // Find the index of the frame that contains the page with the specified page number.
-    int frameIndex = findPageIndex(mgmtData, page->pageNum, bm);
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    // Find the index of the frame that contains the page with the specified page number, and pin it so that it
+    // stays there while it is written
+    pthread_mutex_lock(&mgmtData->latch);
+    int frameIndex = pageTableLookup(&mgmtData->pageTable, key);
     // If the frameIndex is -1, it means the page doesn't exist in the buffer pool.
     if (frameIndex == -1)
+    {
+        pthread_mutex_unlock(&mgmtData->latch);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    __atomic_add_fetch(&mgmtData->frames[frameIndex].fixCount, 1, __ATOMIC_ACQ_REL);
+    while (mgmtData->frames[frameIndex].ioInProgress)
+    {
+        pthread_cond_wait(&mgmtData->ioDone, &mgmtData->latch);
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    // Write the page back to disk, counting the write and marking the page as not dirty; a page whose write
+    // did not succeed stays dirty
+    RC result = flushFrame(pool, frameIndex);
+    unpinFrame(mgmtData, frameIndex);
+
+    return result;
+}
+
+// Latch the frame of a pinned page, shared to read the page or exclusive to change it. Threads that share pages
+// change them only under the exclusive latch; forcePage and forceFlushPool take the latch shared, so they must not
+// be called while the caller holds it exclusive
+RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolPartitioned(bm))
+    {
+        return latchPage(poolPartition(bm, page->pageNum), page, exclusive);
+    }
+    BM_PageKey key;
+    BM_BufferPool *pool = pagePool(bm, page->pageNum, &key);
+    if (pool == NULL)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    int frameIndex = handleFrame(mgmtData, page, key, pool);
+    if (frameIndex == -1)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    if (exclusive)
+    {
+        pthread_rwlock_wrlock(&mgmtData->frameLatches[frameIndex]);
+    }
+    else
+    {
+        pthread_rwlock_rdlock(&mgmtData->frameLatches[frameIndex]);
+    }
+    return RC_OK;
+}
+
+RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolPartitioned(bm))
+    {
+        return unlatchPage(poolPartition(bm, page->pageNum), page);
+    }
+    BM_PageKey key;
+    BM_BufferPool *pool = pagePool(bm, page->pageNum, &key);
+    if (pool == NULL)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)pool->mgmtData;
+    int frameIndex = handleFrame(mgmtData, page, key, pool);
+    if (frameIndex == -1)
     {
         return RC_READ_NON_EXISTING_PAGE;
     }
-    // Get a reference to the frame in which the page is stored.
-    PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
-    // Write the page back to disk
-    writePageToFile(bm, frame);
-    // Increment the count of write I/O operations.
-    mgmtData->numWriteIO++;
-    // Mark the page as not dirty after it has been written back to disk
-    frame->isDirty = false;
 
+    pthread_rwlock_unlock(&mgmtData->frameLatches[frameIndex]);
+    return RC_OK;
+}
+
+// Start a thread that writes dirty unpinned pages back ahead of the replacement strategy, in page-number order
+// and batched through writeBlocks, so that pins rarely write back a victim themselves. params may be NULL for the
+// defaults. A partitioned pool starts one writer per sub-pool, a view the one of its shared pool; shutdownBufferPool
+// stops them
+RC startBackgroundWriter(BM_BufferPool *const bm, const BM_WriterParams *params)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC result = RC_OK;
+
+    if (params != NULL && (params->cleanFraction < 0 || params->cleanFraction > 1 || params->intervalMs <= 0 || params->maxPages <= 0))
+    {
+        return RC_ERROR;
+    }
+    if (poolView(bm))
+    {
+        return startBackgroundWriter(mgmtData->sharedPool, params);
+    }
+    if (poolPartitioned(bm))
+    {
+        for (int p = 0; p < mgmtData->numPartitions && result == RC_OK; p++)
+        {
+            result = startBackgroundWriter(&mgmtData->partitions[p], params);
+        }
+        return result;
+    }
+
+    pthread_mutex_lock(&mgmtData->latch);
+    if (mgmtData->writerRunning)
+    {
+        pthread_mutex_unlock(&mgmtData->latch);
+        return RC_OK;
+    }
+    mgmtData->writerParams.cleanFraction = params != NULL ? params->cleanFraction : BM_WRITER_DEFAULT_CLEAN_FRACTION;
+    mgmtData->writerParams.intervalMs = params != NULL ? params->intervalMs : BM_WRITER_DEFAULT_INTERVAL_MS;
+    mgmtData->writerParams.maxPages = params != NULL ? params->maxPages : BM_WRITER_DEFAULT_MAX_PAGES;
+    mgmtData->writerStop = 0;
+    if (pthread_create(&mgmtData->writer, NULL, backgroundWriter, bm) != 0)
+    {
+        result = RC_ERROR;
+    }
+    mgmtData->writerRunning = result == RC_OK;
+    pthread_mutex_unlock(&mgmtData->latch);
+    return result;
+}
+
+// Stop the background writer and wait for its round to finish; pages it has not written yet stay dirty
+RC stopBackgroundWriter(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    if (poolView(bm))
+    {
+        return stopBackgroundWriter(mgmtData->sharedPool);
+    }
+    if (poolPartitioned(bm))
+    {
+        for (int p = 0; p < mgmtData->numPartitions; p++)
+        {
+            stopBackgroundWriter(&mgmtData->partitions[p]);
+        }
+        return RC_OK;
+    }
+
+    pthread_mutex_lock(&mgmtData->latch);
+    if (!mgmtData->writerRunning)
+    {
+        pthread_mutex_unlock(&mgmtData->latch);
+        return RC_OK;
+    }
+    mgmtData->writerStop = 1;
+    pthread_cond_signal(&mgmtData->writerWake);
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    pthread_join(mgmtData->writer, NULL);
+    mgmtData->writerRunning = 0;
     return RC_OK;
 }
 
@@ -529,6 +2135,21 @@ PageNumber *getFrameContents(BM_BufferPool *const bm)
     {
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
+    // A view lists the frames of its shared pool, those that hold pages of other files as empty; it has as many
+    // frames as the shared pool, which may have been resized since it was attached
+    if (poolView(bm))
+    {
+        BM_MGMT_DATA *shared = (BM_MGMT_DATA *)viewPool(bm)->mgmtData;
+        bm->numPages = viewPool(bm)->numPages;
+        PageNumber *contents = malloc(bm->numPages * sizeof(PageNumber));
+        for (int i = 0; contents != NULL && i < bm->numPages; i++)
+        {
+            BM_PageKey key = shared->frames[i].pageNum;
+            bool owned = key != NO_PAGE && keyFile(key) == ((BM_MGMT_DATA *)bm->mgmtData)->fileId;
+            contents[i] = owned ? keyPage(key) : NO_PAGE;
+        }
+        return contents;
+    }
     // Get the mgmtData pointer from the buffer pool
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
     // Total number of pages in the buffer manager
@@ -536,10 +2157,23 @@ PageNumber *getFrameContents(BM_BufferPool *const bm)
     // Allocate memory for an array of PageNumber to store page numbers
     PageNumber *pageNumbers = malloc(numPages * sizeof(PageNumber));
 
+    // A partitioned pool lists the frames of its sub-pools one after the other
+    if (poolPartitioned(bm) && pageNumbers != NULL)
+    {
+        for (int p = 0, offset = 0; p < mgmtData->numPartitions; offset += mgmtData->partitions[p++].numPages)
+        {
+            PageNumber *contents = getFrameContents(&mgmtData->partitions[p]);
+            memcpy(pageNumbers + offset, contents, mgmtData->partitions[p].numPages * sizeof(PageNumber));
+            free(contents);
+        }
+        return pageNumbers;
+    }
+
     for (int i = 0; i < numPages; i++)
     {
-        // Array stores the pagenumber
-        pageNumbers[i] = mgmtData->frames[i].pageNum;
+        // Array stores the pagenumber; a shared pool keys its frames by file as well
+        BM_PageKey key = mgmtData->frames[i].pageNum;
+        pageNumbers[i] = mgmtData->files != NULL ? keyPage(key) : (PageNumber)key;
     }
 
     return pageNumbers;
@@ -559,6 +2193,11 @@ bool *getDirtyFlags(BM_BufferPool *const bm)
     //   store bufferpool's data in mgmtData
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
+    // a view has as many frames as its shared pool, see getFrameContents
+    if (poolView(bm))
+    {
+        bm->numPages = viewPool(bm)->numPages;
+    }
     //   numpages stores number of pages
     int numPages = bm->numPages;
 
@@ -571,14 +2210,38 @@ bool *getDirtyFlags(BM_BufferPool *const bm)
         return NULL;
     }
 
-    // frames of type PAGE_FRAME to store the frames from the buffer pool
-    PAGE_FRAME *frames;
+    // A view lists the frames of its shared pool, those that hold pages of other files as clean
+    if (poolView(bm))
+    {
+        bool *flags = getDirtyFlags(viewPool(bm));
+        for (int i = 0; flags != NULL && i < numPages; i++)
+        {
+            dirtyFlags[i] = flags[i] && viewFrameOwned(bm, i);
+        }
+        free(flags);
+        return dirtyFlags;
+    }
+
+    // A partitioned pool lists the frames of its sub-pools one after the other
+    if (poolPartitioned(bm))
+    {
+        for (int p = 0, offset = 0; p < mgmtData->numPartitions; offset += mgmtData->partitions[p++].numPages)
+        {
+            bool *flags = getDirtyFlags(&mgmtData->partitions[p]);
+            memcpy(dirtyFlags + offset, flags, mgmtData->partitions[p].numPages * sizeof(bool));
+            free(flags);
+        }
+        return dirtyFlags;
+    }
+
+    // frames of type PageFrame to store the frames from the buffer pool
+    PageFrame *frames;
     frames = mgmtData->frames;
 
     // Iterating through the frames to populate dirtyFlags
     for (int i = 0; i < numPages; i++)
     {
-        dirtyFlags[i] = frames[i].isDirty;
+        dirtyFlags[i] = __atomic_load_n(&frames[i].dirtyBit, __ATOMIC_RELAXED) == 1;
     }
 
     return dirtyFlags;
@@ -599,11 +2262,16 @@ int *getFixCounts(BM_BufferPool *const bm)
     BM_MGMT_DATA *mgmtData;
     mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
+    // a view has as many frames as its shared pool, see getFrameContents
+    if (poolView(bm))
+    {
+        bm->numPages = viewPool(bm)->numPages;
+    }
     //  numPages stores number of pages
     int numPages = bm->numPages;
 
-    // frames of type PAGE_FRAME to store the frames from the buffer pool
-    PAGE_FRAME *frames = mgmtData->frames;
+    // frames of type PageFrame to store the frames from the buffer pool
+    PageFrame *frames = mgmtData->frames;
 
     // integer array to store the fixcounts
     int *fixCounts = (int *)malloc(numPages * sizeof(int));
@@ -614,11 +2282,35 @@ int *getFixCounts(BM_BufferPool *const bm)
         return NULL;
     }
 
+    // A view lists the frames of its shared pool, those that hold pages of other files as unpinned
+    if (poolView(bm))
+    {
+        int *counts = getFixCounts(viewPool(bm));
+        for (int i = 0; counts != NULL && i < numPages; i++)
+        {
+            fixCounts[i] = viewFrameOwned(bm, i) ? counts[i] : 0;
+        }
+        free(counts);
+        return fixCounts;
+    }
+
+    // A partitioned pool lists the frames of its sub-pools one after the other
+    if (poolPartitioned(bm))
+    {
+        for (int p = 0, offset = 0; p < mgmtData->numPartitions; offset += mgmtData->partitions[p++].numPages)
+        {
+            int *counts = getFixCounts(&mgmtData->partitions[p]);
+            memcpy(fixCounts + offset, counts, mgmtData->partitions[p].numPages * sizeof(int));
+            free(counts);
+        }
+        return fixCounts;
+    }
+
     // for loop iterates numPages times
     // copy the fix counts from the frames into the fixCounts array
     for (int i = 0; i < numPages; i++)
     {
-        fixCounts[i] = frames[i].fixCount;
+        fixCounts[i] = __atomic_load_n(&frames[i].fixCount, __ATOMIC_RELAXED);
     }
 
     return fixCounts;
@@ -636,8 +2328,21 @@ int getNumReadIO(BM_BufferPool *const bm)
     //  get a pointer to the management data of the buffer pool.
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
+    // A view counts the reads of its file
+    if (poolView(bm))
+    {
+        BM_MGMT_DATA *pool = (BM_MGMT_DATA *)viewPool(bm)->mgmtData;
+        return __atomic_load_n(&pool->files[mgmtData->fileId].numReadIO, __ATOMIC_RELAXED);
+    }
+
     // store the number of read I/O operations from the management data.
-    int numReadIO = mgmtData->numReadIO;
+    int numReadIO = __atomic_load_n(&mgmtData->numReadIO, __ATOMIC_RELAXED);
+
+    // A partitioned pool reads through its sub-pools
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        numReadIO += getNumReadIO(&mgmtData->partitions[p]);
+    }
 
     return numReadIO;
 }
@@ -653,8 +2358,124 @@ int getNumWriteIO(BM_BufferPool *const bm)
     //   get a pointer to the management data of the buffer pool.
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
+    // A view counts the writes to its file
+    if (poolView(bm))
+    {
+        BM_MGMT_DATA *pool = (BM_MGMT_DATA *)viewPool(bm)->mgmtData;
+        return __atomic_load_n(&pool->files[mgmtData->fileId].numWriteIO, __ATOMIC_RELAXED);
+    }
+
     //  store the number of write I/O operations from the management data.
-    int numWriteIO = mgmtData->numWriteIO;
+    int numWriteIO = __atomic_load_n(&mgmtData->numWriteIO, __ATOMIC_RELAXED);
+
+    // A partitioned pool writes through its sub-pools
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        numWriteIO += getNumWriteIO(&mgmtData->partitions[p]);
+    }
 
     return numWriteIO;
-}
\ No newline at end of file
+}
+
+// Pages a pin had to write back itself before it could reuse the frame of a dirty victim
+int getNumEvictionWrites(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolView(bm))
+    {
+        return getNumEvictionWrites(viewPool(bm));
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int writes = __atomic_load_n(&mgmtData->writeCount, __ATOMIC_RELAXED);
+
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        writes += getNumEvictionWrites(&mgmtData->partitions[p]);
+    }
+    return writes;
+}
+
+// Pages written by the background writer; they are also counted by getNumWriteIO
+int getNumWriterPages(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolView(bm))
+    {
+        return getNumWriterPages(viewPool(bm));
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int pages = __atomic_load_n(&mgmtData->writerPages, __ATOMIC_RELAXED);
+
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        pages += getNumWriterPages(&mgmtData->partitions[p]);
+    }
+    return pages;
+}
+
+// writeBlocks calls of the background writer, each writing a run of consecutive pages
+int getNumWriterBatches(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolView(bm))
+    {
+        return getNumWriterBatches(viewPool(bm));
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int batches = __atomic_load_n(&mgmtData->writerBatches, __ATOMIC_RELAXED);
+
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        batches += getNumWriterBatches(&mgmtData->partitions[p]);
+    }
+    return batches;
+}
+
+int getNumPrefetchReads(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolView(bm))
+    {
+        return getNumPrefetchReads(viewPool(bm));
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int pages = __atomic_load_n(&mgmtData->prefetchPagesRead, __ATOMIC_RELAXED);
+
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        pages += getNumPrefetchReads(&mgmtData->partitions[p]);
+    }
+    return pages;
+}
+
+int getNumPrefetchErrors(BM_BufferPool *const bm)
+{
+    if (!bufferPoolExists(bm))
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    if (poolView(bm))
+    {
+        return getNumPrefetchErrors(viewPool(bm));
+    }
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int errors = __atomic_load_n(&mgmtData->prefetchErrors, __ATOMIC_RELAXED);
+
+    for (int p = 0; p < mgmtData->numPartitions; p++)
+    {
+        errors += getNumPrefetchErrors(&mgmtData->partitions[p]);
+    }
+    return errors;
+}
@@ -1,5 +1,6 @@
 #ifndef BUFFER_MANAGER_H
 #define BUFFER_MANAGER_H
+#include <pthread.h>
 #include "storage_mgr.h"
 
 // Include return codes and methods for logging errors
@@ -15,18 +16,34 @@ typedef enum ReplacementStrategy
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5,
+	RS_2Q = 6,
+	RS_CLOCK_SWEEP = 7
 } ReplacementStrategy;
 
+// Access strategies, see pinPageWithAccess
+typedef enum BM_AccessStrategy
+{
+	BM_ACCESS_NORMAL = 0,
+	BM_ACCESS_BULKREAD = 1,
+	BM_ACCESS_BULKWRITE = 2
+} BM_AccessStrategy;
+
 // Data Types and Structures
 typedef int PageNumber;
 #define NO_PAGE -1
 
+// Key a pool caches a page under, its page number. A shared pool, see initSharedBufferPool, caches the pages of
+// several files and keys each by (file id, page number in the file), the file id in the high 32 bits
+typedef long long BM_PageKey;
+
 typedef struct BM_BufferPool
 {
 	char *pageFile;
 	int numPages;
 	ReplacementStrategy strategy;
+	int pageSize; // bytes per page of the page file, known once the file is opened (PAGE_SIZE before)
 	void *mgmtData; // use this one to store the bookkeeping info your buffer
 					// manager needs for a buffer pool
 } BM_BufferPool;
@@ -37,34 +54,310 @@ typedef struct BM_PageHandle
 	char *data;
 } BM_PageHandle;
 
-typedef struct PAGE_FRAME
-{
-	PageNumber pageNum;
-	char *data;
-	bool isDirty;
-	int fixCount;
-	int recentAccessCount; // for LRU
-} PAGE_FRAME;
-
-typedef struct BM_MGMT_DATA
-{
-	PAGE_FRAME *frames;
-	int numReadIO;
-	int numWriteIO;
-	int queueHead; // for FIFO
-} BM_MGMT_DATA;
-
 // This structure represents one page frame in buffer pool (memory).
 typedef struct Page
 {
 	SM_PageHandle data; // Actual data of the page
-	PageNumber pageNum; // An identification integer given to each page
+	BM_PageKey pageNum; // An identification integer given to each page, its key in a shared pool
 	int dirtyBit; // Used to indicate whether the contents of the page has been modified by the client
 	int fixCount; // Used to indicate the number of clients using that page at a given instance
 	int hitNum;   // Used by LRU algorithm to get the least recently used page	
 	int refNum;   // Used by LFU algorithm to get the least frequently used page
+	int ioInProgress; // Used to indicate that the page is still being read into the frame; pins of the page wait for it
 } PageFrame;
 
+// One slot of the page table; 16 bytes, so a cache line holds 4 slots of a probe sequence
+typedef struct BM_PageTableSlot
+{
+	BM_PageKey pageNum; // NO_PAGE for an empty slot
+	int frame;
+} BM_PageTableSlot;
+
+// Open-addressing hash map from page key to the index of the frame holding the page.
+// Linear probing over a power-of-two array kept at most half full; no allocation per entry
+typedef struct BM_PageTable
+{
+	BM_PageTableSlot *slots;
+	unsigned mask; // number of slots - 1
+} BM_PageTable;
+
+// Parameters of RS_LRU_K, passed as stratData to initBufferPool; NULL selects the defaults below
+typedef struct BM_LRUKParams
+{
+	int k;                // number of most recent references remembered per page
+	int correlatedPeriod; // pins of a page within this many pins of its last one count as the same reference
+	int retainedPages;    // number of evicted pages whose history is kept
+} BM_LRUKParams;
+
+#define BM_LRUK_DEFAULT_K 2
+#define BM_LRUK_DEFAULT_CORRELATED_PERIOD 16
+#define BM_LRUK_DEFAULT_RETAINED_FACTOR 4 // retainedPages is this times the number of frames
+
+// State of RS_LRU_K. Times are counted in pins. Resident frames are kept in a binary heap ordered by the time
+// of their K-th most recent reference (0, i.e. first, when a page has fewer than K), then by their most
+// recent one, so the victim is found in O(log n) instead of by a scan of all frames
+typedef struct BM_LRUK
+{
+	int k;
+	int correlatedPeriod;
+	unsigned long clock;   // logical time, advanced by every pin
+	unsigned long *hist;   // hist[frame * k + i]: time of the frame's (i+1)-th most recent reference, 0 for none
+	unsigned long *last;   // time of each frame's most recent reference, correlated ones included
+	BM_PageKey *framePage; // page each frame's history belongs to
+	int *heap;             // frames ordered by backward K-distance
+	int *heapPos;          // position of each frame in heap, -1 while it has no page
+	int heapSize;
+	int *stash;            // frames popped while looking for a victim
+	BM_PageTable retained; // evicted page -> slot of its history in retainedHist
+	BM_PageKey *retainedPage;
+	unsigned long *retainedHist;
+	int numRetained;       // slots for retained histories, reused round robin
+	int retainedNext;
+} BM_LRUK;
+
+// Parameters of RS_2Q, passed as stratData to initBufferPool; NULL selects a quarter and a half of the frames
+typedef struct BM_2QParams
+{
+	int kin;  // frames of the A1in queue, which holds pages referenced once
+	int kout; // number of pages remembered in A1out after they left A1in
+} BM_2QParams;
+
+// Doubly linked list threaded through prev/next arrays of entry indices; head is the most recent entry
+typedef struct BM_List
+{
+	int head, tail; // -1 when empty
+	int size;
+} BM_List;
+
+// State of RS_ARC and RS_2Q. Resident frames are on one of two lists, ARC's T1/T2 or 2Q's A1in/Am, and
+// recently evicted pages are kept as ghost entries on ARC's B1/B2 or 2Q's A1out. Every reference and
+// every victim choice moves entries between list ends, so both are O(1) unless pinned pages are skipped
+typedef struct BM_Queues
+{
+	int *framePrev, *frameNext;
+	int *frameList;       // list of each frame, -1 while it holds no page or its page is being evicted
+	BM_List lists[2];     // T1, T2 or A1in, Am
+	BM_PageKey *ghostPage;
+	int *ghostPrev, *ghostNext;
+	int *ghostList;       // ghost list of each entry, -1 for a free entry
+	BM_List ghosts[2];    // B1, B2 or A1out (and unused)
+	int freeGhost;        // free ghost entries, chained through ghostNext
+	BM_PageTable ghostTable; // ghost page -> entry
+	int target;           // ARC: size T1 is adapted towards
+	int kin, kout;        // 2Q: queue sizes
+} BM_Queues;
+
+// Parameters of RS_LFU, passed as stratData to initBufferPool; NULL selects the default below
+typedef struct BM_LFUParams
+{
+	int agingPeriod; // all reference counts are halved after this many pins, 0 never ages them
+} BM_LFUParams;
+
+#define BM_LFU_DEFAULT_AGING_FACTOR 8 // agingPeriod is this times the number of frames
+#define BM_LFU_MAX_COUNT 63           // reference counts saturate here, so one 64-bit word maps the non-empty buckets
+
+// State of RS_LFU. Resident frames sit in one bucket per reference count (refNum), most recently referenced
+// first, so a reference moves a frame to the next bucket and the victim is the tail of the lowest non-empty
+// bucket, both O(1). Halving every count each agingPeriod pins, O(n) per O(n) pins, lets pages that were
+// hot once give way when the workload shifts
+typedef struct BM_LFU
+{
+	int *framePrev, *frameNext;
+	int *frameBucket;        // bucket of each frame, -1 while it holds no page or its page is being evicted
+	BM_List buckets[BM_LFU_MAX_COUNT + 1];
+	unsigned long long used; // bit i is set while buckets[i] is not empty
+	int agingPeriod;
+	int references;          // pins since the counts were last halved
+} BM_LFU;
+
+// RS_CLOCK_SWEEP: a pin raises a frame's usage count (hitNum) up to this, every pass of the clock hand lowers it
+#define BM_SWEEP_MAX_USAGE 5
+
+// Parameters of the background writer, passed to startBackgroundWriter; NULL selects the defaults below
+typedef struct BM_WriterParams
+{
+	double cleanFraction; // share of the frames, counted from where the strategy looks for its next victim, kept clean
+	int intervalMs;       // pause between rounds, cut short when a pin has to write back a dirty victim itself
+	int maxPages;         // pages written per round at most
+} BM_WriterParams;
+
+#define BM_WRITER_DEFAULT_CLEAN_FRACTION 0.25
+#define BM_WRITER_DEFAULT_INTERVAL_MS 50
+#define BM_WRITER_DEFAULT_MAX_PAGES 64
+#define BM_WRITE_BATCH 64 // consecutive pages written with one writeBlocks call at most
+
+// Frames of a ring, the pages pinned with a bulk access strategy cycle through them. A ring has this many frames,
+// but at most an eighth of the pool and at least one
+#define BM_RING_BULKREAD_FRAMES 16
+#define BM_RING_BULKWRITE_FRAMES 64
+#define BM_RING_POOL_SHARE 8
+
+typedef struct BM_Ring
+{
+	int *frames; // frame of each slot, -1 until the slot gets one
+	int size;
+	int next;    // slot the ring's next page goes to
+} BM_Ring;
+
+// Reads the prefetcher keeps under way at a time
+#define BM_PREFETCH_DEPTH 32
+
+// A read started by prefetchPages: frame was given to pageNum and is loaded by the prefetcher thread, which first
+// writes back evicted if the frame held a dirty page
+typedef struct BM_Prefetch
+{
+	int frame;
+	BM_PageKey pageNum;
+	BM_PageKey evicted;
+} BM_Prefetch;
+
+// Warm restart: a pool opened with BM_OPEN_WARM_RESTART among its flags records its resident pages at shutdown in
+// "<pageFile>.warm", a BM_WarmHeader followed by one BM_WarmPage per page from the least to the most recently
+// referenced, and the next pool opened with the flag reads them back in page order before its first pin
+#define BM_OPEN_WARM_RESTART 256 // buffer manager flag, not passed on to the storage manager
+#define BM_WARM_MAGIC 0x4d524157 // "WARM"
+
+typedef struct BM_WarmHeader
+{
+	int magic;
+	int strategy; // of the pool that wrote the file; another strategy gets the pages, not their counts
+	int numPages; // BM_WarmPage entries following
+} BM_WarmHeader;
+
+typedef struct BM_WarmPage
+{
+	PageNumber pageNum;
+	int hitNum; // the frame's hitNum and refNum, as the strategy uses them
+	int refNum;
+} BM_WarmPage;
+
+// A shared pool caches the pages of several page files, see initSharedBufferPool. Its frames, page table and
+// replacement state hold BM_PageKey keys of (file id, page number in the file), so an attached file can have as
+// many pages as any other; up to BM_MAX_SHARED_FILES files are attached at a time
+#define BM_MAX_SHARED_FILES 512
+
+// A page file attached to a shared pool
+typedef struct BM_SharedFile
+{
+	SM_FileHandle fileHandle; // open while the file is attached
+	int attached;
+	pthread_rwlock_t latch; // held shared while fileHandle is used, exclusive while the file is attached or detached
+	int numReadIO;  // pages read from the file
+	int numWriteIO; // pages written to it
+} BM_SharedFile;
+
+// Frame arenas of at least this size are backed by huge pages where the system provides them
+#ifndef BM_HUGE_PAGE_SIZE
+#define BM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+// Frames a pool can be resized to, unless it starts with more. The frame table and the frame latches are reserved as
+// address space for this many frames and backed by memory as frames are added, so they never move while pins and
+// unpins index them without the latch
+#define BM_MAX_POOL_PAGES (1 << 20)
+
+// The frames of the first pin get their data from one arena chunk, every resizeBufferPool that adds frames past
+// all chunks from another; the pool cannot grow past that once it has this many
+#define BM_MAX_ARENA_CHUNKS 32
+
+// Data of frames firstFrame..firstFrame + numFrames - 1, mapped as one piece
+typedef struct BM_ArenaChunk
+{
+	char *data;  // frame firstFrame + j at data + j * pageSize
+	size_t size; // bytes mapped
+	int firstFrame;
+	int numFrames;
+} BM_ArenaChunk;
+
+// Bookkeeping kept in BM_BufferPool->mgmtData
+typedef struct BM_MGMT_DATA
+{
+	PageFrame *frames; // reserved for maxPages frames, see BM_MAX_POOL_PAGES
+	BM_ArenaChunk arena[BM_MAX_ARENA_CHUNKS]; // data of the frames, allocated on the first pin
+	int numChunks;     // chunks of arena mapped; stored atomically, handleFrame reads them without the latch
+	int maxPages;
+	int numFrames;     // frames set up; frames[numPages..numFrames-1] were retired by resizeBufferPool
+	int numRetiring;   // retired frames that still hold a page, dropped by retireFrames
+	pthread_mutex_t resizeLatch; // serializes resizeBufferPool, taken before latch
+	BM_PageTable pageTable; // resident pages, replaces scanning the frames on every lookup
+	int numUsedFrames;      // frames are filled in order, frames[numUsedFrames..] are still empty
+	SM_FileHandle fileHandle; // page file kept open for the lifetime of the pool
+	int openFlags; // SM_OPEN_* mode the page file is opened with
+	int warmRestart; // BM_OPEN_WARM_RESTART was given; also set for a partitioned pool, which keeps the file itself
+	int numReadIO;
+	int numWriteIO;
+	int writeCount; // pages written back when they were evicted
+	int queueHead; // for FIFO
+	int rearIndex; // for FIFO: frame the search for the next victim starts at
+	int clockPointer; // for CLOCK
+	unsigned clockHand; // for CLOCK_SWEEP, advanced atomically; the frame it points at is clockHand % numPages
+	BM_LRUK *lruk; // for LRU-K
+	BM_Queues *queues; // for ARC and 2Q
+	BM_LFU *lfu; // for LFU
+
+	// Several threads may pin, unpin and mark pages of the pool. latch guards the page table, the page each frame
+	// holds and the replacement state and is never held during I/O; fix counts and dirty bits are changed atomically
+	pthread_mutex_t latch;
+	pthread_cond_t ioDone;     // broadcast, under latch, when a frame's read or an evicted page's write-back is done
+	pthread_rwlock_t ioLatch;  // held shared while fileHandle is used, side by side, exclusive to open or close it
+	BM_PageTable writeBacks;   // evicted dirty pages still being written back; a miss on one waits for it
+	pthread_rwlock_t *frameLatches; // per frame, see latchPage
+
+	// Background writer, see startBackgroundWriter. Its flags are guarded by latch
+	pthread_t writer;
+	int writerRunning;
+	int writerStop;
+	pthread_cond_t writerWake; // signalled when a pin writes back a dirty victim itself, or to stop the writer
+	BM_WriterParams writerParams;
+	int writerPages;   // pages written by the background writer
+	int writerBatches; // writeBlocks calls they took
+
+	// Prefetcher, started by the first prefetchPages. Reads not started yet wait in a ring of prefetchSize entries, one
+	// per frame set up (every one holds a pinned frame, so it cannot overflow); the ring and the flags are guarded by
+	// latch. The prefetcher grows its batch itself when resizeBufferPool has grown the ring
+	pthread_t prefetcher;
+	int prefetcherRunning;
+	int prefetcherStop;
+	pthread_cond_t prefetchWake; // signalled when reads are queued, or to stop the prefetcher
+	BM_Prefetch *prefetchQueue;
+	BM_Prefetch *prefetchBatch; // the prefetcher's copy of the reads it is doing
+	int prefetchSize;
+	int prefetchBatchSize;
+	int prefetchHead;
+	int prefetchCount;
+	int prefetchPending;    // reads queued or under way; their frames stay pinned until the prefetcher loaded them
+	int prefetchPagesRead; // pages read by the prefetcher
+	int prefetchErrors;    // reads of the prefetcher that failed
+	BM_PageKey prefetchFailedPage; // the last of them, NO_PAGE if none; the next pinPageAsync of the page reports
+	RC prefetchFailure;            // its RC instead of reading it again
+
+	// Rings of the bulk access strategies, indexed by BM_AccessStrategy (rings[BM_ACCESS_NORMAL] is unused),
+	// allocated on the first bulk pin and guarded by latch. A frame serves a slot while frameRing[frame] is
+	// ringTag(access, slot); it leaves the ring, -1, when a normal pin references or evicts its page
+	BM_Ring rings[3];
+	int *frameRing;
+
+	// Empty frames, those whose pages dropFilePages discarded or resizeBufferPool added, are taken from freeFrames
+	// before the replacement strategy is asked for a victim; an entry is stale once its frame holds a page again or
+	// lies past numPages, frameFree keeps a frame from being listed twice. Guarded by latch
+	int *freeFrames;
+	int numFreeFrames;
+	bool *frameFree;
+
+	// A shared pool keeps one entry per file id in files, guarded by latch, the handles also by the entry's latch.
+	// A view, the pool handle of one attached file, only routes to sharedPool, turning page numbers into keys
+	BM_SharedFile *files; // BM_MAX_SHARED_FILES entries, NULL unless the pool is shared
+	int numAttached;
+	BM_BufferPool *sharedPool; // of a view, NULL for every other pool
+	int fileId;                // of a view
+
+	// A partitioned pool only routes: every page is hashed to one of numPartitions independent sub-pools, each with
+	// its own frames, page table, replacement state and latches. All other fields of a partitioned pool but
+	// warmRestart are unused
+	int numPartitions; // 0 for a pool that holds its frames itself
+	BM_BufferPool *partitions;
+} BM_MGMT_DATA;
+
 // convenience macros
 #define MAKE_POOL() \
 	((BM_BufferPool *)malloc(sizeof(BM_BufferPool)))
@@ -76,6 +369,19 @@ typedef struct Page
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 				  const int numPages, ReplacementStrategy strategy,
 				  void *stratData);
+RC initBufferPoolWithFlags(BM_BufferPool *const bm, const char *const pageFileName,
+				  const int numPages, ReplacementStrategy strategy,
+				  void *stratData, int openFlags);
+RC initBufferPoolPartitioned(BM_BufferPool *const bm, const char *const pageFileName,
+				  const int numPages, ReplacementStrategy strategy,
+				  void *stratData, int openFlags, int numPartitions);
+RC initSharedBufferPool(BM_BufferPool *const pool, const int numPages, ReplacementStrategy strategy,
+				  void *stratData);
+RC attachBufferPool(BM_BufferPool *const bm, BM_BufferPool *const pool, const char *const pageFileName,
+				  int openFlags);
+RC dropFilePages(BM_BufferPool *const bm);
+RC dropWarmState(const char *const pageFileName);
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
@@ -85,6 +391,21 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
 		   const PageNumber pageNum);
+RC pinPageWithAccess(BM_BufferPool *const bm, BM_PageHandle *const page,
+					 const PageNumber pageNum, BM_AccessStrategy access);
+RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive);
+RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page);
+
+// Asynchronous Reads
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber *pageNums, const int n);
+RC prefetchPagesWithAccess(BM_BufferPool *const bm, const PageNumber *pageNums, const int n,
+						   BM_AccessStrategy access);
+RC pinPageAsync(BM_BufferPool *const bm, BM_PageHandle *const page,
+				const PageNumber pageNum);
+
+// Background Writer
+RC startBackgroundWriter(BM_BufferPool *const bm, const BM_WriterParams *params);
+RC stopBackgroundWriter(BM_BufferPool *const bm);
 
 // Statistics Interface
 PageNumber *getFrameContents(BM_BufferPool *const bm);
@@ -92,5 +413,10 @@ bool *getDirtyFlags(BM_BufferPool *const bm);
 int *getFixCounts(BM_BufferPool *const bm);
 int getNumReadIO(BM_BufferPool *const bm);
 int getNumWriteIO(BM_BufferPool *const bm);
+int getNumEvictionWrites(BM_BufferPool *const bm);
+int getNumWriterPages(BM_BufferPool *const bm);
+int getNumWriterBatches(BM_BufferPool *const bm);
+int getNumPrefetchReads(BM_BufferPool *const bm);
+int getNumPrefetchErrors(BM_BufferPool *const bm);
 
 #endif
@@ -1,5 +1,6 @@
 /*helper functions for buffer pool, manager and replacement strategies implementation*/
 #include <limits.h>
+#include <stdint.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include <stdio.h>
@@ -7,599 +8,818 @@
 #include <math.h>
 #include "dberror.h"
 #include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
 
-char *getPageFromFile(BM_BufferPool *const bm, const PageNumber pageNum)
+extern bool bufferPoolExists(BM_BufferPool *const bm) //function to check if buffer pool exists
 {
-    SM_FileHandle fileHandle;
-    RC result;
-
-    // Open the page file
-    result = openPageFile(bm->pageFile, &fileHandle);
-    if (result != RC_OK)
+    if (bm == NULL || bm->mgmtData == NULL)
     {
-        fprintf(stderr, "Error opening page file for reading: %s\n", strerror(result));
-        return NULL;
+        return false;
     }
+    return true;
+}
 
-    // Allocate memory for the page data
-    char *pageData = (char *)malloc(PAGE_SIZE);
-    if (pageData == NULL)
-    {
-        fprintf(stderr, "Error allocating memory for page data.\n");
-        closePageFile(&fileHandle); // Close the file before returning.
-        return NULL;
-    }
+// True if bm is a partitioned pool, whose pages live in its sub-pools
+extern bool poolPartitioned(BM_BufferPool *const bm)
+{
+    return bufferPoolExists(bm) && ((BM_MGMT_DATA *)bm->mgmtData)->numPartitions > 0;
+}
 
-    // Read the page from the file
-    result = readBlock(pageNum, &fileHandle, pageData);
-    if (result != RC_OK)
-    {
-        fprintf(stderr, "Error reading page from file: %s\n", strerror(result));
-        free(pageData);             // Free the allocated memory before returning.
-        closePageFile(&fileHandle); // Close the file before returning.
-        return NULL;
-    }
+// Sub-pool of a partitioned pool that holds pageNum. The high half of a 64-bit multiplicative hash picks it, so
+// the choice does not correlate with the slot the page gets in the sub-pool's page table
+extern BM_BufferPool *poolPartition(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    unsigned long long h = ((unsigned long long)(unsigned)pageNum * 0x9E3779B97F4A7C15ull) >> 32;
 
-    // Close the page file
-    result = closePageFile(&fileHandle);
-    if (result != RC_OK)
-    {
-        fprintf(stderr, "Error closing page file after reading: %s\n", strerror(result));
-    }
+    return &mgmtData->partitions[(h * (unsigned)mgmtData->numPartitions) >> 32];
+}
 
-    return pageData;
+// True if bm is the view of a file attached to a shared pool, whose pages live in the shared pool
+extern bool poolView(BM_BufferPool *const bm)
+{
+    return bufferPoolExists(bm) && ((BM_MGMT_DATA *)bm->mgmtData)->sharedPool != NULL;
 }
 
-extern int findPage_LRU(const PAGE_FRAME *frames, int numFrames, PageNumber targetPageNum)
+// Shared pool a view routes to
+extern BM_BufferPool *viewPool(BM_BufferPool *const bm)
 {
-    int frameIndex = -1;                  // Initialize the frame index to -1 (not found)
-    int leastRecentAccessCount = INT_MAX; // Initialize the least recent access count
+    return ((BM_MGMT_DATA *)bm->mgmtData)->sharedPool;
+}
 
-    int i = 0;
-    while (i < numFrames) //run while loop to check if target is empty 
-    {
-        const PAGE_FRAME currentFrame = frames[i];
-        const int isTargetOrEmpty = (currentFrame.pageNum == targetPageNum || currentFrame.pageNum == NO_PAGE);
+// Key of page pageNum of file fileId in a shared pool, and the file and page a key stands for. NO_PAGE stands for
+// no file and no page
+static inline BM_PageKey fileKey(int fileId, PageNumber pageNum)
+{
+    return ((BM_PageKey)fileId << 32) | (unsigned)pageNum;
+}
 
-        if (!isTargetOrEmpty)
-        {
-            i++;
-            continue;
-        }
+static inline int keyFile(BM_PageKey key)
+{
+    return (int)(key >> 32);
+}
 
-        if (currentFrame.recentAccessCount < leastRecentAccessCount) //check if current frame is recently accessed
+static inline PageNumber keyPage(BM_PageKey key)
+{
+    return (PageNumber)(unsigned)key;
+}
 
-            leastRecentAccessCount = currentFrame.recentAccessCount; //set least recent count as current frame count
-            frameIndex = i;
-        }
-        i++;
-        
-    return frameIndex; //return the result
+// Pool that caches page pageNum of bm, and the key it is cached under: the pages of a view live in its shared pool,
+// keyed by the view's file. NULL if the page number cannot be one of the view's file
+extern BM_BufferPool *pagePool(BM_BufferPool *const bm, PageNumber pageNum, BM_PageKey *key)
+{
+    if (!poolView(bm))
+    {
+        *key = pageNum;
+        return bm;
+    }
+    if (pageNum < 0)
+    {
+        return NULL;
+    }
+    *key = fileKey(((BM_MGMT_DATA *)bm->mgmtData)->fileId, pageNum);
+    return viewPool(bm);
 }
 
-extern int findLRUVictim(const PAGE_FRAME *frames, int numFrames)
+// True if frame i of the shared pool of view bm holds a page of the view's file
+extern bool viewFrameOwned(BM_BufferPool *const bm, int i)
 {
-    int i = 0;
+    BM_MGMT_DATA *pool = (BM_MGMT_DATA *)viewPool(bm)->mgmtData;
+    BM_PageKey key = __atomic_load_n(&pool->frames[i].pageNum, __ATOMIC_ACQUIRE);
 
-    int leastRecentAccessCount = INT_MAX; // Set the least recent access count to the maximum integer value
-    int victimIndex = -1;                 // Set the victim index to -1 if no victim is found
+    return key != NO_PAGE && keyFile(key) == ((BM_MGMT_DATA *)bm->mgmtData)->fileId;
+}
+
+// Open the pool's page file on first use; the handle then stays open until shutdownBufferPool. A shared pool
+// opens its files when they are attached
+extern RC openPoolFile(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
-    while (i < numFrames)
+    if (mgmtData->fileHandle.mgmtInfo != NULL || mgmtData->files != NULL)
+    {
+        return RC_OK;
+    }
+    RC result = openPageFileWithFlags(bm->pageFile, &mgmtData->fileHandle, mgmtData->openFlags);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+    if (mgmtData->numChunks > 0 && mgmtData->fileHandle.pageSize != bm->pageSize)
     {
-        // If the frame is not pinned, and has the least recent access count, update the victim index
-        bool isFixCountZero = (frames[i].fixCount == 0);
+        // the frames were already cut for another page size, when the file did not exist yet
+        closePageFile(&mgmtData->fileHandle);
+        return RC_INVALID_PAGE_SIZE;
+    }
+    bm->pageSize = mgmtData->fileHandle.pageSize; // frames are sized by the file's page size
+    return RC_OK;
+}
 
-        if (isFixCountZero)
-        {
-            bool isRecentAccessLess = frames[i].recentAccessCount < leastRecentAccessCount;
-            if (isRecentAccessLess) //check if frame has the least access count
+// Handle to do the I/O of the pool page keyed key with, and the page's number in it. On success the file's latch,
+// ioLatch for a pool that is not shared, is held shared until releasePoolFile, so that the handle is not closed
+// under the call; the calls themselves may run side by side. *file is set to the file's entry in a shared pool,
+// else to NULL
+static RC poolFile(BM_BufferPool *const bm, BM_PageKey key, PageNumber *filePage, SM_FileHandle **fileHandle,
+                   BM_SharedFile **file)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC result = RC_OK;
 
+    *file = NULL;
+    if (mgmtData->files == NULL)
+    {
+        pthread_rwlock_rdlock(&mgmtData->ioLatch);
+        *filePage = (PageNumber)key;
+        *fileHandle = &mgmtData->fileHandle;
+        if (mgmtData->fileHandle.mgmtInfo == NULL)
+        {
+            // opening it is the only change to the handle, done alone
+            pthread_rwlock_unlock(&mgmtData->ioLatch);
+            pthread_rwlock_wrlock(&mgmtData->ioLatch);
+            result = openPoolFile(bm);
+            pthread_rwlock_unlock(&mgmtData->ioLatch);
+            if (result != RC_OK)
             {
-                int newLeastRecentAccessCount = frames[i].recentAccessCount;
-                leastRecentAccessCount = newLeastRecentAccessCount; //set least recent access count to new value
-
-                victimIndex = i;
+                return result;
             }
+            pthread_rwlock_rdlock(&mgmtData->ioLatch);
         }
-        i++;
+        return RC_OK;
+    }
+    *file = &mgmtData->files[keyFile(key)];
+    *fileHandle = &(*file)->fileHandle;
+    *filePage = keyPage(key);
+    pthread_rwlock_rdlock(&(*file)->latch);
+    if (!(*file)->attached)
+    {
+        pthread_rwlock_unlock(&(*file)->latch);
+        return RC_FILE_HANDLE_NOT_INIT;
     }
+    return RC_OK;
+}
+
+// Release the handle poolFile returned for the page keyed key
+static void releasePoolFile(BM_BufferPool *const bm, BM_PageKey key)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
-    return victimIndex;
+    pthread_rwlock_unlock(mgmtData->files == NULL ? &mgmtData->ioLatch : &mgmtData->files[keyFile(key)].latch);
 }
 
-extern void writePageToFile(BM_BufferPool *const bm, const PAGE_FRAME *frame)
+/* page table */
+
+// Home slot of pageNum: Fibonacci hashing spreads runs of consecutive page numbers over the table; the high half
+// of the product mixes in the file id of a shared pool's key
+static unsigned pageTableHash(const BM_PageTable *table, BM_PageKey pageNum)
 {
-    SM_FileHandle fileHandle;
-    RC result;
+    unsigned h = (unsigned)(((unsigned long long)pageNum * 0x9E3779B97F4A7C15ull) >> 32);
+    return (h ^ (h >> 16)) & table->mask;
+}
 
-    // Open the page file
-    result = openPageFile(bm->pageFile, &fileHandle);
-    if (result != RC_OK)
+// Size the table for numFrames resident pages, i.e. the next power of two of at least twice that many slots
+extern RC pageTableInit(BM_PageTable *table, int numFrames)
+{
+    unsigned size = 16;
+
+    while (size < 2 * (unsigned)numFrames)
     {
-        printf("Error opening page file for writing.\n");
-        return;
+        size *= 2;
     }
-
-    // Write the page to the file
-    result = writeBlock(frame->pageNum, &fileHandle, frame->data);
-    if (result != RC_OK)
+    table->slots = (BM_PageTableSlot *)malloc(sizeof(BM_PageTableSlot) * size);
+    if (table->slots == NULL)
     {
-        printf("Error writing page to file.\n");
+        return RC_MEMORY_ALLOCATION_FAILED;
     }
-
-    // Close the page file
-    result = closePageFile(&fileHandle);
-    if (result != RC_OK)
+    for (unsigned i = 0; i < size; i++)
     {
-        printf("Error closing page file after writing.\n");
+        table->slots[i].pageNum = NO_PAGE;
     }
+    table->mask = size - 1;
+    return RC_OK;
 }
 
-extern bool bufferPoolExists(BM_BufferPool *const bm) //function to check if buffer pool exists
+extern void pageTableFree(BM_PageTable *table)
 {
-    if (bm == NULL || bm->mgmtData == NULL)
+    free(table->slots);
+    table->slots = NULL;
+}
+
+static void pageTableInsert(BM_PageTable *table, BM_PageKey pageNum, int frame);
+
+// Resize the table for numFrames resident pages if it is too small for them, keeping its entries
+static RC pageTableGrow(BM_PageTable *table, int numFrames)
+{
+    BM_PageTable grown;
+
+    if (2 * (unsigned)numFrames <= table->mask + 1)
     {
-        return false;
+        return RC_OK;
     }
-    return true;
+    if (pageTableInit(&grown, numFrames) != RC_OK)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (unsigned i = 0; i <= table->mask; i++)
+    {
+        if (table->slots[i].pageNum != NO_PAGE)
+        {
+            pageTableInsert(&grown, table->slots[i].pageNum, table->slots[i].frame);
+        }
+    }
+    pageTableFree(table);
+    *table = grown;
+    return RC_OK;
 }
 
-extern void updateLRUList(PAGE_FRAME *frames, int numFrames, int accessedFrameIndex)
+// Frame holding pageNum, or -1 if the page is not in the pool
+extern int pageTableLookup(const BM_PageTable *table, BM_PageKey pageNum)
 {
-    int i;
-    // Update the accessed frame's accessCount to the current highest count
-    int highestAccessCount = 0;
-    i = 0;
-    // Find the highest access count
-    while (i < numFrames)
+    for (unsigned i = pageTableHash(table, pageNum);; i = (i + 1) & table->mask)
     {
-        // If the frame is not pinned, and has the least recent access count, update the victim index
-        bool isRecentAccessCountHigher = (frames[i].recentAccessCount > highestAccessCount);
-
-        if (isRecentAccessCountHigher)
+        if (table->slots[i].pageNum == pageNum)
         {
-            int newAccessCount = frames[i].recentAccessCount;
-            highestAccessCount = newAccessCount;
+            return table->slots[i].frame;
+        }
+        if (table->slots[i].pageNum == NO_PAGE)
+        {
+            return -1;
         }
-        i++;
     }
+}
 
-    int newAccessCount = highestAccessCount + 1;
+// Record that frame now holds pageNum
+extern void pageTableInsert(BM_PageTable *table, BM_PageKey pageNum, int frame)
+{
+    unsigned i = pageTableHash(table, pageNum);
 
-    // Update the accessed frame
-    frames[accessedFrameIndex].recentAccessCount = newAccessCount;
+    while (table->slots[i].pageNum != NO_PAGE && table->slots[i].pageNum != pageNum)
+    {
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i].pageNum = pageNum;
+    table->slots[i].frame = frame;
 }
 
-extern int findPage_FIFO(PAGE_FRAME *frames, int numPages, PageNumber pageNum)
+// Forget pageNum. The entries after it in its probe run are shifted back, so lookups never need tombstones
+extern void pageTableRemove(BM_PageTable *table, BM_PageKey pageNum)
 {
-    int i;
-    i = 0;
+    unsigned hole = pageTableHash(table, pageNum);
 
-    while (i < numPages)
+    while (table->slots[hole].pageNum != pageNum)
     {
-        bool isPageMatch = (frames[i].pageNum == pageNum) || (frames[i].pageNum == NO_PAGE);
-
-        if (isPageMatch)
+        if (table->slots[hole].pageNum == NO_PAGE)
         {
-            return i; // Return the index immediately when a match is found
+            return;
         }
-        i++;
+        hole = (hole + 1) & table->mask;
     }
 
-    return -1; // Return -1 if no matching frame is found
-}
-
-extern int findVictimPage_FIFO(BM_MGMT_DATA *const mgmtData, PAGE_FRAME *frames, int numPages)
-{ //function to find victim page
-
-    int head = mgmtData->queueHead;
-    int frameIndex = NO_PAGE;
-    int newHead;
-
-    for (int count = 0; count < numPages; count++)
+    for (unsigned i = (hole + 1) & table->mask; table->slots[i].pageNum != NO_PAGE; i = (i + 1) & table->mask)
     {
-        newHead = (head + 1) % numPages;
-        head = newHead;
-        bool isFixCountZero = (frames[head].fixCount == 0);
-
-        if (isFixCountZero)
+        // an entry may move into the hole unless its home slot lies cyclically in (hole, i]
+        unsigned home = pageTableHash(table, table->slots[i].pageNum);
+        if (((i - home) & table->mask) >= ((i - hole) & table->mask))
         {
-            frameIndex = head;
-            break;
+            table->slots[hole] = table->slots[i];
+            hole = i;
         }
     }
-
-    return frameIndex;
+    table->slots[hole].pageNum = NO_PAGE;
 }
 
-// FIFO Replacement Strategy
-extern RC pinPageUsingFIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// Put pageNum into frame index, moving the frame's page table entry from the page it held before
+extern void setFramePage(BM_BufferPool *const bm, int index, BM_PageKey pageNum)
 {
-    // Check if buffer pool is not existing
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *frame = &mgmtData->frames[index];
 
-    if (!bufferPoolExists(bm))
+    if (frame->pageNum != NO_PAGE)
     {
-        return RC_BUFFER_POOL_NOT_EXISTING;
+        pageTableRemove(&mgmtData->pageTable, frame->pageNum);
     }
+    pageTableInsert(&mgmtData->pageTable, pageNum, index);
+    // stored atomically, handleFrame reads it without the latch
+    __atomic_store_n(&frame->pageNum, pageNum, __ATOMIC_RELEASE);
+}
 
-    // Get the management data from the buffer pool
-    BM_MGMT_DATA *mgmtData;
-    PAGE_FRAME *frames;
-    int frameIndex;
-
-    mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
-    int numPages = bm->numPages;
-    frames = mgmtData->frames;
-
-    // Find an available frame using FIFO strategy
-    frameIndex = findPage_FIFO(frames, numPages, pageNum);
-    RC rc;
+/* frames */
 
-    // Now frameIndex contains the index of the page if found, or -1 if not found
+// Reserve address space for the frame table and the frame latches of up to maxPages frames. setUpFrames makes
+// entries usable as the pool grows; the tables never move, so pins and unpins index them without the latch
+extern RC reserveFrames(BM_MGMT_DATA *mgmtData, int maxPages)
+{
+    void *frames = mmap(NULL, sizeof(PageFrame) * (size_t)maxPages, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void *latches = mmap(NULL, sizeof(pthread_rwlock_t) * (size_t)maxPages, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
 
-    if (frameIndex == -1)
+    if (frames == MAP_FAILED || latches == MAP_FAILED)
     {
-        // Find a victim page using FIFO strategy
-        int newIndex = findVictimPage_FIFO(mgmtData, frames, numPages);
-        frameIndex = newIndex;
-
-        if (frameIndex == -1)
+        if (frames != MAP_FAILED)
         {
-            getFrameContents(bm);
-            rc = RC_NO_AVAILABLE_FRAME;
-            return rc;
+            munmap(frames, sizeof(PageFrame) * (size_t)maxPages);
         }
-
-        // Write the victim page back to disk if dirty
-        PAGE_FRAME *currentFrame = &frames[frameIndex];
-
-        if (currentFrame->isDirty)
+        if (latches != MAP_FAILED)
         {
-            BM_PageHandle pageHandle = {.pageNum = currentFrame->pageNum, .data = currentFrame->data};
-            forcePage(bm, &pageHandle);
+            munmap(latches, sizeof(pthread_rwlock_t) * (size_t)maxPages);
         }
+        return RC_MEMORY_ALLOCATION_FAILED;
     }
+    mgmtData->frames = (PageFrame *)frames;
+    mgmtData->frameLatches = (pthread_rwlock_t *)latches;
+    mgmtData->maxPages = maxPages;
+    return RC_OK;
+}
 
-    // Update read count if the page is not already in the buffer pool
-    int isDifferentPage = frames[frameIndex].pageNum != pageNum;
-    if (isDifferentPage)
+extern void releaseFrames(BM_MGMT_DATA *mgmtData)
+{
+    if (mgmtData->frames != NULL)
     {
-        mgmtData->numReadIO++;
+        munmap(mgmtData->frames, sizeof(PageFrame) * (size_t)mgmtData->maxPages);
+        munmap(mgmtData->frameLatches, sizeof(pthread_rwlock_t) * (size_t)mgmtData->maxPages);
+        mgmtData->frames = NULL;
+        mgmtData->frameLatches = NULL;
     }
+}
 
-    // Update the page handle with the pinned page information
-    int queueHead = frameIndex % numPages;
-    mgmtData->queueHead = queueHead;
-
-    // Get the page from the file
-    frames[frameIndex].data = getPageFromFile(bm, pageNum);
-
-    // Update the page handle with the pinned page information
-
-    int newPageNum = pageNum;
-    void *newData = frames[frameIndex].data;
-
-    page->pageNum = newPageNum;
-    page->data = newData;
-
-    // Update the frame with the new page information
-
-    PAGE_FRAME *currentFrame = &frames[frameIndex];
-    currentFrame->pageNum = pageNum;
-    currentFrame->isDirty = false;
-    currentFrame->fixCount++;
+// Back entries first..last - 1 of both tables with memory and initialize them as empty frames without data
+extern RC setUpFrames(BM_MGMT_DATA *mgmtData, int first, int last)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t frameBytes = (sizeof(PageFrame) * (size_t)last + pageSize - 1) / pageSize * pageSize;
+    size_t latchBytes = (sizeof(pthread_rwlock_t) * (size_t)last + pageSize - 1) / pageSize * pageSize;
 
+    if (mprotect(mgmtData->frames, frameBytes, PROT_READ | PROT_WRITE) != 0 ||
+        mprotect(mgmtData->frameLatches, latchBytes, PROT_READ | PROT_WRITE) != 0)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    // Initializing the pages. The values of fields (variables) in the page are either NULL or 0
+    for (int i = first; i < last; i++)
+    {
+        PageFrame *currentPage = &mgmtData->frames[i];
+        currentPage->data = NULL;
+        currentPage->pageNum = -1;
+        currentPage->dirtyBit = 0;
+        currentPage->fixCount = 0;
+        currentPage->hitNum = 0;
+        currentPage->refNum = 0;
+        currentPage->ioInProgress = 0;
+        pthread_rwlock_init(&mgmtData->frameLatches[i], NULL);
+    }
     return RC_OK;
 }
 
-// LRU Replacement Strategy
-extern RC pinPageUsingLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// Map the data of frames first..first + count - 1 as the next arena chunk and point every frame at its slice.
+// Chunks are page aligned, so frames can be handed to an O_DIRECT page file as they are. Large chunks are backed by
+// huge pages when the system has them reserved, or else asked to use transparent huge pages, which saves TLB
+// misses when the pool is big. Called with the latch held
+static RC mapArenaChunk(BM_BufferPool *const bm, int first, int count)
 {
-    // Check if buffer pool is not existing
-    int result = RC_OK; // Define an error code variable
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_ArenaChunk *chunk;
+    size_t size = (size_t)count * bm->pageSize;
+    void *arena = MAP_FAILED;
 
-    if (bm == NULL)
+    if (mgmtData->numChunks == BM_MAX_ARENA_CHUNKS)
     {
-        result = RC_BUFFER_POOL_NOT_EXISTING;
-        return result;
+        return RC_ERROR;
     }
-
-    // Get the management data from the buffer pool
-
-    PAGE_FRAME *frames;
-    BM_MGMT_DATA *mgmtData;
-    int frameIndex;
-
-    mgmtData = (BM_MGMT_DATA *)(bm->mgmtData);
-    frames = mgmtData->frames;
-
-    // Find the target page in the buffer pool
-    int numPages = bm->numPages;
-    frameIndex = findPage_LRU(frames, numPages, pageNum);
-
-    // If the page is found in the buffer pool
-    if (frameIndex != -1)
+#ifdef MAP_HUGETLB
+    if (size >= BM_HUGE_PAGE_SIZE)
     {
-        // Update page handle with existing page information
-
-        PAGE_FRAME *frame = &frames[frameIndex];
-        frame->data = getPageFromFile(bm, pageNum);
-
-        // Update the page handle with the pinned page information
-        page->pageNum = pageNum;
-        page->data = frames[frameIndex].data;
-
-        // Update the frame with the new page information
-
-        PAGE_FRAME *currentFrame = &frames[frameIndex];
-        currentFrame->pageNum = pageNum;
-        currentFrame->isDirty = false;
-        currentFrame->fixCount++;
-
-        // Move the page to the front of the LRU list (update accessCount)
+        size_t hugeSize = (size + BM_HUGE_PAGE_SIZE - 1) & ~(size_t)(BM_HUGE_PAGE_SIZE - 1);
+        arena = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED)
+        {
+            size = hugeSize;
+        }
+    }
+#endif
+    if (arena == MAP_FAILED)
+    {
+        arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED)
+        {
+            return RC_MEMORY_ALLOCATION_FAILED;
+        }
+#ifdef MADV_HUGEPAGE
+        if (size >= BM_HUGE_PAGE_SIZE)
+        {
+            madvise(arena, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
 
-        updateLRUList(frames, numPages, frameIndex);
+    chunk = &mgmtData->arena[mgmtData->numChunks];
+    chunk->data = (char *)arena;
+    chunk->size = size;
+    chunk->firstFrame = first;
+    chunk->numFrames = count;
+    for (int i = 0; i < count; i++)
+    {
+        mgmtData->frames[first + i].data = chunk->data + (size_t)i * bm->pageSize;
+    }
+    __atomic_store_n(&mgmtData->numChunks, mgmtData->numChunks + 1, __ATOMIC_RELEASE);
+    return RC_OK;
+}
 
-        // Increment read count if the page is not already in the buffer pool
-        mgmtData->numReadIO = mgmtData->numReadIO + 1;
+// Allocate the data of all frames as one arena chunk. This happens on the first pin, once the page file is open
+// and its page size known; after that frames are reused in place and a miss allocates nothing
+extern RC allocFrameArena(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
+    if (mgmtData->numChunks > 0)
+    {
         return RC_OK;
     }
+    pthread_rwlock_wrlock(&mgmtData->ioLatch);
+    openPoolFile(bm); // a missing file keeps the default page size, reading the page reports the error
+    pthread_rwlock_unlock(&mgmtData->ioLatch);
 
-    // If the page is not found in the buffer pool
-    // Find a victim frame using the LRU strategy
-    frameIndex = findLRUVictim(frames, numPages);
+    return mapArenaChunk(bm, 0, mgmtData->numFrames);
+}
 
-    // If a victim frame is found
-    if (frameIndex != -1)
+// Release the frame arena when the pool is shut down
+extern void freeFrameArena(BM_MGMT_DATA *mgmtData)
+{
+    for (int c = 0; c < mgmtData->numChunks; c++)
     {
-        // Write back the victim page if dirty
-        PAGE_FRAME *currentFrame = &mgmtData->frames[frameIndex];
-        if (currentFrame->isDirty)
-        {
-            // Write the dirty page back to disk
-            writePageToFile(bm, currentFrame);
-            mgmtData->numWriteIO++;
-        }
-
-        // Update the victim frame with the new page information
+        munmap(mgmtData->arena[c].data, mgmtData->arena[c].size);
+    }
+    mgmtData->numChunks = 0;
+}
 
-        PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
-        frame->pageNum = pageNum;
-        frame->isDirty = false;
-        frame->fixCount = 1;
-        frame->data = getPageFromFile(bm, pageNum);
+// Give the memory of frame i's data back to the system, its frame was retired. The data reads as zeros if the
+// frame is set up again; a chunk of huge pages keeps it
+static void releaseFrameData(BM_BufferPool *const bm, int i)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)((BM_MGMT_DATA *)bm->mgmtData)->frames[i].data;
+    uintptr_t end = start + bm->pageSize;
 
-        // mgmtData->numReadIO++;
+    start = (start + pageSize - 1) & ~(uintptr_t)(pageSize - 1);
+    end &= ~(uintptr_t)(pageSize - 1);
+    if (start != 0 && end > start)
+    {
+        madvise((void *)start, end - start, MADV_DONTNEED);
+    }
+}
 
-        // Update page handle with the new page information
-        page->pageNum = pageNum;
-        page->data = mgmtData->frames[frameIndex].data;
+// Read page pageNum into data. Pages past the end of the file read as zeros, they are created when first written back
+extern RC readPageFromFile(BM_BufferPool *const bm, const BM_PageKey pageNum, char *data)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageNumber filePage;
+    SM_FileHandle *fileHandle;
+    BM_SharedFile *file;
+    RC result;
 
-        // Move the page to the front of the LRU list (update accessCount)
-        updateLRUList(frames, numPages, frameIndex);
+    // Open the page file
+    result = poolFile(bm, pageNum, &filePage, &fileHandle, &file);
+    if (result != RC_OK)
+    {
+        printf("Error opening page file for reading.\n");
+        memset(data, 0, bm->pageSize);
+        return result;
+    }
 
-        return RC_OK;
+    // Read the page from the file
+    result = readBlock(filePage, fileHandle, data);
+    releasePoolFile(bm, pageNum);
+    if (result == RC_READ_NON_EXISTING_PAGE)
+    {
+        memset(data, 0, bm->pageSize);
+        result = RC_OK;
     }
 
-    return RC_NO_AVAILABLE_FRAME;
+    __atomic_add_fetch(&mgmtData->numReadIO, 1, __ATOMIC_RELAXED);
+    if (file != NULL)
+    {
+        __atomic_add_fetch(&file->numReadIO, 1, __ATOMIC_RELAXED);
+    }
+    return result;
 }
 
-extern RC pinPageUsingLRU_K(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+extern RC writePageToFile(BM_BufferPool *const bm, const PageFrame *frame)
 {
-    // Check if buffer pool is not existing
-    int result = RC_OK; // Define an error code variable
+    PageNumber filePage;
+    SM_FileHandle *fileHandle;
+    BM_SharedFile *file;
+    RC result;
 
-    if (bm == NULL)
+    // Open the page file
+    result = poolFile(bm, frame->pageNum, &filePage, &fileHandle, &file);
+    if (result != RC_OK)
     {
-        result = RC_BUFFER_POOL_NOT_EXISTING;
+        printf("Error opening page file for writing.\n");
         return result;
     }
 
-    // Get the management data from the buffer pool
-    BM_MGMT_DATA *mgmtData;
-    PAGE_FRAME *frames;
-    int frameIndex;
+    // Write the page to the file
+    result = writeBlock(filePage, fileHandle, frame->data);
+    releasePoolFile(bm, frame->pageNum);
+    if (result != RC_OK)
+    {
+        printf("Error writing page to file.\n");
+    }
 
-    mgmtData = (BM_MGMT_DATA *)(bm->mgmtData);
-    frames = mgmtData->frames;
+    return result;
+}
 
-    // Find the target page in the buffer pool
-    frameIndex = findPage_LRU(frames, bm->numPages, pageNum);
+// Write the page of frame index back to the file, for forcePage and forceFlushPool. The caller keeps the frame
+// pinned; its latch is held shared, so the page is not written halfway through a change made under latchPage
+extern RC flushFrame(BM_BufferPool *const bm, int index)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *frame = &mgmtData->frames[index];
+    RC result;
 
-    // If the page is found in the buffer pool
-    if (frameIndex != -1)
+    pthread_rwlock_rdlock(&mgmtData->frameLatches[index]);
+    // Cleared before the write: a page marked dirty again while it is written stays dirty
+    __atomic_store_n(&frame->dirtyBit, 0, __ATOMIC_RELEASE);
+    result = writePageToFile(bm, frame);
+    if (result != RC_OK)
+    {
+        __atomic_store_n(&frame->dirtyBit, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_add_fetch(&mgmtData->numWriteIO, 1, __ATOMIC_RELAXED);
+    if (mgmtData->files != NULL)
     {
-        // Update page handle with existing page information
+        __atomic_add_fetch(&mgmtData->files[keyFile(frame->pageNum)].numWriteIO, 1, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&mgmtData->frameLatches[index]);
+    return result;
+}
 
-        PAGE_FRAME *currentPageFrame = &frames[frameIndex];
-        currentPageFrame->data = getPageFromFile(bm, pageNum);
+// True if no client has the frame's page pinned. Replacement strategies run under the pool latch, but unpinning
+// does not take it
+static inline bool frameUnpinned(const PageFrame *frame)
+{
+    return __atomic_load_n(&frame->fixCount, __ATOMIC_ACQUIRE) == 0;
+}
 
-        // Update the page handle with the pinned page information
+// Drop one pin of frame index; fix counts are changed atomically so that unpinning needs no latch
+extern void unpinFrame(BM_MGMT_DATA *mgmtData, int index)
+{
+    int *fixCount = &mgmtData->frames[index].fixCount;
+    int count = __atomic_load_n(fixCount, __ATOMIC_ACQUIRE);
 
-        int newPageNum = pageNum;
-        void *newData = frames[frameIndex].data;
+    while (count > 0 && !__atomic_compare_exchange_n(fixCount, &count, count - 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+    }
+}
 
-        page->pageNum = newPageNum;
-        page->data = newData;
+/* writing back batches of pages */
 
-        // Update the frame with the new page information
-        PAGE_FRAME *currentFrame = &frames[frameIndex];
-        currentFrame->pageNum = pageNum;
-        currentFrame->isDirty = false;
-        // Increment fix count
-        currentFrame->fixCount++;
+// A frame whose page is to be written back, sorted by page number
+typedef struct BM_FrameRef
+{
+    BM_PageKey pageNum;
+    int frame;
+} BM_FrameRef;
 
-        // Move the page to the front of the LRU list (update accessCount)
-        int np = bm->numPages;
-        updateLRUList(frames, np, frameIndex);
+static int compareFrameRefs(const void *a, const void *b)
+{
+    BM_PageKey x = ((const BM_FrameRef *)a)->pageNum, y = ((const BM_FrameRef *)b)->pageNum;
+    return (x > y) - (x < y);
+}
 
-        mgmtData->numReadIO++;
+static int comparePrefetches(const void *a, const void *b)
+{
+    BM_PageKey x = ((const BM_Prefetch *)a)->pageNum, y = ((const BM_Prefetch *)b)->pageNum;
+    return (x > y) - (x < y);
+}
 
-        return RC_OK;
-    }
+// Write the pages of frames refs[0..n-1] back in page-number order, each run of consecutive pages (up to
+// BM_WRITE_BATCH) of one file with one writeBlocks call. The caller has pinned the frames and each is unpinned here. A frame
+// whose latch is held exclusive is being changed and ends the run before it; unless wait is set, when the first
+// frame of a run is busy it is skipped. Returns the number of pages written and adds the writeBlocks calls to
+// *batches
+extern int writeFrames(BM_BufferPool *const bm, BM_FrameRef *refs, int n, bool wait, int *batches)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    SM_PageHandle pages[BM_WRITE_BATCH];
+    SM_FileHandle *fileHandle;
+    BM_SharedFile *file;
+    PageNumber filePage;
+    int start, end, k, written = 0;
+    RC result;
 
-    // If the page is not found in the buffer pool
-    // Find a victim frame using the LRU strategy
-    int np = bm->numPages;
-    frameIndex = findLRUVictim(frames, np);
+    qsort(refs, n, sizeof(BM_FrameRef), compareFrameRefs);
 
-    // If a victim frame is found
-    if (frameIndex != -1)
+    for (start = 0; start < n; start = end)
     {
-        // Write back the victim page if dirty
-        PAGE_FRAME *currentFrame = &mgmtData->frames[frameIndex];
-
-        if (currentFrame->isDirty)
+        // latch the frames of the run shared; tryrdlock, since the writer must not wait for a client that holds
+        // one page exclusive and waits for another of the run. Waiting for the first one holds no other latch
+        for (end = start; end < n && end - start < BM_WRITE_BATCH; end++)
+        {
+            if (end > start && (refs[end].pageNum != refs[end - 1].pageNum + 1 ||
+                                (mgmtData->files != NULL && keyFile(refs[end].pageNum) != keyFile(refs[start].pageNum))))
+            {
+                break;
+            }
+            if (end == start && wait)
+            {
+                pthread_rwlock_rdlock(&mgmtData->frameLatches[refs[end].frame]);
+            }
+            else if (pthread_rwlock_tryrdlock(&mgmtData->frameLatches[refs[end].frame]) != 0)
+            {
+                break;
+            }
+            // Cleared before the write: a page marked dirty again while it is written stays dirty
+            __atomic_store_n(&mgmtData->frames[refs[end].frame].dirtyBit, 0, __ATOMIC_RELEASE);
+            pages[end - start] = mgmtData->frames[refs[end].frame].data;
+        }
+        if (end == start)
         {
-            writePageToFile(bm, currentFrame);
-            mgmtData->numWriteIO++;
+            // the first frame is busy, leave it dirty for the next round
+            unpinFrame(mgmtData, refs[end++].frame);
+            continue;
         }
 
-        // Update the victim frame with the new page information
-
-        currentFrame->pageNum = pageNum;
-        currentFrame->isDirty = false;
-        currentFrame->fixCount = 1;
-        currentFrame->data = getPageFromFile(bm, pageNum);
+        result = poolFile(bm, refs[start].pageNum, &filePage, &fileHandle, &file);
+        if (result == RC_OK)
+        {
+            result = writeBlocks(filePage, end - start, fileHandle, pages);
+            releasePoolFile(bm, refs[start].pageNum);
+        }
+        if (result == RC_OK && file != NULL)
+        {
+            __atomic_add_fetch(&file->numWriteIO, end - start, __ATOMIC_RELAXED);
+        }
 
-        // Update page handle with the new page information
-        page->pageNum = pageNum;
-        page->data = mgmtData->frames[frameIndex].data;
+        for (k = start; k < end; k++)
+        {
+            if (result != RC_OK)
+            {
+                __atomic_store_n(&mgmtData->frames[refs[k].frame].dirtyBit, 1, __ATOMIC_RELEASE);
+            }
+            pthread_rwlock_unlock(&mgmtData->frameLatches[refs[k].frame]);
+            unpinFrame(mgmtData, refs[k].frame);
+        }
+        if (result != RC_OK)
+        {
+            printf("Error writing pages to file.\n");
+            continue;
+        }
+        __atomic_add_fetch(&mgmtData->numWriteIO, end - start, __ATOMIC_RELAXED);
+        written += end - start;
+        (*batches)++;
+    }
+    return written;
+}
 
-        // Move the page to the front of the LRU list (update accessCount)
-        updateLRUList(frames, np, frameIndex);
+// Frame the strategy looks at first for its next victim: the clock hand, FIFO's oldest page, 0 for the
+// strategies that keep no position among the frames
+static int replacementStart(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
-        return RC_OK;
+    if (bm->strategy == RS_CLOCK)
+    {
+        return mgmtData->clockPointer % bm->numPages;
     }
-
-    return RC_NO_AVAILABLE_FRAME;
+    if (bm->strategy == RS_CLOCK_SWEEP)
+    {
+        return __atomic_load_n(&mgmtData->clockHand, __ATOMIC_RELAXED) % (unsigned)bm->numPages;
+    }
+    if (bm->strategy == RS_FIFO)
+    {
+        return mgmtData->rearIndex % bm->numPages;
+    }
+    return 0;
 }
 
-// "bufferSize" represents the size of the buffer pool i.e. maximum number of page frames that can be kept into the buffer pool
-int bufferSize = 0;
+extern void retireFrames(BM_BufferPool *const bm);
 
-// "rearIndex" basically stores the count of number of pages read from the disk.
-// "rearIndex" is also used by FIFO function to calculate the frontIndex i.e.
-int rearIndex = 0;
+// One round of the background writer, under the latch: walk the frames from the replacement start until
+// cleanFraction of the frames are clean or taken for writing, and pin the dirty unpinned ones into refs. The
+// dirty pages of frames retired by a shrink go first, the shrink completes once they are clean
+static int writerCollect(BM_BufferPool *const bm, BM_FrameRef *refs)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int numPages = bm->numPages, start = replacementStart(bm);
+    int wanted = (int)(mgmtData->writerParams.cleanFraction * numPages);
+    int k, clean = 0, count = 0;
 
-// "writeCount" counts the number of I/O write to the disk i.e. number of pages writen to the disk
-int writeCount = 0;
+    retireFrames(bm);
+    for (k = numPages; k < mgmtData->numFrames && mgmtData->numRetiring > 0 && count < mgmtData->writerParams.maxPages; k++)
+    {
+        PageFrame *frame = &mgmtData->frames[k];
 
-// "hit" a general count which is incremented whenever a page frame is added into the buffer pool.
-// "hit" is used by LRU to determine least recently added page into the buffer pool.
-int hit = 0;
+        if (frame->pageNum != NO_PAGE && __atomic_load_n(&frame->dirtyBit, __ATOMIC_ACQUIRE) == 1 && frameUnpinned(frame))
+        {
+            __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQ_REL);
+            refs[count].pageNum = frame->pageNum;
+            refs[count++].frame = k;
+        }
+    }
 
-// "clockPointer" is used by CLOCK algorithm to point to the last added page in the buffer pool.
-int clockPointer = 0;
+    for (k = 0; k < numPages && clean + count < wanted && count < mgmtData->writerParams.maxPages; k++)
+    {
+        int i = (start + k) % numPages;
+        PageFrame *frame = &mgmtData->frames[i];
 
-// "lfuPointer" is used by LFU algorithm to store the least frequently used page frame's position. It speeds up operation  from 2nd replacement onwards.
-int lfuPointer = 0;
+        if (frame->pageNum == NO_PAGE || __atomic_load_n(&frame->dirtyBit, __ATOMIC_ACQUIRE) == 0)
+        {
+            clean++;
+        }
+        else if (frameUnpinned(frame))
+        {
+            __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQ_REL);
+            refs[count].pageNum = frame->pageNum;
+            refs[count++].frame = i;
+        }
+    }
+    return count;
+}
 
-// Defining FIFO (First In First Out) function
-extern void FIFO(BM_BufferPool *const bm, PageFrame *page)
+// Background writer thread: keeps the frames the strategy evicts next clean, so that pins rarely write back a
+// dirty victim themselves
+extern void *backgroundWriter(void *arg)
 {
-	//printf("FIFO Started");
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	
-	int i, frontIndex;
-	frontIndex = rearIndex % bufferSize;
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_FrameRef *refs = (BM_FrameRef *)malloc(sizeof(BM_FrameRef) * mgmtData->writerParams.maxPages);
+    int count, batches;
 
-	// Interating through all the page frames in the buffer pool
-	for(i = 0; i < bufferSize; i++)
-	{
-		if(pageFrame[frontIndex].fixCount == 0)
-		{
-			// If page in memory has been modified (dirtyBit = 1), then write page to disk
-			if(pageFrame[frontIndex].dirtyBit == 1)
-			{
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pageFrame[frontIndex].pageNum, &fh, pageFrame[frontIndex].data);
-				
-				// Increase the writeCount which records the number of writes done by the buffer manager.
-				writeCount++;
-			}
-			
-			// Setting page frame's content to new page's content
-			pageFrame[frontIndex].data = page->data;
-			pageFrame[frontIndex].pageNum = page->pageNum;
-			pageFrame[frontIndex].dirtyBit = page->dirtyBit;
-			pageFrame[frontIndex].fixCount = page->fixCount;
-			break;
-		}
-		else
-		{
-			// If the current page frame is being used by some client, we move on to the next location
-			frontIndex++;
-			frontIndex = (frontIndex % bufferSize == 0) ? 0 : frontIndex;
-		}
-	}
+    pthread_mutex_lock(&mgmtData->latch);
+    while (refs != NULL && !mgmtData->writerStop)
+    {
+        count = writerCollect(bm, refs);
+        pthread_mutex_unlock(&mgmtData->latch);
+
+        if (count > 0)
+        {
+            batches = 0;
+            count = writeFrames(bm, refs, count, false, &batches);
+            __atomic_add_fetch(&mgmtData->writerPages, count, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&mgmtData->writerBatches, batches, __ATOMIC_RELAXED);
+        }
+
+        pthread_mutex_lock(&mgmtData->latch);
+        // a full round leaves more to do right away
+        if (count < mgmtData->writerParams.maxPages && !mgmtData->writerStop)
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += mgmtData->writerParams.intervalMs / 1000;
+            until.tv_nsec += (long)(mgmtData->writerParams.intervalMs % 1000) * 1000000;
+            if (until.tv_nsec >= 1000000000)
+            {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&mgmtData->writerWake, &mgmtData->latch, &until);
+        }
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+    free(refs);
+    return NULL;
 }
 
-// Defining LFU (Least Frequently Used) function
-extern void LFU(BM_BufferPool *const bm, PageFrame *page)
+// Each strategy picks the frame whose page is replaced by the page being pinned and returns its index, or -1 when
+// every page in the pool is pinned. Writing the evicted page back and loading the new one is left to pinPage.
+
+// Defining FIFO (First In First Out) function
+extern int FIFO(BM_BufferPool *const bm)
 {
-	//printf("LFU Started");
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	
-	int i, j, leastFreqIndex, leastFreqRef;
-	leastFreqIndex = lfuPointer;	
+	BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *) bm->mgmtData;
+	PageFrame *pageFrame = mgmtData->frames;
+	int bufferSize = bm->numPages;
 	
+	int i, frontIndex;
+	frontIndex = mgmtData->rearIndex % bufferSize;
+
 	// Interating through all the page frames in the buffer pool
 	for(i = 0; i < bufferSize; i++)
 	{
-		if(pageFrame[leastFreqIndex].fixCount == 0)
-		{
-			leastFreqIndex = (leastFreqIndex + i) % bufferSize;
-			leastFreqRef = pageFrame[leastFreqIndex].refNum;
-			break;
-		}
-	}
-
-	i = (leastFreqIndex + 1) % bufferSize;
-
-	// Finding the page frame having minimum refNum (i.e. it is used the least frequent) page frame
-	for(j = 0; j < bufferSize; j++)
-	{
-		if(pageFrame[i].refNum < leastFreqRef)
+		if(frameUnpinned(&pageFrame[frontIndex]))
 		{
-			leastFreqIndex = i;
-			leastFreqRef = pageFrame[i].refNum;
+			// The next replacement starts after this frame, which now holds the newest page
+			mgmtData->rearIndex = frontIndex + 1;
+			return frontIndex;
 		}
-		i = (i + 1) % bufferSize;
+		// If the current page frame is being used by some client, we move on to the next location
+		frontIndex = (frontIndex + 1) % bufferSize;
 	}
-		
-	// If page in memory has been modified (dirtyBit = 1), then write page to disk	
-	if(pageFrame[leastFreqIndex].dirtyBit == 1)
-	{
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		writeBlock(pageFrame[leastFreqIndex].pageNum, &fh, pageFrame[leastFreqIndex].data);
-		
-		// Increase the writeCount which records the number of writes done by the buffer manager.
-		writeCount++;
-	}
-	
-	// Setting page frame's content to new page's content		
-	pageFrame[leastFreqIndex].data = page->data;
-	pageFrame[leastFreqIndex].pageNum = page->pageNum;
-	pageFrame[leastFreqIndex].dirtyBit = page->dirtyBit;
-	pageFrame[leastFreqIndex].fixCount = page->fixCount;
-	lfuPointer = leastFreqIndex + 1;
+	return -1;
 }
 
 // Defining LRU (Least Recently Used) function
-extern void LRU(BM_BufferPool *const bm, PageFrame *page)
+extern int LRU(BM_BufferPool *const bm)
 {	
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	int i, leastHitIndex, leastHitNum;
+	PageFrame *pageFrame = ((BM_MGMT_DATA *) bm->mgmtData)->frames;
+	int bufferSize = bm->numPages;
+	int i, leastHitIndex = -1, leastHitNum;
 
 	// Interating through all the page frames in the buffer pool.
 	for(i = 0; i < bufferSize; i++)
 	{
 		// Finding page frame whose fixCount = 0 i.e. no client is using that page frame.
-		if(pageFrame[i].fixCount == 0)
+		if(frameUnpinned(&pageFrame[i]))
 		{
 			leastHitIndex = i;
 			leastHitNum = pageFrame[i].hitNum;
@@ -607,71 +827,1405 @@ extern void LRU(BM_BufferPool *const bm, PageFrame *page)
 		}
 	}	
 
-	// Finding the page frame having minimum hitNum (i.e. it is the least recently used) page frame
+	// Every page is pinned, nothing can be evicted
+	if(leastHitIndex < 0)
+		return -1;
+
+	// Finding the unpinned page frame having minimum hitNum (i.e. it is the least recently used) page frame
 	for(i = leastHitIndex + 1; i < bufferSize; i++)
 	{
-		if(pageFrame[i].hitNum < leastHitNum)
+		if(frameUnpinned(&pageFrame[i]) && pageFrame[i].hitNum < leastHitNum)
 		{
 			leastHitIndex = i;
 			leastHitNum = pageFrame[i].hitNum;
 		}
 	}
-
-	// If page in memory has been modified (dirtyBit = 1), then write page to disk
-	if(pageFrame[leastHitIndex].dirtyBit == 1)
-	{
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		writeBlock(pageFrame[leastHitIndex].pageNum, &fh, pageFrame[leastHitIndex].data);
-		
-		// Increase the writeCount which records the number of writes done by the buffer manager.
-		writeCount++;
-	}
-	
-	// Setting page frame's content to new page's content
-	pageFrame[leastHitIndex].data = page->data;
-	pageFrame[leastHitIndex].pageNum = page->pageNum;
-	pageFrame[leastHitIndex].dirtyBit = page->dirtyBit;
-	pageFrame[leastHitIndex].fixCount = page->fixCount;
-	pageFrame[leastHitIndex].hitNum = page->hitNum;
+	return leastHitIndex;
 }
 
 // Defining CLOCK function
-extern void CLOCK(BM_BufferPool *const bm, PageFrame *page)
+extern int CLOCK(BM_BufferPool *const bm)
 {	
-	//printf("CLOCK Started");
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	while(1)
+	BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *) bm->mgmtData;
+	PageFrame *pageFrame = mgmtData->frames;
+	int bufferSize = bm->numPages;
+	int i, victim, clockPointer = mgmtData->clockPointer;
+
+	// The first sweep clears the reference bits, so two sweeps find a victim if any page is unpinned
+	for(i = 0; i < 2 * bufferSize; i++)
 	{
-		clockPointer = (clockPointer % bufferSize == 0) ? 0 : clockPointer;
+		clockPointer = clockPointer % bufferSize;
 
-		if(pageFrame[clockPointer].hitNum == 0)
-		{
-			// If page in memory has been modified (dirtyBit = 1), then write page to disk
-			if(pageFrame[clockPointer].dirtyBit == 1)
-			{
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pageFrame[clockPointer].pageNum, &fh, pageFrame[clockPointer].data);
-				
-				// Increase the writeCount which records the number of writes done by the buffer manager.
-				writeCount++;
-			}
-			
-			// Setting page frame's content to new page's content
-			pageFrame[clockPointer].data = page->data;
-			pageFrame[clockPointer].pageNum = page->pageNum;
-			pageFrame[clockPointer].dirtyBit = page->dirtyBit;
-			pageFrame[clockPointer].fixCount = page->fixCount;
-			pageFrame[clockPointer].hitNum = page->hitNum;
-			clockPointer++;
-			break;	
-		}
-		else
+		if(frameUnpinned(&pageFrame[clockPointer]) && pageFrame[clockPointer].hitNum == 0)
 		{
-			// Incrementing clockPointer so that we can check the next page frame location.
-			// We set hitNum = 0 so that this loop doesn't go into an infinite loop.
-			pageFrame[clockPointer++].hitNum = 0;		
+			victim = clockPointer++;
+			mgmtData->clockPointer = clockPointer;
+			return victim;
 		}
+		// Incrementing clockPointer so that we can check the next page frame location.
+		// We set hitNum = 0 so that this page is taken on the next pass unless it is used again.
+		pageFrame[clockPointer++].hitNum = 0;
 	}
+	mgmtData->clockPointer = clockPointer;
+	return -1;
+}
+
+/* CLOCK sweep */
+
+// Count a pin of frame in its usage count, which saturates at BM_SWEEP_MAX_USAGE. Sweeping threads lower the
+// count without the pool latch, so it is only changed atomically
+extern void sweepReference(BM_BufferPool *const bm, int frame)
+{
+    int *usage = &((BM_MGMT_DATA *)bm->mgmtData)->frames[frame].hitNum;
+    int count = __atomic_load_n(usage, __ATOMIC_RELAXED);
+
+    while (count < BM_SWEEP_MAX_USAGE && !__atomic_compare_exchange_n(usage, &count, count + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+// Generalized CLOCK for concurrent pools, run without the pool latch. Every thread advances the shared clock hand
+// with an atomic increment and lowers the usage count of each unpinned frame it passes; the first unpinned frame
+// found at usage 0 is claimed by pinning it (fixCount 0 -> 1), so threads that miss at the same time take
+// different frames. Returns the claimed frame, which pinPage still has to check under the latch, or -1 when
+// BM_SWEEP_MAX_USAGE + 2 passes found nothing to claim
+extern int CLOCK_SWEEP(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *pageFrame = mgmtData->frames;
+    // resizeBufferPool may change numPages meanwhile; pinPage checks the frame against it under the latch
+    unsigned numPages = (unsigned)__atomic_load_n(&bm->numPages, __ATOMIC_ACQUIRE);
+    long i, steps = (long)(BM_SWEEP_MAX_USAGE + 2) * numPages;
+
+    for (i = 0; i < steps; i++)
+    {
+        int frame = __atomic_fetch_add(&mgmtData->clockHand, 1, __ATOMIC_RELAXED) % numPages;
+        int *usage = &pageFrame[frame].hitNum;
+        int count, unpinned = 0;
+
+        if (!frameUnpinned(&pageFrame[frame]))
+        {
+            continue;
+        }
+        count = __atomic_load_n(usage, __ATOMIC_RELAXED);
+        if (count > 0)
+        {
+            // a concurrent pin may have raised the count again, then the frame just keeps it
+            __atomic_compare_exchange_n(usage, &count, count - 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&pageFrame[frame].fixCount, &unpinned, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            return frame;
+        }
+    }
+    return -1;
+}
+
+// Reallocate the array at *array for count entries of size bytes; it is left as it is on failure
+static bool growArray(void *array, size_t size, int count)
+{
+    void *grown = realloc(*(void **)array, size * (size_t)count);
+
+    if (grown == NULL)
+    {
+        return false;
+    }
+    *(void **)array = grown;
+    return true;
+}
+
+/* LRU-K */
+
+// Whether frame a goes before frame b: an older K-th most recent reference, then an older most recent one
+static int lrukBefore(const BM_LRUK *lruk, int a, int b)
+{
+    const unsigned long *histA = &lruk->hist[(size_t)a * lruk->k];
+    const unsigned long *histB = &lruk->hist[(size_t)b * lruk->k];
+
+    if (histA[lruk->k - 1] != histB[lruk->k - 1])
+    {
+        return histA[lruk->k - 1] < histB[lruk->k - 1];
+    }
+    return histA[0] < histB[0];
+}
+
+static void lrukHeapSet(BM_LRUK *lruk, int pos, int frame)
+{
+    lruk->heap[pos] = frame;
+    lruk->heapPos[frame] = pos;
+}
+
+// Move the frame at pos up or down until the heap order holds again
+static void lrukHeapFix(BM_LRUK *lruk, int pos)
+{
+    int frame = lruk->heap[pos];
+
+    while (pos > 0 && lrukBefore(lruk, frame, lruk->heap[(pos - 1) / 2]))
+    {
+        lrukHeapSet(lruk, pos, lruk->heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    while (2 * pos + 1 < lruk->heapSize)
+    {
+        int child = 2 * pos + 1;
+        if (child + 1 < lruk->heapSize && lrukBefore(lruk, lruk->heap[child + 1], lruk->heap[child]))
+        {
+            child++;
+        }
+        if (!lrukBefore(lruk, lruk->heap[child], frame))
+        {
+            break;
+        }
+        lrukHeapSet(lruk, pos, lruk->heap[child]);
+        pos = child;
+    }
+    lrukHeapSet(lruk, pos, frame);
+}
+
+static void lrukHeapPush(BM_LRUK *lruk, int frame)
+{
+    lrukHeapSet(lruk, lruk->heapSize++, frame);
+    lrukHeapFix(lruk, lruk->heapSize - 1);
+}
+
+static int lrukHeapPop(BM_LRUK *lruk)
+{
+    int frame = lruk->heap[0];
+
+    lruk->heapPos[frame] = -1;
+    if (--lruk->heapSize > 0)
+    {
+        lrukHeapSet(lruk, 0, lruk->heap[lruk->heapSize]);
+        lrukHeapFix(lruk, 0);
+    }
+    return frame;
+}
+
+// Take frame out of the heap, its page is dropped
+static void lrukHeapRemove(BM_LRUK *lruk, int frame)
+{
+    int pos = lruk->heapPos[frame];
+
+    lruk->heapPos[frame] = -1;
+    if (--lruk->heapSize > pos)
+    {
+        lrukHeapSet(lruk, pos, lruk->heap[lruk->heapSize]);
+        lrukHeapFix(lruk, pos);
+    }
+}
+
+// Release the LRU-K state of a pool, if it has any
+extern void lrukFree(BM_MGMT_DATA *mgmtData)
+{
+    BM_LRUK *lruk = mgmtData->lruk;
+
+    if (lruk == NULL)
+    {
+        return;
+    }
+    free(lruk->hist);
+    free(lruk->last);
+    free(lruk->framePage);
+    free(lruk->heap);
+    free(lruk->heapPos);
+    free(lruk->stash);
+    free(lruk->retainedPage);
+    free(lruk->retainedHist);
+    pageTableFree(&lruk->retained);
+    free(lruk);
+    mgmtData->lruk = NULL;
+}
+
+// Set up the LRU-K state of a pool of numFrames frames from params, which may be NULL
+extern RC lrukInit(BM_MGMT_DATA *mgmtData, int numFrames, const BM_LRUKParams *params)
+{
+    BM_LRUK *lruk;
+    int k = params != NULL ? params->k : BM_LRUK_DEFAULT_K;
+    int correlatedPeriod = params != NULL ? params->correlatedPeriod : BM_LRUK_DEFAULT_CORRELATED_PERIOD;
+    int numRetained = params != NULL ? params->retainedPages : BM_LRUK_DEFAULT_RETAINED_FACTOR * numFrames;
+
+    if (k < 1 || correlatedPeriod < 0 || numRetained < 0)
+    {
+        return RC_ERROR;
+    }
+    lruk = (BM_LRUK *)calloc(1, sizeof(BM_LRUK));
+    if (lruk == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    lruk->k = k;
+    lruk->correlatedPeriod = correlatedPeriod;
+    lruk->numRetained = numRetained;
+    lruk->hist = (unsigned long *)calloc((size_t)numFrames * k, sizeof(unsigned long));
+    lruk->last = (unsigned long *)calloc(numFrames, sizeof(unsigned long));
+    lruk->framePage = (BM_PageKey *)malloc(sizeof(BM_PageKey) * numFrames);
+    lruk->heap = (int *)malloc(sizeof(int) * numFrames);
+    lruk->heapPos = (int *)malloc(sizeof(int) * numFrames);
+    lruk->stash = (int *)malloc(sizeof(int) * numFrames);
+    lruk->retainedPage = (BM_PageKey *)malloc(sizeof(BM_PageKey) * (numRetained + 1));
+    lruk->retainedHist = (unsigned long *)malloc(sizeof(unsigned long) * ((size_t)numRetained * k + 1));
+    mgmtData->lruk = lruk;
+    if (lruk->hist == NULL || lruk->last == NULL || lruk->framePage == NULL || lruk->heap == NULL ||
+        lruk->heapPos == NULL || lruk->stash == NULL || lruk->retainedPage == NULL || lruk->retainedHist == NULL ||
+        pageTableInit(&lruk->retained, numRetained) != RC_OK)
+    {
+        lrukFree(mgmtData);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (int i = 0; i < numFrames; i++)
+    {
+        lruk->framePage[i] = NO_PAGE;
+        lruk->heapPos[i] = -1;
+    }
+    for (int i = 0; i < numRetained; i++)
+    {
+        lruk->retainedPage[i] = NO_PAGE;
+    }
+    return RC_OK;
+}
+
+// Extend the LRU-K state of a pool from oldFrames to numFrames frames, see resizeBufferPool
+extern RC lrukGrow(BM_MGMT_DATA *mgmtData, int oldFrames, int numFrames)
+{
+    BM_LRUK *lruk = mgmtData->lruk;
+
+    if (!growArray(&lruk->hist, sizeof(unsigned long) * lruk->k, numFrames) ||
+        !growArray(&lruk->last, sizeof(unsigned long), numFrames) ||
+        !growArray(&lruk->framePage, sizeof(BM_PageKey), numFrames) ||
+        !growArray(&lruk->heap, sizeof(int), numFrames) || !growArray(&lruk->heapPos, sizeof(int), numFrames) ||
+        !growArray(&lruk->stash, sizeof(int), numFrames))
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    memset(&lruk->hist[(size_t)oldFrames * lruk->k], 0, sizeof(unsigned long) * lruk->k * (numFrames - oldFrames));
+    for (int i = oldFrames; i < numFrames; i++)
+    {
+        lruk->last[i] = 0;
+        lruk->framePage[i] = NO_PAGE;
+        lruk->heapPos[i] = -1;
+    }
+    return RC_OK;
+}
+
+// Keep the history of the page in frame, which is about to be evicted, in the next retained slot
+static void lrukRetain(BM_LRUK *lruk, int frame)
+{
+    int slot = lruk->retainedNext;
+    BM_PageKey pageNum = lruk->framePage[frame];
+
+    if (lruk->numRetained == 0)
+    {
+        return;
+    }
+    lruk->retainedNext = (slot + 1) % lruk->numRetained;
+
+    // the slot's previous page loses its history, unless it was retained again in a later slot
+    if (lruk->retainedPage[slot] != NO_PAGE && pageTableLookup(&lruk->retained, lruk->retainedPage[slot]) == slot)
+    {
+        pageTableRemove(&lruk->retained, lruk->retainedPage[slot]);
+    }
+    lruk->retainedPage[slot] = pageNum;
+    memcpy(&lruk->retainedHist[(size_t)slot * lruk->k], &lruk->hist[(size_t)frame * lruk->k], sizeof(unsigned long) * lruk->k);
+    pageTableInsert(&lruk->retained, pageNum, slot);
+}
+
+// Record a reference to the page in frame, either a pin of a resident page or a page just read into the frame
+extern void lrukReference(BM_BufferPool *const bm, int frame)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_LRUK *lruk = mgmtData->lruk;
+    BM_PageKey pageNum = mgmtData->frames[frame].pageNum;
+    unsigned long *hist = &lruk->hist[(size_t)frame * lruk->k];
+    unsigned long now = ++lruk->clock;
+    int i;
+
+    if (lruk->framePage[frame] != pageNum)
+    {
+        // A page just read into the frame starts from the history it had when it was evicted, if that was kept
+        int slot = pageTableLookup(&lruk->retained, pageNum);
+        if (slot >= 0)
+        {
+            memcpy(hist + 1, &lruk->retainedHist[(size_t)slot * lruk->k], sizeof(unsigned long) * (lruk->k - 1));
+            pageTableRemove(&lruk->retained, pageNum);
+            lruk->retainedPage[slot] = NO_PAGE;
+        }
+        else
+        {
+            memset(hist + 1, 0, sizeof(unsigned long) * (lruk->k - 1));
+        }
+        lruk->framePage[frame] = pageNum;
+    }
+    else if (now - lruk->last[frame] > (unsigned long)lruk->correlatedPeriod)
+    {
+        // A new, uncorrelated reference. The correlated period that ended counts as a single reference,
+        // so the older references move forward by its length
+        unsigned long period = lruk->last[frame] - hist[0];
+        for (i = lruk->k - 1; i > 0; i--)
+        {
+            hist[i] = hist[i - 1] != 0 ? hist[i - 1] + period : 0;
+        }
+    }
+    else
+    {
+        // A correlated reference, e.g. the next record of a page being scanned; the history stays as it is
+        lruk->last[frame] = now;
+        return;
+    }
+    hist[0] = now;
+    lruk->last[frame] = now;
+
+    if (lruk->heapPos[frame] < 0)
+    {
+        lrukHeapPush(lruk, frame);
+    }
+    else
+    {
+        lrukHeapFix(lruk, lruk->heapPos[frame]);
+    }
+}
+
+// Whether the page in frame may be evicted: it is not pinned, and it is past its correlated reference period,
+// i.e. the pin being served would not be a correlated reference to it
+static int lrukEvictable(const BM_LRUK *lruk, const PageFrame *frames, int frame)
+{
+    return frameUnpinned(&frames[frame]) && lruk->clock + 1 - lruk->last[frame] > (unsigned long)lruk->correlatedPeriod;
+}
+
+// Defining LRU-K function: the unpinned page with the oldest K-th most recent reference is evicted. Pages within
+// their correlated reference period are passed over, unless no other page can be evicted
+extern int LRU_K(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_LRUK *lruk = mgmtData->lruk;
+    int victim = -1, fallback = -1, numStashed = 0;
+
+    // usually the frame on top of the heap can go, and it is moved by the reference to its new page
+    if (lruk->heapSize > 0 && lrukEvictable(lruk, mgmtData->frames, lruk->heap[0]))
+    {
+        lrukRetain(lruk, lruk->heap[0]);
+        return lruk->heap[0];
+    }
+
+    while (lruk->heapSize > 0)
+    {
+        int frame = lrukHeapPop(lruk);
+        lruk->stash[numStashed++] = frame;
+
+        if (lrukEvictable(lruk, mgmtData->frames, frame))
+        {
+            victim = frame;
+            break;
+        }
+        if (fallback < 0 && frameUnpinned(&mgmtData->frames[frame]))
+        {
+            fallback = frame;
+        }
+    }
+    if (victim < 0)
+    {
+        victim = fallback;
+    }
+
+    // every frame examined goes back into the heap
+    while (numStashed > 0)
+    {
+        lrukHeapPush(lruk, lruk->stash[--numStashed]);
+    }
+    if (victim >= 0)
+    {
+        lrukRetain(lruk, victim);
+    }
+    return victim;
+}
+
+/* ARC and 2Q */
+
+static void listPushHead(BM_List *list, int *prev, int *next, int entry)
+{
+    prev[entry] = -1;
+    next[entry] = list->head;
+    if (list->head >= 0)
+    {
+        prev[list->head] = entry;
+    }
+    else
+    {
+        list->tail = entry;
+    }
+    list->head = entry;
+    list->size++;
+}
+
+static void listRemove(BM_List *list, int *prev, int *next, int entry)
+{
+    if (prev[entry] >= 0)
+    {
+        next[prev[entry]] = next[entry];
+    }
+    else
+    {
+        list->head = next[entry];
+    }
+    if (next[entry] >= 0)
+    {
+        prev[next[entry]] = prev[entry];
+    }
+    else
+    {
+        list->tail = prev[entry];
+    }
+    list->size--;
+}
+
+static void queuesPushFrame(BM_Queues *queues, int list, int frame)
+{
+    listPushHead(&queues->lists[list], queues->framePrev, queues->frameNext, frame);
+    queues->frameList[frame] = list;
+}
+
+static void queuesRemoveFrame(BM_Queues *queues, int frame)
+{
+    listRemove(&queues->lists[queues->frameList[frame]], queues->framePrev, queues->frameNext, frame);
+    queues->frameList[frame] = -1;
+}
+
+static void queuesRemoveGhost(BM_Queues *queues, int entry)
+{
+    listRemove(&queues->ghosts[queues->ghostList[entry]], queues->ghostPrev, queues->ghostNext, entry);
+    pageTableRemove(&queues->ghostTable, queues->ghostPage[entry]);
+    queues->ghostList[entry] = -1;
+    queues->ghostNext[entry] = queues->freeGhost;
+    queues->freeGhost = entry;
+}
+
+// Remember the evicted page pageNum at the front of a ghost list
+static void queuesAddGhost(BM_Queues *queues, int list, BM_PageKey pageNum)
+{
+    int entry;
+
+    // the lists are trimmed before they can fill all entries; should pinned pages upset that, drop the oldest ghost
+    if (queues->freeGhost < 0)
+    {
+        queuesRemoveGhost(queues, queues->ghosts[list].size > 0 ? queues->ghosts[list].tail : queues->ghosts[!list].tail);
+    }
+    entry = queues->freeGhost;
+    queues->freeGhost = queues->ghostNext[entry];
+    queues->ghostPage[entry] = pageNum;
+    queues->ghostList[entry] = list;
+    listPushHead(&queues->ghosts[list], queues->ghostPrev, queues->ghostNext, entry);
+    pageTableInsert(&queues->ghostTable, pageNum, entry);
+}
+
+// Least recently used frame of a resident list that is not pinned, -1 if there is none
+static int queuesLRUFrame(BM_Queues *queues, const PageFrame *frames, int list)
+{
+    for (int frame = queues->lists[list].tail; frame >= 0; frame = queues->framePrev[frame])
+    {
+        if (frameUnpinned(&frames[frame]))
+        {
+            return frame;
+        }
+    }
+    return -1;
+}
+
+// Release the ARC or 2Q state of a pool, if it has any
+extern void queuesFree(BM_MGMT_DATA *mgmtData)
+{
+    BM_Queues *queues = mgmtData->queues;
+
+    if (queues == NULL)
+    {
+        return;
+    }
+    free(queues->framePrev);
+    free(queues->frameNext);
+    free(queues->frameList);
+    free(queues->ghostPage);
+    free(queues->ghostPrev);
+    free(queues->ghostNext);
+    free(queues->ghostList);
+    pageTableFree(&queues->ghostTable);
+    free(queues);
+    mgmtData->queues = NULL;
+}
+
+// Set up the ARC or 2Q state of a pool of numFrames frames; params is a BM_2QParams for 2Q and may be NULL
+extern RC queuesInit(BM_MGMT_DATA *mgmtData, ReplacementStrategy strategy, int numFrames, const BM_2QParams *params)
+{
+    BM_Queues *queues;
+    int numGhosts;
+
+    queues = (BM_Queues *)calloc(1, sizeof(BM_Queues));
+    if (queues == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    queues->kin = params != NULL ? params->kin : numFrames / 4;
+    queues->kout = params != NULL ? params->kout : numFrames / 2;
+    if (queues->kin < 0 || queues->kout < 0)
+    {
+        free(queues);
+        return RC_ERROR;
+    }
+
+    // ARC remembers as many evicted pages as there are frames, 2Q kout; one more entry covers the page
+    // that is evicted before the ghost of the page replacing it is dropped
+    numGhosts = (strategy == RS_ARC ? numFrames : queues->kout) + 1;
+    queues->framePrev = (int *)malloc(sizeof(int) * numFrames);
+    queues->frameNext = (int *)malloc(sizeof(int) * numFrames);
+    queues->frameList = (int *)malloc(sizeof(int) * numFrames);
+    queues->ghostPage = (BM_PageKey *)malloc(sizeof(BM_PageKey) * numGhosts);
+    queues->ghostPrev = (int *)malloc(sizeof(int) * numGhosts);
+    queues->ghostNext = (int *)malloc(sizeof(int) * numGhosts);
+    queues->ghostList = (int *)malloc(sizeof(int) * numGhosts);
+    mgmtData->queues = queues;
+    if (queues->framePrev == NULL || queues->frameNext == NULL || queues->frameList == NULL ||
+        queues->ghostPage == NULL || queues->ghostPrev == NULL || queues->ghostNext == NULL ||
+        queues->ghostList == NULL || pageTableInit(&queues->ghostTable, numGhosts) != RC_OK)
+    {
+        queuesFree(mgmtData);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        queues->lists[i].head = queues->lists[i].tail = -1;
+        queues->ghosts[i].head = queues->ghosts[i].tail = -1;
+    }
+    for (int i = 0; i < numFrames; i++)
+    {
+        queues->frameList[i] = -1;
+    }
+    for (int i = 0; i < numGhosts; i++)
+    {
+        queues->ghostList[i] = -1;
+        queues->ghostNext[i] = i + 1 < numGhosts ? i + 1 : -1;
+    }
+    queues->freeGhost = 0;
+    return RC_OK;
+}
+
+// Extend the ARC or 2Q state of a pool from oldFrames to numFrames frames, see resizeBufferPool. ARC remembers
+// as many evicted pages as there are frames, so it gets the ghost entries of the new frames as well
+extern RC queuesGrow(BM_MGMT_DATA *mgmtData, ReplacementStrategy strategy, int oldFrames, int numFrames)
+{
+    BM_Queues *queues = mgmtData->queues;
+    int numGhosts = numFrames + 1, oldGhosts = oldFrames + 1;
+
+    if (!growArray(&queues->framePrev, sizeof(int), numFrames) || !growArray(&queues->frameNext, sizeof(int), numFrames) ||
+        !growArray(&queues->frameList, sizeof(int), numFrames))
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (int i = oldFrames; i < numFrames; i++)
+    {
+        queues->frameList[i] = -1;
+    }
+    if (strategy != RS_ARC)
+    {
+        return RC_OK;
+    }
+
+    if (!growArray(&queues->ghostPage, sizeof(BM_PageKey), numGhosts) || !growArray(&queues->ghostPrev, sizeof(int), numGhosts) ||
+        !growArray(&queues->ghostNext, sizeof(int), numGhosts) || !growArray(&queues->ghostList, sizeof(int), numGhosts) ||
+        pageTableGrow(&queues->ghostTable, numGhosts) != RC_OK)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (int i = oldGhosts; i < numGhosts; i++)
+    {
+        queues->ghostList[i] = -1;
+        queues->ghostNext[i] = i + 1 < numGhosts ? i + 1 : queues->freeGhost;
+    }
+    queues->freeGhost = oldGhosts;
+    return RC_OK;
+}
+
+// Record a reference to the page in frame, either a pin of a resident page or a page just read into the frame
+extern void queuesReference(BM_BufferPool *const bm, int frame)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_Queues *queues = mgmtData->queues;
+
+    if (queues->frameList[frame] < 0)
+    {
+        // A page just read into the frame goes to T1 or A1in, unless it is remembered on a ghost list: then it
+        // was referenced before and goes to T2 or Am
+        int entry = pageTableLookup(&queues->ghostTable, mgmtData->frames[frame].pageNum);
+        if (entry >= 0)
+        {
+            queuesRemoveGhost(queues, entry);
+            queuesPushFrame(queues, 1, frame);
+        }
+        else
+        {
+            queuesPushFrame(queues, 0, frame);
+        }
+    }
+    else if (bm->strategy == RS_ARC || queues->frameList[frame] == 1)
+    {
+        // ARC moves a hit in T1 or T2 to the front of T2, 2Q a hit in Am to the front of Am
+        queuesRemoveFrame(queues, frame);
+        queuesPushFrame(queues, 1, frame);
+    }
+    // A 2Q hit in A1in changes nothing, repeated references to a page read once are taken as correlated
+}
+
+// Defining ARC (Adaptive Replacement Cache) function. T1 holds pages referenced once recently, T2 pages
+// referenced at least twice; the target size of T1 grows on hits in B1 (pages just evicted from T1) and shrinks
+// on hits in B2. pageNum is the page being pinned
+extern int ARC(BM_BufferPool *const bm, BM_PageKey pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_Queues *queues = mgmtData->queues;
+    PageFrame *frames = mgmtData->frames;
+    BM_List *t1 = &queues->lists[0], *t2 = &queues->lists[1];
+    BM_List *b1 = &queues->ghosts[0], *b2 = &queues->ghosts[1];
+    int entry = pageTableLookup(&queues->ghostTable, pageNum);
+    int ghost = entry >= 0 ? queues->ghostList[entry] : -1;
+    int c = bm->numPages, fromT1, victim;
+
+    if (ghost == 0)
+    {
+        int delta = b1->size >= b2->size ? 1 : b2->size / b1->size;
+        queues->target = queues->target + delta < c ? queues->target + delta : c;
+    }
+    else if (ghost == 1)
+    {
+        int delta = b2->size >= b1->size ? 1 : b1->size / b2->size;
+        queues->target = queues->target - delta > 0 ? queues->target - delta : 0;
+    }
+    else if (t1->size + b1->size >= c)
+    {
+        // T1 and B1 together hold c pages: drop the oldest ghost of B1, or with B1 empty the oldest page of T1
+        if (b1->size > 0)
+        {
+            queuesRemoveGhost(queues, b1->tail);
+        }
+        else if ((victim = queuesLRUFrame(queues, frames, 0)) >= 0)
+        {
+            queuesRemoveFrame(queues, victim);
+            return victim;
+        }
+    }
+    else if (t1->size + t2->size + b1->size + b2->size >= 2 * c && b2->size > 0)
+    {
+        queuesRemoveGhost(queues, b2->tail);
+    }
+
+    // Evict from T1 while it is larger than its target, else from T2, and remember the page on B1 or B2
+    fromT1 = t1->size > 0 && (t1->size > queues->target || (ghost == 1 && t1->size == queues->target));
+    victim = queuesLRUFrame(queues, frames, fromT1 ? 0 : 1);
+    if (victim < 0)
+    {
+        fromT1 = !fromT1;
+        victim = queuesLRUFrame(queues, frames, fromT1 ? 0 : 1);
+    }
+    if (victim < 0)
+    {
+        return -1;
+    }
+    queuesRemoveFrame(queues, victim);
+    queuesAddGhost(queues, fromT1 ? 0 : 1, frames[victim].pageNum);
+    return victim;
+}
+
+// Defining 2Q function. Pages referenced once wait in the FIFO A1in; when A1in is over kin frames its oldest page
+// is evicted and remembered in A1out. A page referenced again while in A1out is promoted to the LRU list Am
+extern int TWO_Q(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_Queues *queues = mgmtData->queues;
+    PageFrame *frames = mgmtData->frames;
+    int fromA1in = queues->lists[0].size > queues->kin;
+    int victim;
+
+    victim = queuesLRUFrame(queues, frames, fromA1in ? 0 : 1);
+    if (victim < 0)
+    {
+        fromA1in = !fromA1in;
+        victim = queuesLRUFrame(queues, frames, fromA1in ? 0 : 1);
+    }
+    if (victim < 0)
+    {
+        return -1;
+    }
+    queuesRemoveFrame(queues, victim);
+    if (fromA1in)
+    {
+        queuesAddGhost(queues, 0, frames[victim].pageNum);
+        if (queues->ghosts[0].size > queues->kout)
+        {
+            queuesRemoveGhost(queues, queues->ghosts[0].tail);
+        }
+    }
+    return victim;
+}
+
+/* LFU */
+
+static void lfuLink(BM_LFU *lfu, int frame, int count)
+{
+    listPushHead(&lfu->buckets[count], lfu->framePrev, lfu->frameNext, frame);
+    lfu->frameBucket[frame] = count;
+    lfu->used |= 1ULL << count;
+}
+
+static void lfuUnlink(BM_LFU *lfu, int frame)
+{
+    int count = lfu->frameBucket[frame];
+
+    listRemove(&lfu->buckets[count], lfu->framePrev, lfu->frameNext, frame);
+    lfu->frameBucket[frame] = -1;
+    if (lfu->buckets[count].size == 0)
+    {
+        lfu->used &= ~(1ULL << count);
+    }
+}
+
+// Halve the reference count of every resident page; within a bucket the pages keep their order
+static void lfuAge(BM_LFU *lfu, PageFrame *frames)
+{
+    BM_List old[BM_LFU_MAX_COUNT + 1];
+
+    memcpy(old, lfu->buckets, sizeof(old));
+    for (int count = 0; count <= BM_LFU_MAX_COUNT; count++)
+    {
+        lfu->buckets[count].head = lfu->buckets[count].tail = -1;
+        lfu->buckets[count].size = 0;
+    }
+    lfu->used = 0;
+
+    for (int count = 0; count <= BM_LFU_MAX_COUNT; count++)
+    {
+        int frame = old[count].tail;
+        while (frame >= 0)
+        {
+            int prev = lfu->framePrev[frame];
+            frames[frame].refNum = count / 2;
+            lfuLink(lfu, frame, count / 2);
+            frame = prev;
+        }
+    }
+    lfu->references = 0;
+}
+
+// Release the LFU state of a pool, if it has any
+extern void lfuFree(BM_MGMT_DATA *mgmtData)
+{
+    BM_LFU *lfu = mgmtData->lfu;
+
+    if (lfu == NULL)
+    {
+        return;
+    }
+    free(lfu->framePrev);
+    free(lfu->frameNext);
+    free(lfu->frameBucket);
+    free(lfu);
+    mgmtData->lfu = NULL;
+}
+
+// Set up the LFU state of a pool of numFrames frames; params may be NULL
+extern RC lfuInit(BM_MGMT_DATA *mgmtData, int numFrames, const BM_LFUParams *params)
+{
+    BM_LFU *lfu;
+
+    lfu = (BM_LFU *)calloc(1, sizeof(BM_LFU));
+    if (lfu == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    lfu->agingPeriod = params != NULL ? params->agingPeriod : BM_LFU_DEFAULT_AGING_FACTOR * numFrames;
+    if (lfu->agingPeriod < 0)
+    {
+        free(lfu);
+        return RC_ERROR;
+    }
+
+    lfu->framePrev = (int *)malloc(sizeof(int) * numFrames);
+    lfu->frameNext = (int *)malloc(sizeof(int) * numFrames);
+    lfu->frameBucket = (int *)malloc(sizeof(int) * numFrames);
+    mgmtData->lfu = lfu;
+    if (lfu->framePrev == NULL || lfu->frameNext == NULL || lfu->frameBucket == NULL)
+    {
+        lfuFree(mgmtData);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    for (int count = 0; count <= BM_LFU_MAX_COUNT; count++)
+    {
+        lfu->buckets[count].head = lfu->buckets[count].tail = -1;
+    }
+    for (int i = 0; i < numFrames; i++)
+    {
+        lfu->frameBucket[i] = -1;
+    }
+    return RC_OK;
+}
+
+// Extend the LFU state of a pool from oldFrames to numFrames frames, see resizeBufferPool
+extern RC lfuGrow(BM_MGMT_DATA *mgmtData, int oldFrames, int numFrames)
+{
+    BM_LFU *lfu = mgmtData->lfu;
+
+    if (!growArray(&lfu->framePrev, sizeof(int), numFrames) || !growArray(&lfu->frameNext, sizeof(int), numFrames) ||
+        !growArray(&lfu->frameBucket, sizeof(int), numFrames))
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (int i = oldFrames; i < numFrames; i++)
+    {
+        lfu->frameBucket[i] = -1;
+    }
+    return RC_OK;
+}
+
+// Record a reference to the page in frame: move it to the bucket of its incremented count. A page just read into
+// the frame starts from the count of 0 pinPage gave it
+extern void lfuReference(BM_BufferPool *const bm, int frame)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_LFU *lfu = mgmtData->lfu;
+    PageFrame *pageFrame = &mgmtData->frames[frame];
+
+    if (lfu->frameBucket[frame] >= 0)
+    {
+        lfuUnlink(lfu, frame);
+    }
+    if (pageFrame->refNum < BM_LFU_MAX_COUNT)
+    {
+        pageFrame->refNum++;
+    }
+    lfuLink(lfu, frame, pageFrame->refNum);
+
+    if (lfu->agingPeriod > 0 && ++lfu->references >= lfu->agingPeriod)
+    {
+        lfuAge(lfu, mgmtData->frames);
+    }
+}
+
+// Defining LFU (Least Frequently Used) function. The victim is the least recently referenced unpinned page of the
+// lowest count; pinned pages are skipped, moving on to higher buckets if a whole bucket is pinned
+extern int LFU(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_LFU *lfu = mgmtData->lfu;
+    unsigned long long used = lfu->used;
+
+    while (used != 0)
+    {
+        int count = __builtin_ctzll(used);
+        for (int frame = lfu->buckets[count].tail; frame >= 0; frame = lfu->framePrev[frame])
+        {
+            if (frameUnpinned(&mgmtData->frames[frame]))
+            {
+                lfuUnlink(lfu, frame);
+                return frame;
+            }
+        }
+        used &= used - 1;
+    }
+    return -1;
+}
+
+/* Access strategies */
+
+// Value of frameRing for the frame of a ring slot; no ring has more than BM_RING_BULKWRITE_FRAMES slots
+static inline int ringTag(BM_AccessStrategy access, int slot)
+{
+    return access * BM_RING_BULKWRITE_FRAMES + slot;
+}
+
+extern void ringsFree(BM_MGMT_DATA *mgmtData)
+{
+    for (int access = BM_ACCESS_BULKREAD; access <= BM_ACCESS_BULKWRITE; access++)
+    {
+        free(mgmtData->rings[access].frames);
+        mgmtData->rings[access].frames = NULL;
+    }
+    free(mgmtData->frameRing);
+    mgmtData->frameRing = NULL;
+}
+
+// Allocate the rings of the bulk access strategies, on the first bulk pin. Called with the latch held
+extern RC ringsInit(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int maxFrames = bm->numPages / BM_RING_POOL_SHARE > 1 ? bm->numPages / BM_RING_POOL_SHARE : 1;
+    int access, i;
+
+    if (mgmtData->frameRing != NULL)
+    {
+        return RC_OK;
+    }
+    mgmtData->frameRing = (int *)malloc(sizeof(int) * mgmtData->numFrames);
+    if (mgmtData->frameRing == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    for (i = 0; i < mgmtData->numFrames; i++)
+    {
+        mgmtData->frameRing[i] = -1;
+    }
+    for (access = BM_ACCESS_BULKREAD; access <= BM_ACCESS_BULKWRITE; access++)
+    {
+        BM_Ring *ring = &mgmtData->rings[access];
+        int size = access == BM_ACCESS_BULKREAD ? BM_RING_BULKREAD_FRAMES : BM_RING_BULKWRITE_FRAMES;
+
+        ring->size = size < maxFrames ? size : maxFrames;
+        ring->next = 0;
+        ring->frames = (int *)malloc(sizeof(int) * ring->size);
+        if (ring->frames == NULL)
+        {
+            ringsFree(mgmtData);
+            return RC_MEMORY_ALLOCATION_FAILED;
+        }
+        for (i = 0; i < ring->size; i++)
+        {
+            ring->frames[i] = -1;
+        }
+    }
+    return RC_OK;
+}
+
+// Fit the rings to a pool resized to bm->numPages frames: a ring keeps its share of the pool, and the frames of the
+// slots it loses and the frames past numPages leave their rings. A ring that cannot grow keeps its size. Called with
+// the latch held
+extern void ringsResize(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int maxFrames = bm->numPages / BM_RING_POOL_SHARE > 1 ? bm->numPages / BM_RING_POOL_SHARE : 1;
+    int access, i;
+
+    if (mgmtData->frameRing == NULL)
+    {
+        return;
+    }
+    for (access = BM_ACCESS_BULKREAD; access <= BM_ACCESS_BULKWRITE; access++)
+    {
+        BM_Ring *ring = &mgmtData->rings[access];
+        int size = access == BM_ACCESS_BULKREAD ? BM_RING_BULKREAD_FRAMES : BM_RING_BULKWRITE_FRAMES;
+
+        size = size < maxFrames ? size : maxFrames;
+        if (size > ring->size && !growArray(&ring->frames, sizeof(int), size))
+        {
+            size = ring->size;
+        }
+        for (i = 0; i < ring->size; i++)
+        {
+            int frame = ring->frames[i];
+            if (frame >= 0 && (i >= size || frame >= bm->numPages))
+            {
+                if (mgmtData->frameRing[frame] == ringTag(access, i))
+                {
+                    mgmtData->frameRing[frame] = -1;
+                }
+                ring->frames[i] = -1;
+            }
+        }
+        for (i = ring->size; i < size; i++)
+        {
+            ring->frames[i] = -1;
+        }
+        ring->size = size;
+        ring->next %= size;
+    }
+}
+
+// The frame of the ring's next slot, pinned once for the caller, if the slot still has it and nobody else has it
+// pinned; -1 otherwise, and the caller fills the slot with ringAdopt. A bulk read does not reuse a frame whose
+// page was dirtied meanwhile: the frame is left to the replacement strategy, which writes it back in its time.
+// Called with the latch held
+extern int ringFrame(BM_BufferPool *const bm, BM_AccessStrategy access)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_Ring *ring = &mgmtData->rings[access];
+    int frame = ring->frames[ring->next];
+    int unpinned = 0;
+
+    if (frame < 0 || mgmtData->frameRing[frame] != ringTag(access, ring->next))
+    {
+        return -1;
+    }
+    // CLOCK_SWEEP claims frames without the latch, by the same exchange
+    if (!__atomic_compare_exchange_n(&mgmtData->frames[frame].fixCount, &unpinned, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ||
+        (access == BM_ACCESS_BULKREAD && __atomic_load_n(&mgmtData->frames[frame].dirtyBit, __ATOMIC_ACQUIRE)))
+    {
+        // unpinned still 0: the exchange succeeded and the frame was dirty
+        if (unpinned == 0)
+        {
+            unpinFrame(mgmtData, frame);
+        }
+        mgmtData->frameRing[frame] = -1;
+        return -1;
+    }
+    ring->next = (ring->next + 1) % ring->size;
+    return frame;
+}
+
+// Make frame, just taken from the pool, the frame of the ring's next slot. Called with the latch held
+extern void ringAdopt(BM_BufferPool *const bm, BM_AccessStrategy access, int frame)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    BM_Ring *ring = &mgmtData->rings[access];
+
+    ring->frames[ring->next] = frame;
+    mgmtData->frameRing[frame] = ringTag(access, ring->next);
+    ring->next = (ring->next + 1) % ring->size;
+}
+
+// Replacement bookkeeping for a page read into a ring frame, in place of updatePageReplacementInfo: the page
+// counts as referenced at most once, i.e. it goes to LFU's lowest bucket, to T1 or A1in even if ARC or 2Q
+// remember it on a ghost list, and to LRU-K with a history of one reference, and a frame the ring reuses keeps its
+// place. The frame-scanning strategies see the hitNum of 0 the frame was given
+extern void bulkReference(BM_BufferPool *const bm, int frame)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    if (bm->strategy == RS_LFU && mgmtData->lfu->frameBucket[frame] < 0)
+    {
+        mgmtData->frames[frame].refNum = 0;
+        lfuLink(mgmtData->lfu, frame, 0);
+    }
+    else if ((bm->strategy == RS_ARC || bm->strategy == RS_2Q) && mgmtData->queues->frameList[frame] < 0)
+    {
+        queuesPushFrame(mgmtData->queues, 0, frame);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        BM_LRUK *lruk = mgmtData->lruk;
+
+        // a single reference, without the history a ghost of the page kept; a frame in the heap keeps its place
+        if (lruk->heapPos[frame] < 0)
+        {
+            unsigned long *hist = &lruk->hist[(size_t)frame * lruk->k];
+            memset(hist, 0, sizeof(unsigned long) * lruk->k);
+            hist[0] = lruk->last[frame] = ++lruk->clock;
+            lrukHeapPush(lruk, frame);
+        }
+        lruk->framePage[frame] = mgmtData->frames[frame].pageNum;
+    }
+}
+
+/* Free and retired frames */
+
+// Take frame i out of the state of the structured strategies, which then never offer it again. Called with the
+// latch held
+static void unlinkFrame(BM_MGMT_DATA *mgmtData, int i)
+{
+    if (mgmtData->lfu != NULL && mgmtData->lfu->frameBucket[i] >= 0)
+    {
+        lfuUnlink(mgmtData->lfu, i);
+    }
+    if (mgmtData->queues != NULL && mgmtData->queues->frameList[i] >= 0)
+    {
+        queuesRemoveFrame(mgmtData->queues, i);
+    }
+    if (mgmtData->lruk != NULL)
+    {
+        if (mgmtData->lruk->heapPos[i] >= 0)
+        {
+            lrukHeapRemove(mgmtData->lruk, i);
+        }
+        mgmtData->lruk->framePage[i] = NO_PAGE;
+    }
+}
+
+// Make the empty frame i a free frame. Called with the latch held
+extern void freeFrame(BM_MGMT_DATA *mgmtData, int i)
+{
+    if (!mgmtData->frameFree[i])
+    {
+        mgmtData->frameFree[i] = true;
+        mgmtData->freeFrames[mgmtData->numFreeFrames++] = i;
+    }
+}
+
+// Forget the page of frame i, which is not pinned, without writing it back: the frame leaves the page table and the
+// replacement state and joins the free frames. Called with the latch held
+extern void dropFrame(BM_BufferPool *const bm, int i)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageFrame *frame = &mgmtData->frames[i];
+
+    pageTableRemove(&mgmtData->pageTable, frame->pageNum);
+    __atomic_store_n(&frame->pageNum, NO_PAGE, __ATOMIC_RELEASE);
+    __atomic_store_n(&frame->dirtyBit, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&frame->hitNum, 0, __ATOMIC_RELAXED);
+    frame->refNum = 0;
+
+    // it is only reused from the free frames
+    unlinkFrame(mgmtData, i);
+    freeFrame(mgmtData, i);
+}
+
+// A free frame, pinned once for the caller, or -1 if there is none. Frames that got a page since they were freed,
+// from a frame-scanning strategy or CLOCK_SWEEP, or that a shrink retired are passed over. Called with the latch held
+extern int takeFreeFrame(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    while (mgmtData->numFreeFrames > 0)
+    {
+        int frame = mgmtData->freeFrames[--mgmtData->numFreeFrames];
+        int unpinned = 0;
+
+        mgmtData->frameFree[frame] = false;
+        if (frame < bm->numPages && __atomic_load_n(&mgmtData->frames[frame].pageNum, __ATOMIC_ACQUIRE) == NO_PAGE &&
+            __atomic_compare_exchange_n(&mgmtData->frames[frame].fixCount, &unpinned, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            return frame;
+        }
+    }
+    return -1;
+}
+
+// Drop the pages of frames retired by a shrink that are neither pinned, dirty nor being read, and give the frames'
+// memory back. Called with the latch held, while frames are retiring on every miss, flush and background writer
+// round, so a shrink completes as the pages it retired are unpinned and written back
+extern void retireFrames(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    for (int i = bm->numPages; i < mgmtData->numFrames && mgmtData->numRetiring > 0; i++)
+    {
+        PageFrame *frame = &mgmtData->frames[i];
+        int unpinned = 0;
+
+        // claimed first, so that the page is not marked dirty by a pin before it goes
+        if (frame->pageNum == NO_PAGE || frame->ioInProgress ||
+            !__atomic_compare_exchange_n(&frame->fixCount, &unpinned, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            continue;
+        }
+        if (__atomic_load_n(&frame->dirtyBit, __ATOMIC_ACQUIRE) == 0)
+        {
+            pageTableRemove(&mgmtData->pageTable, frame->pageNum);
+            __atomic_store_n(&frame->pageNum, NO_PAGE, __ATOMIC_RELEASE);
+            __atomic_store_n(&frame->hitNum, 0, __ATOMIC_RELAXED);
+            frame->refNum = 0;
+            releaseFrameData(bm, i);
+            mgmtData->numRetiring--;
+        }
+        unpinFrame(mgmtData, i);
+    }
+}
+
+/* Warm restart */
+
+// A frame and the key it is sorted by, ties kept in the order collected
+typedef struct BM_WarmKey
+{
+    unsigned long key;
+    int pos;
+    int frame;
+} BM_WarmKey;
+
+static int compareWarmKeys(const void *a, const void *b)
+{
+    const BM_WarmKey *x = (const BM_WarmKey *)a, *y = (const BM_WarmKey *)b;
+
+    if (x->key != y->key)
+    {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->pos - y->pos;
+}
+
+static void warmAdd(BM_MGMT_DATA *mgmtData, BM_WarmPage *pages, int *n, int frame)
+{
+    PageFrame *pageFrame = &mgmtData->frames[frame];
+
+    if (pageFrame->pageNum != NO_PAGE && !pageFrame->ioInProgress)
+    {
+        pages[*n].pageNum = (PageNumber)pageFrame->pageNum; // a warm pool is never shared, its keys are page numbers
+        pages[*n].hitNum = __atomic_load_n(&pageFrame->hitNum, __ATOMIC_RELAXED);
+        pages[*n].refNum = pageFrame->refNum;
+        (*n)++;
+    }
+}
+
+// Collect the pages resident in the frames of bm into pages, bm->numPages entries at most, from the least to the
+// most recently referenced as far as the strategy keeps an order: that of its lists or buckets, of the history of
+// LRU-K, of the hit counts of LRU, else of the frames from where FIFO and the clocks look for their next victim.
+// Returns the number of pages. Called with the latch held
+extern int warmOrder(BM_BufferPool *const bm, BM_WarmPage *pages)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int numPages = bm->numPages, start = replacementStart(bm);
+    int f, k, n = 0;
+
+    if (mgmtData->queues != NULL)
+    {
+        // T1 before T2, A1in before Am, each from its tail
+        for (k = 0; k < 2; k++)
+        {
+            for (f = mgmtData->queues->lists[k].tail; f >= 0; f = mgmtData->queues->framePrev[f])
+            {
+                warmAdd(mgmtData, pages, &n, f);
+            }
+        }
+        return n;
+    }
+    if (mgmtData->lfu != NULL)
+    {
+        for (k = 0; k <= BM_LFU_MAX_COUNT; k++)
+        {
+            for (f = mgmtData->lfu->buckets[k].tail; f >= 0; f = mgmtData->lfu->framePrev[f])
+            {
+                warmAdd(mgmtData, pages, &n, f);
+            }
+        }
+        return n;
+    }
+    if (bm->strategy != RS_LRU && bm->strategy != RS_LRU_K)
+    {
+        for (k = 0; k < numPages; k++)
+        {
+            warmAdd(mgmtData, pages, &n, (start + k) % numPages);
+        }
+        return n;
+    }
+
+    BM_WarmKey *keys = (BM_WarmKey *)malloc(sizeof(BM_WarmKey) * numPages);
+    if (keys == NULL)
+    {
+        return 0;
+    }
+    for (k = 0; k < numPages; k++)
+    {
+        keys[k].key = bm->strategy == RS_LRU ? (unsigned long)mgmtData->frames[k].hitNum : mgmtData->lruk->last[k];
+        keys[k].pos = k;
+        keys[k].frame = k;
+    }
+    qsort(keys, numPages, sizeof(BM_WarmKey), compareWarmKeys);
+    for (k = 0; k < numPages; k++)
+    {
+        warmAdd(mgmtData, pages, &n, keys[k].frame);
+    }
+    free(keys);
+    return n;
+}
+
+// Give the frames just claimed for the n warm pages, in their order, the counts the pages had at shutdown
+// (the order itself the claims restored). Called with the latch held
+extern void warmRestore(BM_BufferPool *const bm, const BM_WarmPage *pages, int n)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    for (int k = 0; k < n; k++)
+    {
+        int i = pageTableLookup(&mgmtData->pageTable, pages[k].pageNum);
+        if (i < 0)
+        {
+            continue;
+        }
+        if (bm->strategy == RS_LRU || bm->strategy == RS_CLOCK)
+        {
+            mgmtData->frames[i].hitNum = pages[k].hitNum;
+        }
+        else if (bm->strategy == RS_CLOCK_SWEEP)
+        {
+            int usage = pages[k].hitNum < BM_SWEEP_MAX_USAGE ? pages[k].hitNum : BM_SWEEP_MAX_USAGE;
+            __atomic_store_n(&mgmtData->frames[i].hitNum, usage < 0 ? 0 : usage, __ATOMIC_RELAXED);
+        }
+        else if (bm->strategy == RS_LFU && mgmtData->lfu->frameBucket[i] >= 0)
+        {
+            int count = pages[k].refNum < BM_LFU_MAX_COUNT ? pages[k].refNum : BM_LFU_MAX_COUNT;
+            lfuUnlink(mgmtData->lfu, i);
+            mgmtData->frames[i].refNum = count < 0 ? 0 : count;
+            lfuLink(mgmtData->lfu, i, mgmtData->frames[i].refNum);
+        }
+    }
+}
+
+// Name of the warm restart file of page file fileName, with suffix appended; the caller frees it
+static char *warmFileName(const char *fileName, const char *suffix)
+{
+    char *name = (char *)malloc(strlen(fileName) + strlen(".warm") + strlen(suffix) + 1);
+    if (name != NULL)
+        sprintf(name, "%s.warm%s", fileName, suffix);
+    return name;
+}
+
+// Replace the warm restart file of fileName by one holding the n pages. It is written aside and renamed over the
+// old one, so a crash leaves either file whole
+extern RC writeWarmFile(const char *fileName, ReplacementStrategy strategy, const BM_WarmPage *pages, int n)
+{
+    BM_WarmHeader header = {BM_WARM_MAGIC, strategy, n};
+    char *name = warmFileName(fileName, ""), *tmpName = warmFileName(fileName, ".tmp");
+    RC result = RC_WRITE_FAILED;
+    FILE *file;
+
+    if (name == NULL || tmpName == NULL)
+    {
+        free(name);
+        free(tmpName);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    file = fopen(tmpName, "wb");
+    if (file != NULL)
+    {
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       (n == 0 || fwrite(pages, sizeof(BM_WarmPage), n, file) == (size_t)n);
+        if (fclose(file) == 0 && written && rename(tmpName, name) == 0)
+        {
+            result = RC_OK;
+        }
+        else
+        {
+            remove(tmpName);
+        }
+    }
+    free(name);
+    free(tmpName);
+    return result;
+}
+
+// Read the warm restart file of fileName into *header and return its pages, which the caller frees, or NULL when
+// there is no file or it is not one whole
+extern BM_WarmPage *readWarmFile(const char *fileName, BM_WarmHeader *header)
+{
+    char *name = warmFileName(fileName, "");
+    BM_WarmPage *pages = NULL;
+    FILE *file = name != NULL ? fopen(name, "rb") : NULL;
+    long size;
+
+    free(name);
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    if (fread(header, sizeof(*header), 1, file) == 1 && header->magic == BM_WARM_MAGIC && header->numPages >= 0 &&
+        fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 &&
+        (unsigned long)size == sizeof(*header) + (unsigned long)header->numPages * sizeof(BM_WarmPage) &&
+        fseek(file, sizeof(*header), SEEK_SET) == 0)
+    {
+        pages = (BM_WarmPage *)malloc(sizeof(BM_WarmPage) * (header->numPages > 0 ? header->numPages : 1));
+        if (pages != NULL && fread(pages, sizeof(BM_WarmPage), header->numPages, file) != (size_t)header->numPages)
+        {
+            free(pages);
+            pages = NULL;
+        }
+    }
+    fclose(file);
+    return pages;
+}
+
+// Remove the warm restart file of page file pageFileName, whose pages no pool may hold any more. The record belongs
+// to the file's contents and must not outlive them: a new file of the same name starts cold
+extern RC dropWarmState(const char *const pageFileName)
+{
+    char *name = warmFileName(pageFileName, "");
+
+    if (name == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    remove(name);
+    free(name);
+    return RC_OK;
 }
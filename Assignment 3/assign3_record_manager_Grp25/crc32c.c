@@ -0,0 +1,165 @@
+#include <string.h>
+#include "crc32c.h"
+
+/*
+   CRC-32C with the reflected Castagnoli polynomial 0x82F63B78.
+   The portable version processes 8 bytes per step with 8 lookup tables (slicing-by-8); on x86 the SSE4.2
+   crc32 instruction computes the same function 8 bytes per instruction. The instruction has a latency of
+   three cycles, so the hardware version runs three independent lanes and merges them afterwards.
+   The choice is made once, at run time.
+*/
+
+#define CRC32C_POLY 0x82F63B78
+#define CRC_LANE 1360 // bytes per lane of the 3-way loop: three lanes cover a 4 KB page but 16 bytes
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define CRC32C_HAVE_SSE42
+#endif
+
+static uint32_t crcTable[8][256];
+static uint32_t laneShift[4][256]; // advances a CRC register over CRC_LANE zero bytes, a byte of it at a time
+static int crcTableReady = 0;
+
+// Build the slicing-by-8 tables; concurrent first calls compute the same values
+static void buildTables(void)
+{
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+        crcTable[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++)
+        for (int t = 1; t < 8; t++)
+            crcTable[t][n] = (crcTable[t - 1][n] >> 8) ^ crcTable[0][crcTable[t - 1][n] & 0xFF];
+
+    // the shift is linear: shift every single bit over the zeros once, then combine them per byte value
+    uint32_t bitShift[32];
+    for (int bit = 0; bit < 32; bit++)
+    {
+        uint32_t crc = 1U << bit;
+        for (int k = 0; k < CRC_LANE; k++)
+            crc = (crc >> 8) ^ crcTable[0][crc & 0xFF];
+        bitShift[bit] = crc;
+    }
+    for (int t = 0; t < 4; t++)
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t crc = 0;
+            for (int b = 0; b < 8; b++)
+                if (n & (1U << b))
+                    crc ^= bitShift[8 * t + b];
+            laneShift[t][n] = crc;
+        }
+    crcTableReady = 1;
+}
+
+// CRC register after running crc over CRC_LANE zero bytes
+static uint32_t shiftLane(uint32_t crc)
+{
+    return laneShift[0][crc & 0xFF] ^ laneShift[1][(crc >> 8) & 0xFF] ^
+           laneShift[2][(crc >> 16) & 0xFF] ^ laneShift[3][crc >> 24];
+}
+
+static uint32_t crcSoftware(uint32_t crc, const unsigned char *p, size_t len)
+{
+    if (!crcTableReady)
+        buildTables();
+
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, 8); // loaded little-endian, big-endian hosts would need a byte swap here
+        word ^= crc;
+        crc = crcTable[7][word & 0xFF] ^ crcTable[6][(word >> 8) & 0xFF] ^
+              crcTable[5][(word >> 16) & 0xFF] ^ crcTable[4][(word >> 24) & 0xFF] ^
+              crcTable[3][(word >> 32) & 0xFF] ^ crcTable[2][(word >> 40) & 0xFF] ^
+              crcTable[1][(word >> 48) & 0xFF] ^ crcTable[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+__attribute__((target("sse4.2"))) static uint32_t crcHardware(uint32_t crc, const unsigned char *p, size_t len)
+{
+#ifdef __x86_64__
+    if (!crcTableReady)
+        buildTables();
+
+    // three lanes of CRC_LANE bytes at a time; lanes two and three start from zero and are merged by
+    // shifting the register over the following lane, crc(A B) = shift(crc(A), |B|) ^ crc0(B)
+    while (len >= 3 * CRC_LANE)
+    {
+        uint64_t c0 = crc, c1 = 0, c2 = 0;
+        for (int i = 0; i < CRC_LANE; i += 8)
+        {
+            uint64_t w0, w1, w2;
+            memcpy(&w0, p + i, 8);
+            memcpy(&w1, p + CRC_LANE + i, 8);
+            memcpy(&w2, p + 2 * CRC_LANE + i, 8);
+            c0 = _mm_crc32_u64(c0, w0);
+            c1 = _mm_crc32_u64(c1, w1);
+            c2 = _mm_crc32_u64(c2, w2);
+        }
+        crc = shiftLane((uint32_t)c0) ^ (uint32_t)c1;
+        crc = shiftLane(crc) ^ (uint32_t)c2;
+        p += 3 * CRC_LANE;
+        len -= 3 * CRC_LANE;
+    }
+
+    uint64_t crc64 = crc;
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len >= 4)
+    {
+        uint32_t word;
+        memcpy(&word, p, 4);
+        crc = _mm_crc32_u32(crc, word);
+        p += 4;
+        len -= 4;
+    }
+    while (len-- > 0)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+int crc32cHardware(void)
+{
+#ifdef CRC32C_HAVE_SSE42
+    static int hardware = -1;
+    if (hardware < 0)
+        hardware = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    return hardware;
+#else
+    return 0;
+#endif
+}
+
+uint32_t crc32c(const void *buf, size_t len)
+{
+#ifdef CRC32C_HAVE_SSE42
+    if (crc32cHardware())
+        return ~crcHardware(~0U, (const unsigned char *)buf, len);
+#endif
+    return ~crcSoftware(~0U, (const unsigned char *)buf, len);
+}
+
+uint32_t crc32cPortable(const void *buf, size_t len)
+{
+    return ~crcSoftware(~0U, (const unsigned char *)buf, len);
+}
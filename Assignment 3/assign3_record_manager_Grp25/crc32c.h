@@ -0,0 +1,17 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32C (Castagnoli) of len bytes, as used for page checksums.
+   Uses the SSE4.2 crc32 instruction when the CPU has it and a table driven version otherwise */
+extern uint32_t crc32c (const void *buf, size_t len);
+
+/* the table driven version, whatever the CPU supports */
+extern uint32_t crc32cPortable (const void *buf, size_t len);
+
+/* 1 if crc32c runs on the SSE4.2 instruction */
+extern int crc32cHardware (void);
+
+#endif
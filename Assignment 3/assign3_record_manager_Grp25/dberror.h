@@ -45,6 +45,14 @@ typedef int RC;
 #define RC_MEMORY_ALLOCATION_FAILED 611;
 #define RC_INVALID_REPLACEMENT_STRATEGY 612;
 
+#define RC_ASYNC_QUEUE_FULL 700
+#define RC_ASYNC_BACKEND_UNAVAILABLE 701
+#define RC_MAP_FAILED 702
+#define RC_UNALIGNED_BUFFER 703
+#define RC_PAGE_CHECKSUM_MISMATCH 704
+#define RC_INVALID_PAGE_SIZE 705
+#define RC_PAGE_NOT_READY 706
+
 /* holder for error messages */
 extern char *RC_message;
 
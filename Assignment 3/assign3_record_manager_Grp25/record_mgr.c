@@ -6,10 +6,31 @@
 #include "storage_mgr.h"
 #include "record_mgr_helper.c"
 
-const int MAX_NUMBER_OF_PAGES = 100;
+const int MAX_NUMBER_OF_PAGES = 100; // frames of the buffer pool shared by all tables
 const int ATTRIBUTE_SIZE = 15; // Size of the name of the attribute
 
-RecordManager *recordManager;
+BM_BufferPool tablePool; // every table is attached to it, so all tables draw on one memory budget
+RecordManager *openTables; // the open tables, each holding its own view of tablePool
+
+// Detach an open table's page file from the buffer pool and release its record manager data. Fails, and leaves
+// the table open, while pages of it are pinned
+static RC detachTable(RecordManager *tableManager)
+{
+    RC result = shutdownBufferPool(&tableManager->bufferPool);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+
+    RecordManager **link = &openTables;
+    while (*link != tableManager)
+    {
+        link = &(*link)->nextTable;
+    }
+    *link = tableManager->nextTable;
+    free(tableManager);
+    return RC_OK;
+}
 
 // ******** TABLE AND RECORD MANAGER FUNCTIONS ******** //
 
@@ -18,32 +39,42 @@ extern RC initRecordManager(void *mgmtData)
 {
     // Initializing Storage Manager
     initStorageManager();
-    return RC_OK;
+
+    // Initialize the Buffer Pool shared by the tables using LRU page replacement policy
+    return initSharedBufferPool(&tablePool, MAX_NUMBER_OF_PAGES, RS_LRU, NULL);
 }
 
 // This functions shuts down the Record Manager
 extern RC shutdownRecordManager()
 {
-    // Freeing Record Manager memory
-    free(recordManager);
-    recordManager = NULL; // Set to NULL after freeing
-    return RC_OK;
+    // Detach the tables left open; the buffer pool is only released once none of them has a page pinned
+    while (openTables != NULL)
+    {
+        RC result = detachTable(openTables);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+    }
+
+    // Write the pages of all tables back and release the buffer pool
+    return shutdownBufferPool(&tablePool);
 }
 
 // This function creates a TABLE with table name "name" having schema specified by "schema"
 extern RC createTable(char *name, Schema *schema)
 {
-    // Allocate memory space to the record manager custom data structure
-    recordManager = (RecordManager *)malloc(sizeof(RecordManager));
-    if (recordManager == NULL)
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
+
+// Same as createTable, storing the table in pages of pageSize bytes (see createPageFileWithPageSize)
+extern RC createTableWithPageSize(char *name, Schema *schema, int pageSize)
+{
+    char *data = (char *)calloc(1, pageSize);
+    if (data == NULL)
     {
         return RC_MEMORY_ALLOCATION_ERROR;
     }
-
-    // Initialize the Buffer Pool using LFU page replacement policy
-    initBufferPool(&recordManager->bufferPool, name, MAX_NUMBER_OF_PAGES, RS_LRU, NULL);
-
-    char data[PAGE_SIZE];
     char *pageHandle = data;
 
     // Initialize metadata in the buffer
@@ -76,52 +107,65 @@ extern RC createTable(char *name, Schema *schema)
 
     // Create a page file with the table name using the storage manager
     int result;
-    if ((result = createPageFile(name)) != RC_OK)
+    if ((result = createPageFileWithPageSize(name, pageSize)) != RC_OK)
     {
-        free(recordManager);
+        free(data);
         return result;
     }
 
     // Open the newly created page file
     if ((result = openPageFile(name, &fileHandle)) != RC_OK)
     {
-        free(recordManager);
+        free(data);
         return result;
     }
 
     // Write the schema to the first block of the page file
-    if ((result = writeBlock(0, &fileHandle, data)) != RC_OK)
-    {
-        free(recordManager);
-        return result;
-    }
-
-    // Close the file after writing
-    if ((result = closePageFile(&fileHandle)) != RC_OK)
+    result = writeBlock(0, &fileHandle, data);
+    free(data);
+    if (result != RC_OK)
     {
-        free(recordManager);
         return result;
     }
 
-    return RC_OK;
+    // Close the file after writing; openTable attaches it to the buffer pool
+    return closePageFile(&fileHandle);
 }
 
 // This function opens the table with table name "name"
 extern RC openTable(RM_TableData *rel, char *name)
 {
     SM_PageHandle pageHandle;
+    RC result;
 
-    // Setting table's metadata to our custom record manager metadata structure
-    rel->mgmtData = recordManager;
-    // Setting the table's name
-    rel->name = name;
+    // Allocate memory space to the record manager custom data structure
+    RecordManager *recordManager = (RecordManager *)calloc(1, sizeof(RecordManager));
+    if (recordManager == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    // Attach the table's page file to the buffer pool shared by all tables
+    if ((result = attachBufferPool(&recordManager->bufferPool, &tablePool, name, SM_OPEN_DEFAULT)) != RC_OK)
+    {
+        free(recordManager);
+        return result;
+    }
+    recordManager->nextTable = openTables;
+    openTables = recordManager;
 
     // Pinning a page, putting a page in the Buffer Pool using Buffer Manager
     if (pinPage(&recordManager->bufferPool, &recordManager->pageHandle, 0) != RC_OK)
     {
+        detachTable(recordManager);
         return RC_PIN_PAGE_FAILED;
     }
 
+    // Setting table's metadata to our custom record manager metadata structure
+    rel->mgmtData = recordManager;
+    // Setting the table's name
+    rel->name = name;
+
     // Setting the initial pointer (0th location) to the record manager's page data
     pageHandle = (char *)recordManager->pageHandle.data;
 
@@ -137,6 +181,9 @@ extern RC openTable(RM_TableData *rel, char *name)
     int attributeCount = *(int *)pageHandle;
     pageHandle += sizeof(int);
 
+    // Skipping the key size written by createTable; the key attributes themselves are not stored
+    pageHandle += sizeof(int);
+
     // Allocate memory space for 'schema'
     Schema *schema = (Schema *)malloc(sizeof(Schema));
 
@@ -176,6 +223,8 @@ extern RC openTable(RM_TableData *rel, char *name)
     if (unpinPage(&recordManager->bufferPool, &recordManager->pageHandle) != RC_OK)
     {
         freeSchema(schema);
+        rel->mgmtData = NULL;
+        detachTable(recordManager);
         return RC_UNPIN_PAGE_FAILED;
     }
 
@@ -183,6 +232,8 @@ extern RC openTable(RM_TableData *rel, char *name)
     if (forcePage(&recordManager->bufferPool, &recordManager->pageHandle) != RC_OK)
     {
         freeSchema(schema);
+        rel->mgmtData = NULL;
+        detachTable(recordManager);
         return RC_FORCE_PAGE_FAILED;
     }
 
@@ -199,9 +250,15 @@ extern RC closeTable(RM_TableData *rel)
         return RC_OK; // Already closed, nothing to do
     }
 
-    rel->mgmtData = NULL; // set relation to NULL to close
+    RecordManager *tableManager = rel->mgmtData;
 
-    return RC_OK;
+    // Write the table's pages back and detach it; the other tables' pages in the buffer pool are left alone
+    RC result = detachTable(tableManager);
+    if (result == RC_OK)
+    {
+        rel->mgmtData = NULL; // set relation to NULL to close
+    }
+    return result;
 }
 
 // This function returns the number of tuples (records) in the table referenced by "rel"
@@ -220,6 +277,23 @@ extern int getNumTuples(RM_TableData *rel)
 // This function deletes the table having table name "name"
 extern RC deleteTable(char *name)
 {
+    // Where the table is still open its pages are discarded from the buffer pool, not written back, and its page
+    // file detached; its RM_TableData must not be used any more
+    RecordManager *tableManager = openTables;
+    while (tableManager != NULL)
+    {
+        RecordManager *nextTable = tableManager->nextTable;
+        if (strcmp(tableManager->bufferPool.pageFile, name) == 0)
+        {
+            dropFilePages(&tableManager->bufferPool);
+            if (detachTable(tableManager) != RC_OK)
+            {
+                return RC_DELETE_TABLE_FAILED;
+            }
+        }
+        tableManager = nextTable;
+    }
+
     RC result = destroyPageFile(name);
 
     int deletionFailed = (result != RC_OK);
@@ -228,8 +302,8 @@ extern RC deleteTable(char *name)
     {
         return RC_DELETE_TABLE_FAILED;
     }
-
-    return RC_OK;
+    // and the pages a buffer pool recorded of it for a warm restart
+    return dropWarmState(name);
 }
 
 // ******** RECORD FUNCTIONS ******** //
@@ -257,7 +331,7 @@ extern RC insertRecord(RM_TableData *rel, Record *record)
 
     data = recordManager->pageHandle.data;
 
-    recordID->slot = findFreeSlot(data, recordSize);
+    recordID->slot = findFreeSlot(data, recordSize, bufferPool->pageSize);
 
     int newPage;
 
@@ -270,7 +344,7 @@ extern RC insertRecord(RM_TableData *rel, Record *record)
         pinPage(bufferPool, pageHandle, recordID->page);
 
         data = recordManager->pageHandle.data;
-        recordID->slot = findFreeSlot(data, recordSize);
+        recordID->slot = findFreeSlot(data, recordSize, bufferPool->pageSize);
     }
 
     int slotOffset;
@@ -302,7 +376,6 @@ extern RC insertRecord(RM_TableData *rel, Record *record)
 
     unpinPage(bufferPool, pageHandle);
     recordManager->tuplesCount++;
-    pinPage(bufferPool, pageHandle, 0);
 
     return RC_OK;
 }
@@ -463,9 +536,6 @@ extern RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
     }
     RecordManager *scanManager;
 
-    // Open the table in memory
-    openTable(rel, "ScanTable");
-
     // Allocating memory to the scanManager
     size_t sizeOfRecordManager = sizeof(RecordManager);
     scanManager = (RecordManager *)malloc(sizeOfRecordManager);
@@ -613,7 +683,7 @@ extern RC next(RM_ScanHandle *scan, Record *record)
     result = (Value *)malloc(valueSize);
 
     recordSize = getRecordSize(schema);
-    totalSlots = PAGE_SIZE / recordSize;
+    totalSlots = tableManager->bufferPool.pageSize / recordSize;
     int scanCount;
     tuplesCount = tableManager->tuplesCount;
 
@@ -653,7 +723,9 @@ extern RC next(RM_ScanHandle *scan, Record *record)
         BM_PageHandle *pageHandleRef = &scanManager->pageHandle;
         int *recordIDPageRef = &scanManager->recordID.page;
 
-        pinPage(bufferPoolRef, pageHandleRef, *recordIDPageRef);
+        // A scan reads every page once: its pages go through the pool's bulk read ring and do not evict the
+        // pages other operations keep using
+        pinPageWithAccess(bufferPoolRef, pageHandleRef, *recordIDPageRef, BM_ACCESS_BULKREAD);
 
         char *dataPointer;
 
@@ -685,9 +757,9 @@ extern RC next(RM_ScanHandle *scan, Record *record)
 
         int rc = RC_OK;
 
+        unpinPage(newBufferPool, &scanManager->pageHandle);
         if (isResultTrue)
         {
-            unpinPage(newBufferPool, &scanManager->pageHandle);
             return rc;
         }
     }
@@ -952,7 +1024,7 @@ extern RC getAttr(Record *record, Schema *schema, int attrNum, Value **value)
 
         strncpy(additionalVariable, dataPointer, length);
 
-        additionalVariable = '\0';
+        additionalVariable[length] = '\0';
         attribute->dt = DT_STRING;
     }
     else if (dataType == DT_INT)
@@ -23,12 +23,14 @@ typedef struct RecordManager
 	int tuplesCount;
 	int freePage;
 	int scanCount;
+	struct RecordManager *nextTable; // next open table
 } RecordManager;
 
 // table and manager
 extern RC initRecordManager(void *mgmtData);
 extern RC shutdownRecordManager();
 extern RC createTable(char *name, Schema *schema);
+extern RC createTableWithPageSize(char *name, Schema *schema, int pageSize);
 extern RC openTable(RM_TableData *rel, char *name);
 extern RC closeTable(RM_TableData *rel);
 extern RC deleteTable(char *name);
@@ -6,10 +6,10 @@
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 
-int findFreeSlot(char *data, int recordSize)
+int findFreeSlot(char *data, int recordSize, int pageSize)
 {
     int i = 0;
-    int totalSlots = PAGE_SIZE / recordSize;
+    int totalSlots = pageSize / recordSize;
 
     while (i < totalSlots)
     {
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+
+/* scrub tool: verify every page of a page file against its checksum file and report the bad ones
+   usage: scrub [-s] <pagefile>   (-s for segmented page files) */
+
+#define MAX_REPORTED 1000
+
+int main(int argc, char *argv[])
+{
+    int badPages[MAX_REPORTED];
+    int openFlags = SM_OPEN_DEFAULT;
+    int numBad, i;
+    char *fileName = NULL;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0)
+            openFlags |= SM_OPEN_SEGMENTED;
+        else
+            fileName = argv[i];
+    }
+    if (fileName == NULL)
+    {
+        fprintf(stderr, "usage: %s [-s] <pagefile>\n", argv[0]);
+        return 2;
+    }
+
+    initStorageManager();
+    RC rc = scrubPageFile(fileName, openFlags, badPages, MAX_REPORTED, &numBad);
+    if (rc == RC_FILE_NOT_FOUND)
+    {
+        fprintf(stderr, "%s: page file or its checksum file not found\n", fileName);
+        return 2;
+    }
+    if (rc != RC_OK)
+    {
+        fprintf(stderr, "%s: scrub failed with RC %d\n", fileName, rc);
+        return 2;
+    }
+
+    for (i = 0; i < numBad && i < MAX_REPORTED; i++)
+        printf("page %d: checksum mismatch\n", badPages[i]);
+    if (numBad > MAX_REPORTED)
+        printf("... and %d more\n", numBad - MAX_REPORTED);
+    printf("%s: %d bad page%s\n", fileName, numBad, numBad == 1 ? "" : "s");
+    return numBad == 0 ? 0 : 1;
+}
@@ -1,59 +1,818 @@
+#define _GNU_SOURCE // mremap
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include "storage_mgr.h"
+#include "crc32c.h"
 #include "helper.c"
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024 // Linux limit on iovec entries per preadv/pwritev call
+#endif
+
 SM_FileHandle *fileHandle;
 
+/* positioned I/O helpers */
+
+// Read len bytes at offset, retrying on short reads and EINTR. Returns the number of bytes read (less than len at EOF) or -1
+static ssize_t preadFully(int fd, char *buf, size_t len, off_t offset)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = pread(fd, buf + done, len - done, offset + done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EINVAL && done > 0) // O_DIRECT: a short read ended at EOF, the next offset is unaligned
+                break;
+            return -1;
+        }
+        if (n == 0) // end of file
+            break;
+        done += n;
+    }
+    return done;
+}
+
+// Write len bytes at offset, retrying on short writes and EINTR. Returns 0 on success or -1
+static int pwriteFully(int fd, const char *buf, size_t len, off_t offset)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = pwrite(fd, buf + done, len - done, offset + done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+// Transfer the iovec list at offset with preadv/pwritev, retrying on short transfers and EINTR.
+// iov is consumed in place. Returns the number of bytes moved (less than requested only at EOF on reads) or -1
+static ssize_t transferv(int fd, struct iovec *iov, int iovcnt, off_t offset, int isWrite)
+{
+    ssize_t done = 0;
+    while (iovcnt > 0)
+    {
+        int batch = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+        ssize_t n = isWrite ? pwritev(fd, iov, batch, offset) : preadv(fd, iov, batch, offset);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EINVAL && done > 0 && !isWrite) // O_DIRECT: a short read ended at EOF
+                break;
+            return -1;
+        }
+        if (n == 0) // end of file
+            break;
+        done += n;
+        offset += n;
+
+        // skip the buffers that were completely transferred and trim a partially transferred one
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return done;
+}
+
+// Return the descriptor of an open handle, or -1 if the handle was never opened
+static int handleFd(SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return -1;
+    return ((SM_FileMgmt *)fHandle->mgmtInfo)->fd;
+}
+
+/* page checksums */
+
+#define CHECKSUM_VALID 0x43524331      // marks a checksum entry as written
+#define CHECKSUM_BATCH 64               // pages verified per read by the scrubber
+#define CHECKSUM_MAP_STEP (1024 * 1024) // the checksum file and its mapping grow in steps of this many bytes
+
+// Entry of the checksum file, at offset pageNum * sizeof(PageChecksum). Holes and entries past
+// the end of the checksum file read as zeros, i.e. as pages without a checksum
+typedef struct PageChecksum
+{
+    uint32_t crc;
+    uint32_t valid;
+} PageChecksum;
+
+// Name of the checksum file of page file fileName; the caller frees it
+static char *checksumName(const char *fileName)
+{
+    char *name = (char *)malloc(strlen(fileName) + 5);
+    if (name != NULL)
+        sprintf(name, "%s.crc", fileName);
+    return name;
+}
+
+static void removeChecksums(const char *fileName)
+{
+    char *name = checksumName(fileName);
+    if (name != NULL)
+        remove(name);
+    free(name);
+}
+
+// Entries of pages startPage..startPage+count-1 in the mapping of the checksum file, growing the file and the
+// mapping first if needed. The mapping is shared, so all handles on the file see an entry as soon as it is stored
+static PageChecksum *checksumEntries(SM_FileMgmt *mgmt, int startPage, int count)
+{
+    size_t needed = ((size_t)startPage + count) * sizeof(PageChecksum);
+
+    if (needed > mgmt->crcMapSize)
+    {
+        struct stat st;
+        if (fstat(mgmt->crcFd, &st) != 0)
+            return NULL;
+        size_t size = st.st_size;
+        if (size < needed)
+        {
+            size = (needed + CHECKSUM_MAP_STEP - 1) / CHECKSUM_MAP_STEP * CHECKSUM_MAP_STEP;
+            if (ftruncate(mgmt->crcFd, size) != 0)
+                return NULL;
+        }
+
+        void *map;
+        if (mgmt->crcMap == NULL)
+            map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mgmt->crcFd, 0);
+        else
+            map = mremap(mgmt->crcMap, mgmt->crcMapSize, size, MREMAP_MAYMOVE);
+        if (map == MAP_FAILED)
+            return NULL;
+        mgmt->crcMap = map;
+        mgmt->crcMapSize = size;
+    }
+    return (PageChecksum *)mgmt->crcMap + startPage;
+}
+
+// Record (isWrite) or verify the checksums of the consecutive pages held by iov, starting at page startPage.
+// Writes are recorded whenever the file has a checksum file, reads are verified only with SM_OPEN_VERIFY
+static RC checkPages(SM_FileHandle *fHandle, int startPage, const struct iovec *iov, int iovcnt, int isWrite)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    size_t totalBytes = 0;
+    size_t off = 0;
+    int pageSize = fHandle->pageSize;
+    int i = 0;
+
+    if (mgmt->crcFd < 0 || (!isWrite && !(fHandle->openFlags & SM_OPEN_VERIFY)))
+        return RC_OK;
+
+    for (int k = 0; k < iovcnt; k++)
+        totalBytes += iov[k].iov_len;
+    int count = (int)(totalBytes / pageSize);
+
+    PageChecksum *entries = checksumEntries(mgmt, startPage, count);
+    if (entries == NULL)
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    for (int k = 0; k < count; k++)
+    {
+        uint32_t crc = crc32c((char *)iov[i].iov_base + off, pageSize);
+        if (isWrite)
+        {
+            entries[k].crc = crc;
+            entries[k].valid = CHECKSUM_VALID;
+        }
+        else if (entries[k].valid == CHECKSUM_VALID && entries[k].crc != crc)
+            return RC_PAGE_CHECKSUM_MISMATCH;
+
+        off += pageSize;
+        if (off == iov[i].iov_len)
+        {
+            i++;
+            off = 0;
+        }
+    }
+    return RC_OK;
+}
+
+static RC checkPage(SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage, int isWrite)
+{
+    struct iovec iov = {memPage, (size_t)fHandle->pageSize};
+    return checkPages(fHandle, pageNum, &iov, 1, isWrite);
+}
+
+// Mark the checksums of pages startPage..startPage+count-1 as not written before the pages are. A write stores the
+// page first and its checksum after, so in between the page is not checked against the checksum of its old contents
+static RC clearChecksums(SM_FileHandle *fHandle, int startPage, int count)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+
+    if (mgmt->crcFd < 0)
+        return RC_OK;
+    PageChecksum *entries = checksumEntries(mgmt, startPage, count);
+    if (entries == NULL)
+        return RC_WRITE_FAILED;
+    for (int k = 0; k < count; k++)
+        entries[k].valid = 0;
+    return RC_OK;
+}
+
+/* segmented page files */
+
+// Pages held by one file of the handle: a segment, or the whole page file when it is not segmented
+static int segmentPages(SM_FileHandle *fHandle)
+{
+    return (fHandle->openFlags & SM_OPEN_SEGMENTED) ? (int)(SM_SEGMENT_BYTES / fHandle->pageSize) : INT_MAX;
+}
+
+// Offset of the first page in segment file number segment: the page file itself starts with its header
+static off_t segmentBase(SM_FileHandle *fHandle, int segment)
+{
+    return segment == 0 ? ((SM_FileMgmt *)fHandle->mgmtInfo)->dataOffset : 0;
+}
+
+// Name of segment file number segment of page file fileName; the caller frees it
+static char *segmentName(const char *fileName, int segment)
+{
+    char *name = (char *)malloc(strlen(fileName) + 16);
+    if (name != NULL)
+        sprintf(name, "%s.%d", fileName, segment);
+    return name;
+}
+
+// Remove the segment files of fileName, stopping at the first one that does not exist
+static void removeSegments(const char *fileName)
+{
+    for (int segment = 1;; segment++)
+    {
+        char *name = segmentName(fileName, segment);
+        int removed = name != NULL && remove(name) == 0;
+        free(name);
+        if (!removed)
+            break;
+    }
+}
+
+// Descriptor of segment file number segment, opening it and the segments before it on first use.
+// Missing segment files are created if create is set, otherwise -1 is returned for them
+static int segmentFd(SM_FileHandle *fHandle, int segment, int create)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    int osFlags = O_RDWR | ((fHandle->openFlags & SM_OPEN_DIRECT) ? O_DIRECT : 0) | (create ? O_CREAT : 0);
+
+    while (mgmt->numSegments <= segment)
+    {
+        char *name = segmentName(fHandle->fileName, mgmt->numSegments);
+        if (name == NULL)
+            return -1;
+        int fd = open(name, osFlags, 0644);
+        free(name);
+        if (fd < 0)
+            return -1;
+
+        int *segments = (int *)realloc(mgmt->segments, sizeof(int) * (mgmt->numSegments + 1));
+        if (segments == NULL)
+        {
+            close(fd);
+            return -1;
+        }
+        segments[mgmt->numSegments++] = fd;
+        mgmt->segments = segments;
+    }
+    return mgmt->segments[segment];
+}
+
+/* concurrent callers */
+
+// Whether moving pages startPage..startPage+count-1 changes handle state other callers use: the page count, the
+// segment files open, or the mapping of the file or of its checksums. Called with the handle's lock held
+static int changesHandle(SM_FileHandle *fHandle, int startPage, int count)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    int end = startPage + count;
+
+    if (end > fHandle->totalNumPages || (end - 1) / segmentPages(fHandle) >= mgmt->numSegments)
+        return 1;
+    // a read maps the whole file, not just its pages
+    size_t mapped = (size_t)(end > fHandle->totalNumPages ? end : fHandle->totalNumPages) * fHandle->pageSize;
+    if ((fHandle->openFlags & SM_OPEN_MMAP) && mgmt->dataOffset + mapped > mgmt->mapSize)
+        return 1;
+    return mgmt->crcFd >= 0 && (size_t)end * sizeof(PageChecksum) > mgmt->crcMapSize;
+}
+
+// Take the handle's lock to move pages startPage..startPage+count-1: shared, so that the I/O of callers on the
+// same handle overlaps, or exclusive if the transfer has to change the state they share
+static void lockPages(SM_FileHandle *fHandle, int startPage, int count)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+
+    pthread_rwlock_rdlock(&mgmt->lock);
+    if (changesHandle(fHandle, startPage, count))
+    {
+        pthread_rwlock_unlock(&mgmt->lock);
+        pthread_rwlock_wrlock(&mgmt->lock);
+    }
+}
+
+static void unlockHandle(SM_FileHandle *fHandle)
+{
+    pthread_rwlock_unlock(&((SM_FileMgmt *)fHandle->mgmtInfo)->lock);
+}
+
+// Find the file holding page pageNum and the page's offset in it. Offsets are 64-bit, so a single page file
+// can grow past 2 GB; segmented page files additionally keep the pages of every file below SM_SEGMENT_BYTES.
+// Called with the handle's lock held, exclusive if the segment file may have to be opened
+static int pageLocation(SM_FileHandle *fHandle, int pageNum, int create, off_t *offset)
+{
+    int perFile = segmentPages(fHandle);
+    *offset = segmentBase(fHandle, pageNum / perFile) + (off_t)(pageNum % perFile) * fHandle->pageSize;
+    return segmentFd(fHandle, pageNum / perFile, create);
+}
+
+int getPageLocation(SM_FileHandle *fHandle, int pageNum, int create, off_t *offset)
+{
+    if (handleFd(fHandle) < 0 || pageNum < 0)
+        return -1;
+
+    lockPages(fHandle, pageNum, 1);
+    int fd = pageLocation(fHandle, pageNum, create, offset);
+    unlockHandle(fHandle);
+    return fd;
+}
+
+// Re-read the file size; another handle on the same file may have grown it since we opened it
+static void refreshNumPages(SM_FileHandle *fHandle)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    struct stat st;
+
+    // pick up segment files added through other handles
+    if (fHandle->openFlags & SM_OPEN_SEGMENTED)
+        while (segmentFd(fHandle, mgmt->numSegments, 0) >= 0)
+            ;
+
+    // every segment before the last one is full, even if it is sparse
+    int last = mgmt->numSegments - 1;
+    if (fstat(mgmt->segments[last], &st) == 0)
+    {
+        off_t bytes = st.st_size > segmentBase(fHandle, last) ? st.st_size - segmentBase(fHandle, last) : 0;
+        fHandle->totalNumPages = last * segmentPages(fHandle) + (int)((bytes + fHandle->pageSize - 1) / fHandle->pageSize);
+    }
+}
+
+// Return the mapping of an SM_OPEN_MMAP handle's file management data, or NULL for other handles
+static SM_FileMgmt *mappedFile(SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || !(fHandle->openFlags & SM_OPEN_MMAP))
+        return NULL;
+    return (SM_FileMgmt *)fHandle->mgmtInfo;
+}
+
+// Address of page pageNum inside the mapping of an SM_OPEN_MMAP handle
+static char *mappedPage(SM_FileHandle *fHandle, int pageNum)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    return mgmt->map + mgmt->dataOffset + (size_t)pageNum * fHandle->pageSize;
+}
+
+// Whether buf can go to the kernel as is: always, unless the handle bypasses the page cache and buf is unaligned
+static int directReady(SM_FileHandle *fHandle, const void *buf)
+{
+    return !(fHandle->openFlags & SM_OPEN_DIRECT) || (uintptr_t)buf % PAGE_SIZE == 0;
+}
+
+// Aligned scratch page for an SM_OPEN_DIRECT transfer of an unaligned buffer; the caller frees it. Each transfer
+// has its own, so that concurrent callers on the handle do not share one
+static char *bouncePage(SM_FileHandle *fHandle)
+{
+    void *page;
+
+    if (posix_memalign(&page, PAGE_SIZE, fHandle->pageSize) != 0)
+        return NULL;
+    return (char *)page;
+}
+
+// Set the handle's position; concurrent callers each leave theirs
+static void setPosition(SM_FileHandle *fHandle, int pageNum)
+{
+    __atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+}
+
+/* sequential readahead */
+
+// Drop the staged pages if one of the pages startPage..startPage+count-1 is among them, e.g. because it was written
+void dropReadahead(SM_FileHandle *fHandle, int startPage, int count)
+{
+    SM_FileMgmt *mgmt;
+
+    if (fHandle == NULL || (mgmt = (SM_FileMgmt *)fHandle->mgmtInfo) == NULL)
+        return;
+    if (startPage < mgmt->raStart + mgmt->raCount && startPage + count > mgmt->raStart)
+        mgmt->raCount = 0;
+}
+
+// Stage the window of pages starting at pageNum with one preadv. Buffered handles also ask the kernel to start
+// reading the window after it, so that the next refill finds its pages in the page cache
+static void fillReadahead(SM_FileHandle *fHandle, int pageNum)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    int perFile = segmentPages(fHandle);
+    int count = mgmt->raWindow;
+    size_t pageSize = fHandle->pageSize;
+    void *buf;
+
+    // stay within the file, and within the segment file holding pageNum
+    mgmt->raCount = 0;
+    if (count > fHandle->totalNumPages - pageNum)
+        count = fHandle->totalNumPages - pageNum;
+    if (count > perFile - pageNum % perFile)
+        count = perFile - pageNum % perFile;
+    if (count < 2)
+        return;
+
+    if (mgmt->raBuf == NULL)
+    {
+        if (posix_memalign(&buf, PAGE_SIZE, mgmt->raMaxPages * pageSize) != 0)
+            return;
+        mgmt->raBuf = (char *)buf;
+    }
+
+    off_t offset;
+    int fd = pageLocation(fHandle, pageNum, 0, &offset);
+    if (fd < 0)
+        return;
+    struct iovec iov = {mgmt->raBuf, count * pageSize};
+    ssize_t got = transferv(fd, &iov, 1, offset, 0);
+    if (got <= 0) // leave the page to the plain read
+        return;
+
+    // A trailing partial page reads as zeros past the end of the file
+    if ((size_t)got < count * pageSize)
+    {
+        count = (int)((got + pageSize - 1) / pageSize);
+        memset(mgmt->raBuf + got, 0, count * pageSize - got);
+    }
+    mgmt->raStart = pageNum;
+    mgmt->raCount = count;
+
+    if (!(fHandle->openFlags & SM_OPEN_DIRECT))
+    {
+        int next = mgmt->raWindow * 2 < mgmt->raMaxPages ? mgmt->raWindow * 2 : mgmt->raMaxPages;
+        posix_fadvise(fd, offset + (off_t)(count * pageSize), (off_t)(next * pageSize), POSIX_FADV_WILLNEED);
+    }
+}
+
+// Copy pageNum out of the staging buffer, refilling it first while the handle reads sequentially.
+// Returns 1 if memPage holds the page, 0 if the caller has to read it itself
+static int readAhead(SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+
+    if (mgmt->raMaxPages == 0)
+        return 0;
+
+    if (pageNum < mgmt->raStart || pageNum >= mgmt->raStart + mgmt->raCount)
+    {
+        // grow the window while every read follows the previous one, forget it as soon as the reads jump
+        if (pageNum != mgmt->raNextPage)
+            mgmt->raWindow = 0;
+        else if (mgmt->raWindow == 0)
+            mgmt->raWindow = SM_READAHEAD_MIN_PAGES;
+        else
+            mgmt->raWindow *= 2;
+        if (mgmt->raWindow > mgmt->raMaxPages)
+            mgmt->raWindow = mgmt->raMaxPages;
+
+        mgmt->raNextPage = pageNum + 1;
+        if (mgmt->raWindow == 0)
+            return 0;
+        fillReadahead(fHandle, pageNum);
+        if (mgmt->raCount == 0)
+            return 0;
+    }
+
+    mgmt->raNextPage = pageNum + 1;
+    memcpy(memPage, mgmt->raBuf + (size_t)(pageNum - mgmt->raStart) * fHandle->pageSize, fHandle->pageSize);
+    return 1;
+}
+
+// Grow one file to wanted bytes, first reserving disk space up to reserveEnd bytes (0: no reservation)
+static RC growFile(int fd, off_t wanted, off_t reserveEnd)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+        return RC_WRITE_FAILED;
+    if (st.st_size >= wanted)
+        return RC_OK;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    // allocate the extent without changing the file size; file systems without fallocate just skip it
+    if (reserveEnd > st.st_size && fallocate(fd, FALLOC_FL_KEEP_SIZE, st.st_size, reserveEnd - st.st_size) != 0 && errno == ENOSPC)
+        return RC_WRITE_FAILED;
+#endif
+
+    // the size change itself is a metadata update, nothing is zero filled
+    if (ftruncate(fd, wanted) != 0)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+// Grow the page file to numPages pages in one step; the new pages read as zeros. Disk space is reserved past the
+// new end of the file according to the handle's growth policy, so a run of appends does not allocate page by page.
+// Segments before the new last one are filled up to their full size (sparse), new segment files are created
+static RC extendFile(SM_FileHandle *fHandle, int numPages)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    int perFile = segmentPages(fHandle);
+
+    refreshNumPages(fHandle); // another handle may already have grown the file
+    if (numPages <= fHandle->totalNumPages)
+        return RC_OK;
+
+    int reserveEnd = 0;
+    if (numPages > mgmt->reservedPages)
+    {
+        int ahead = mgmt->growth.chunkPages;
+        if (mgmt->growth.sizeDivisor > 0 && numPages / mgmt->growth.sizeDivisor > ahead)
+            ahead = numPages / mgmt->growth.sizeDivisor;
+        reserveEnd = numPages + ahead;
+    }
+
+    int first = fHandle->totalNumPages > 0 ? (fHandle->totalNumPages - 1) / perFile : 0;
+    for (int segment = first; segment <= (numPages - 1) / perFile; segment++)
+    {
+        int fd = segmentFd(fHandle, segment, 1);
+        if (fd < 0)
+            return RC_WRITE_FAILED;
+
+        // page counts relative to the start of this segment, a reservation never spills into the next segment
+        long start = (long)segment * perFile;
+        int pages = (int)((numPages - start < perFile) ? numPages - start : perFile);
+        int reserve = reserveEnd == 0 ? 0 : (int)((reserveEnd - start < perFile) ? reserveEnd - start : perFile);
+
+        off_t base = segmentBase(fHandle, segment);
+        RC rc = growFile(fd, base + (off_t)pages * fHandle->pageSize, reserve == 0 ? 0 : base + (off_t)reserve * fHandle->pageSize);
+        if (rc != RC_OK)
+            return rc;
+    }
+
+    if (reserveEnd > 0)
+        mgmt->reservedPages = reserveEnd;
+    fHandle->totalNumPages = numPages;
+    return RC_OK;
+}
+
+// Make the mapping cover at least numPages pages, growing the file with ftruncate and the mapping with mremap
+static RC mapPages(SM_FileHandle *fHandle, int numPages)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    size_t wanted = mgmt->dataOffset + (size_t)numPages * fHandle->pageSize;
+
+    if (wanted <= mgmt->mapSize)
+        return RC_OK;
+
+    // the file must be at least as long as the mapping, new pages read as zeros
+    RC rc = extendFile(fHandle, numPages);
+    if (rc != RC_OK)
+        return rc;
+
+    void *map;
+    if (mgmt->map == NULL)
+        map = mmap(NULL, wanted, PROT_READ | PROT_WRITE, MAP_SHARED, mgmt->fd, 0);
+    else
+        map = mremap(mgmt->map, mgmt->mapSize, wanted, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED)
+        return RC_MAP_FAILED;
+
+    mgmt->map = (char *)map;
+    mgmt->mapSize = wanted;
+    if (numPages > fHandle->totalNumPages)
+        fHandle->totalNumPages = numPages;
+    return RC_OK;
+}
+
+/* page file header */
+
+#define PAGE_FILE_MAGIC 0x31464750 // "PGF1"
+#define PAGE_FILE_VERSION 1
+
+// Start of the header block, the rest of the block is zero
+typedef struct PageFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageSize;
+} PageFileHeader;
+
+// Page sizes are powers of two between PAGE_SIZE and SM_MAX_PAGE_SIZE, so that pages stay O_DIRECT aligned
+static int validPageSize(int pageSize)
+{
+    return pageSize >= PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+// Read the page size of an open page file from its header. Files written before page sizes were recorded
+// have no header: their PAGE_SIZE pages start at offset 0
+static RC readHeader(SM_FileHandle *fHandle)
+{
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    void *block;
+    RC rc = RC_OK;
+
+    fHandle->pageSize = PAGE_SIZE;
+    mgmt->dataOffset = 0;
+
+    if (posix_memalign(&block, PAGE_SIZE, SM_HEADER_SIZE) != 0) // aligned, the file may be open with O_DIRECT
+        return RC_MEMORY_ALLOCATION_FAILED;
+    PageFileHeader *header = (PageFileHeader *)block;
+    if (preadFully(mgmt->fd, (char *)block, SM_HEADER_SIZE, 0) >= (ssize_t)sizeof(PageFileHeader) && header->magic == PAGE_FILE_MAGIC)
+    {
+        if (validPageSize((int)header->pageSize))
+        {
+            fHandle->pageSize = (int)header->pageSize;
+            mgmt->dataOffset = SM_HEADER_SIZE;
+        }
+        else
+            rc = RC_INVALID_PAGE_SIZE;
+    }
+    free(block);
+    return rc;
+}
+
 /* manipulating page files */
 
 RC createPageFile(char *fileName)
 {
-    // create file pointer and open to write
-    FILE *file = fopen(fileName, "wb"); // write in binary mode
-    // check if file already exists
-    if (file == NULL)
+    return createPageFileWithPageSize(fileName, PAGE_SIZE);
+}
+
+// Create a page file of one empty page with pages of pageSize bytes; the size goes into the file's header
+RC createPageFileWithPageSize(char *fileName, int pageSize)
+{
+    if (!validPageSize(pageSize))
+    {
+        return RC_INVALID_PAGE_SIZE;
+    }
+
+    // create (or truncate) the file and open it for writing
+    int fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    // check if file could be created
+    if (fd < 0)
     {
         return RC_FILE_NOT_FOUND; // return error message if file is not found
     }
-    // using stack allocated buffer to create empty page buffer
+    removeSegments(fileName); // segments left over from an older segmented file of the same name
+    removeChecksums(fileName); // and checksums of its pages
 
-    char emptyPage[PAGE_SIZE] = {'\0'}; // creates empty page and initializes the bytes to \0
+    // header block followed by an empty first page, all bytes initialized to \0
+    char *block = (char *)calloc(1, SM_HEADER_SIZE + pageSize);
+    if (block == NULL)
+    {
+        close(fd);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    PageFileHeader *header = (PageFileHeader *)block;
+    header->magic = PAGE_FILE_MAGIC;
+    header->version = PAGE_FILE_VERSION;
+    header->pageSize = pageSize;
 
-    // Write the empty page to the file using fwrite
-    fwrite(emptyPage, sizeof(char), PAGE_SIZE, file); // successfully writes
+    // Write the header and the empty page as the first blocks of the file
+    int failed = pwriteFully(fd, block, SM_HEADER_SIZE + pageSize, 0);
+    free(block);
     // close the file after the write operation
-    fclose(file);
+    close(fd);
+    if (failed)
+    {
+        return RC_WRITE_FAILED;
+    }
     // return OK message if Successfully created file
     return RC_OK;
 }
 
 RC openPageFile(char *fileName, SM_FileHandle *fHandle)
 {
-    FILE *file = fopen(fileName, "rb+"); // open file in binary mode to perform operations
+    return openPageFileWithFlags(fileName, fHandle, SM_OPEN_DEFAULT);
+}
+
+// Open a page file in the mode selected by openFlags (SM_OPEN_DEFAULT, SM_OPEN_MMAP or SM_OPEN_DIRECT).
+// fHandle->openFlags holds the mode actually used: SM_OPEN_DIRECT is dropped for mapped files and
+// on file systems that do not support O_DIRECT
+RC openPageFileWithFlags(char *fileName, SM_FileHandle *fHandle, int openFlags)
+{
+    int osFlags = O_RDWR;
+    if (openFlags & SM_OPEN_SEGMENTED)
+        openFlags &= ~SM_OPEN_MMAP; // a mapping covers a single file
+    if (openFlags & SM_OPEN_MMAP)
+        openFlags &= ~SM_OPEN_DIRECT; // a mapping always goes through the page cache
+    if (openFlags & SM_OPEN_DIRECT)
+        osFlags |= O_DIRECT;
+
+    int fd = open(fileName, osFlags); // open file for reading and writing; all page I/O goes through this descriptor
+    if (fd < 0 && (osFlags & O_DIRECT) && errno == EINVAL)
+    {
+        // e.g. tmpfs: fall back to buffered I/O
+        openFlags &= ~SM_OPEN_DIRECT;
+        fd = open(fileName, O_RDWR);
+    }
     // check if file is existing and return error if not found
-    if (file == NULL)
+    if (fd < 0)
     {
         return RC_FILE_NOT_FOUND; // File not found
     }
 
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)malloc(sizeof(SM_FileMgmt));
+    int *segments = (int *)malloc(sizeof(int));
+    if (mgmt == NULL || segments == NULL)
+    {
+        free(mgmt);
+        free(segments);
+        close(fd);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+    mgmt->fd = fd;
+    pthread_rwlock_init(&mgmt->lock, NULL);
+    mgmt->dataOffset = 0;
+    segments[0] = fd;
+    mgmt->segments = segments;
+    mgmt->numSegments = 1;
+    mgmt->map = NULL;
+    mgmt->mapSize = 0;
+    mgmt->growth.chunkPages = SM_GROWTH_CHUNK_PAGES;
+    mgmt->growth.sizeDivisor = SM_GROWTH_SIZE_DIVISOR;
+    mgmt->reservedPages = 0;
+    mgmt->crcFd = -1;
+    mgmt->crcMap = NULL;
+    mgmt->crcMapSize = 0;
+    mgmt->raMaxPages = (openFlags & SM_OPEN_READAHEAD) ? SM_READAHEAD_MAX_PAGES : 0;
+    mgmt->raWindow = 0;
+    mgmt->raNextPage = -1;
+    mgmt->raBuf = NULL;
+    mgmt->raStart = 0;
+    mgmt->raCount = 0;
+
     // Initialize the file handle fields
     fHandle->fileName = strdup(fileName); // copy the file name string and store in handle to keep track of name associated with file
-    fHandle->totalNumPages = -1;          // Initialize totalNumPages to -1
     fHandle->curPagePos = 0;              // set current page position to 0, beginning of file; used to keep track of current page being accessed
-    fHandle->mgmtInfo = file;             // store the file as mgmtinfo; to maintain a reference to open file
+    fHandle->openFlags = openFlags;
+    fHandle->pageSize = PAGE_SIZE;
+    fHandle->mgmtInfo = mgmt;             // keep the descriptor open until closePageFile
 
-    // Seek to the end of the file to determine its size
-    fseek(file, 0, SEEK_END);
-    // ftell is called to determine current position of file indicator
-    long fileSize = ftell(file); // store the filesize
+    // Page size and start of the pages, from the file's header
+    RC rc = readHeader(fHandle);
+    if (rc != RC_OK)
+    {
+        closePageFile(fHandle);
+        return rc;
+    }
 
-    // Calculate totalNumPages based on file size
-    fHandle->totalNumPages = (int)((fileSize + PAGE_SIZE - 1) / PAGE_SIZE);
+    // Calculate totalNumPages based on file size, of the last segment file for segmented page files
+    refreshNumPages(fHandle);
 
-    // Rewind to the beginning of the file
-    rewind(file);
+    // Open the checksum file, creating it if checksums are asked for. An existing one is always kept up to date
+    if (openFlags & SM_OPEN_VERIFY)
+        openFlags |= SM_OPEN_CHECKSUM;
+    char *crcName = checksumName(fileName);
+    if (crcName != NULL)
+        mgmt->crcFd = open(crcName, O_RDWR | ((openFlags & SM_OPEN_CHECKSUM) ? O_CREAT : 0), 0644);
+    free(crcName);
+    if (mgmt->crcFd >= 0)
+        openFlags |= SM_OPEN_CHECKSUM;
+    else if (openFlags & SM_OPEN_CHECKSUM)
+    {
+        closePageFile(fHandle);
+        return RC_FILE_NOT_FOUND;
+    }
+    fHandle->openFlags = openFlags;
+
+    // Map every page of the file; a trailing partial page is padded with zeros so the mapping ends on a page
+    if ((openFlags & SM_OPEN_MMAP) && fHandle->totalNumPages > 0)
+    {
+        rc = mapPages(fHandle, fHandle->totalNumPages);
+        if (rc != RC_OK)
+        {
+            closePageFile(fHandle);
+            return rc;
+        }
+    }
 
     // return RC_OK if successful
     return RC_OK; // Page file opened successfully
@@ -64,18 +823,34 @@ RC closePageFile(SM_FileHandle *fHandle)
 {
     if (fHandle->mgmtInfo != NULL) // check if file is open
     {
-        fclose((FILE *)(fHandle->mgmtInfo)); // Close the file
+        SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+        if (mgmt->map != NULL)
+            munmap(mgmt->map, mgmt->mapSize); // shared mapping: the pages are already in the file
+        for (int i = 0; i < mgmt->numSegments; i++)
+            close(mgmt->segments[i]); // Close the descriptors, segments[0] is the page file itself
+        free(mgmt->segments);
+        if (mgmt->crcMap != NULL)
+            munmap(mgmt->crcMap, mgmt->crcMapSize);
+        if (mgmt->crcFd >= 0)
+            close(mgmt->crcFd);
+        free(mgmt->raBuf);
+        pthread_rwlock_destroy(&mgmt->lock);
+        free(mgmt);
+        fHandle->mgmtInfo = NULL;
     }
     // Free memory allocated for fileName
     if (fHandle->fileName != NULL)
     {
         free(fHandle->fileName);
+        fHandle->fileName = NULL;
     }
     return RC_OK; // Page file closed successfully
 }
 
 RC destroyPageFile(char *fileName)
 {
+    removeSegments(fileName); // segment files of a segmented page file, if any
+    removeChecksums(fileName);
     if (remove(fileName) == 0)
     {
         return RC_OK; // Page file destroyed successfully
@@ -93,39 +868,97 @@ void initStorageManager(void)
 }
 
 /* reading blocks from disc */
-RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+
+// Read page pageNum of an open handle, whose lock is held
+static RC readPage(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-    FILE *file = NULL;
-    file = fopen(fHandle->fileName, "r+");
+    int fd;
 
-    if (file == NULL) // check if file exists or not
+    if (pageNum >= fHandle->totalNumPages)
     {
-        // Return a read error code if file open failed
-        return RC_FILE_NOT_FOUND;
+        refreshNumPages(fHandle);
     }
 
-    // We can now move the file pointer to a specific position in the file
-    // The desired block is calculated by multiplying pageNum with PAGE_SIZE
-    long desired_block = pageNum * PAGE_SIZE;
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
 
-    if (fseek(file, desired_block, SEEK_SET) != 0)
+    // The desired block follows the header and pageNum earlier pages; offsets are off_t so large files do not overflow
+    off_t desired_block;
+
+    SM_FileMgmt *mapped = mappedFile(fHandle);
+    if (mapped != NULL)
+    {
+        // Copy straight out of the mapping, no system call unless the file grew behind our back
+        RC rc = mapPages(fHandle, fHandle->totalNumPages);
+        if (rc != RC_OK)
+            return rc;
+        memcpy(memPage, mappedPage(fHandle, pageNum), fHandle->pageSize);
+        setPosition(fHandle, pageNum);
+        return checkPage(fHandle, pageNum, memPage, 0);
+    }
+
+    // A sequential reader gets the page from the readahead window
+    if (readAhead(fHandle, pageNum, memPage))
+    {
+        setPosition(fHandle, pageNum);
+        return checkPage(fHandle, pageNum, memPage, 0);
+    }
+
+    // For segmented page files the page lives in one of the segment files, at an offset within that file
+    fd = pageLocation(fHandle, pageNum, 0, &desired_block);
+    if (fd < 0)
     {
-        // Return a read error code if fseek failed
-        fclose(file); // Close the file before returning the error
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    //  Read the content of the page into the memory page buffer
-    size_t readPage = fread(memPage, sizeof(char), PAGE_SIZE, file);
+    // O_DIRECT needs an aligned buffer, read through the scratch page if the caller's is not
+    char *target = memPage;
+    if (!directReady(fHandle, memPage) && (target = bouncePage(fHandle)) == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    //  Read the content of the page into the memory page buffer with a single positioned read
+    ssize_t readBytes = preadFully(fd, target, fHandle->pageSize, desired_block);
+    if (target != memPage)
+    {
+        if (readBytes > 0)
+        {
+            memcpy(memPage, target, readBytes);
+        }
+        free(target);
+    }
+    if (readBytes < 0)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    // A trailing partial page reads as zeros past the end of the file
+    if (readBytes < fHandle->pageSize)
+    {
+        memset(memPage + readBytes, 0, fHandle->pageSize - readBytes);
+    }
 
     // We update the current page position in the file handle after reading the content.
-    fHandle->curPagePos = ftell(file);
+    setPosition(fHandle, pageNum);
 
-    // Close the file
-    fclose(file);
+    // Return a success code, unless the page does not match its checksum
+    return checkPage(fHandle, pageNum, memPage, 0);
+}
 
-    // Return a success code
-    return RC_OK;
+RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    if (handleFd(fHandle) < 0) // check if the handle refers to an open file
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    lockPages(fHandle, pageNum, 1);
+    RC rc = readPage(pageNum, fHandle, memPage);
+    unlockHandle(fHandle);
+    return rc;
 }
 // Read a specific block from the file
 
@@ -133,7 +966,7 @@ RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 int getBlockPos(SM_FileHandle *fHandle)
 {
     // Return the current page position stored in the file handle
-    int currentBlockPosition = fHandle->curPagePos;
+    int currentBlockPosition = __atomic_load_n(&fHandle->curPagePos, __ATOMIC_RELAXED);
     return currentBlockPosition;
 }
 
@@ -187,44 +1020,112 @@ RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
     return readBlock(lastPageNum, fHandle, memPage);
 }
 
-// Write page to a disk using absolute position
-RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+// Change the largest readahead window of the handle; 0 turns sequential readahead off, a handle opened without
+// SM_OPEN_READAHEAD gets it with any other value
+RC setReadahead(SM_FileHandle *fHandle, int maxPages)
 {
-    // We will initialize the file pointer for file operations.
-    FILE *file = NULL;
-    long desired_block;
-    RC rc;
-    desired_block = pageNum * PAGE_SIZE;   // Here, we are calculating desired block
-    file = fopen(fHandle->fileName, "r+"); // Open file to read and write
+    if (handleFd(fHandle) < 0) // check if file handle is initialized
+        return RC_FILE_HANDLE_NOT_INIT;
 
-    if (file == NULL) // Check if file can be accessed
-        return RC_FILE_NOT_FOUND;
+    if (maxPages < 0)
+        return RC_ERROR;
 
-    if (fHandle == NULL) // Checking if file handle is initialized
-        return RC_FILE_HANDLE_NOT_INIT;
+    // the staging buffer is sized for the old limit, allocate it again on the next refill
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    pthread_rwlock_wrlock(&mgmt->lock);
+    free(mgmt->raBuf);
+    mgmt->raBuf = NULL;
+    mgmt->raMaxPages = maxPages;
+    mgmt->raWindow = 0;
+    mgmt->raCount = 0;
+    pthread_rwlock_unlock(&mgmt->lock);
+    return RC_OK;
+}
 
-    if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        rc = RC_WRITE_FAILED;
+// Hand out a pointer to the page inside the mapping of an SM_OPEN_MMAP handle, without copying it
+RC mapBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle *view)
+{
+    SM_FileMgmt *mapped = mappedFile(fHandle);
 
-    /*else if (pageNum > fHandle->totalNumPages || pageNum < 0) // Check page number boundries
-        return RC_WRITE_FAILED;*/
+    if (mapped == NULL) // only handles opened with SM_OPEN_MMAP have a mapping
+        return RC_MAP_FAILED;
 
-    // Now, we will write the page to the file if all above conditions are false .
-    // We will move file pointer to a specific page in the file by calculating the offset as pageNum * PAGE_SIZE
-    if (fseek(file, desired_block, SEEK_SET) == 0)
+    lockPages(fHandle, pageNum, 1);
+    if (pageNum >= fHandle->totalNumPages)
+        refreshNumPages(fHandle);
+    RC rc = pageNum < 0 || pageNum >= fHandle->totalNumPages ? RC_READ_NON_EXISTING_PAGE : mapPages(fHandle, fHandle->totalNumPages);
+    if (rc == RC_OK)
     {
-        // fseek operation is successful which means file position was moved to desired page.
-        fwrite(memPage, 1, PAGE_SIZE, file); // Now, write content to the file
-        fHandle->curPagePos = pageNum;       // Update current position
-        // return RC_OK if successful
-        return RC_OK;
+        *view = mappedPage(fHandle, pageNum);
+        setPosition(fHandle, pageNum);
+        rc = checkPage(fHandle, pageNum, *view, 0);
+    }
+    unlockHandle(fHandle);
+    return rc;
+}
+
+// Write page pageNum of an open handle, whose lock is held
+static RC writePage(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    int fd;
+    RC rc;
+
+    if ((rc = clearChecksums(fHandle, pageNum, 1)) != RC_OK)
+        return rc;
+
+    SM_FileMgmt *mapped = mappedFile(fHandle);
+    if (mapped != NULL)
+    {
+        // Grow the mapping if the page lies past its end, then store into it
+        rc = mapPages(fHandle, pageNum + 1);
+        if (rc != RC_OK)
+            return rc;
+        memcpy(mappedPage(fHandle, pageNum), memPage, fHandle->pageSize);
+        setPosition(fHandle, pageNum);
+        return checkPage(fHandle, pageNum, memPage, 1);
     }
 
-    // If fseek fails, set the return code to indicate a write failure.
-    else if (fseek(file, desired_block, SEEK_SET) != 0)
+    // O_DIRECT needs an aligned buffer, copy into the scratch page if the caller's is not
+    char *source = memPage;
+    if (!directReady(fHandle, memPage))
+    {
+        if ((source = bouncePage(fHandle)) == NULL)
+            return RC_MEMORY_ALLOCATION_FAILED;
+        memcpy(source, memPage, fHandle->pageSize);
+    }
+
+    // Write the whole page at its offset after the header with a single positioned write;
+    // pages of segmented page files go to their segment file, which is created when needed
+    off_t desired_block;
+    fd = pageLocation(fHandle, pageNum, 1, &desired_block);
+    int failed = fd < 0 || pwriteFully(fd, source, fHandle->pageSize, desired_block) != 0;
+    if (source != memPage)
+        free(source);
+    if (failed)
         return RC_WRITE_FAILED;
+    dropReadahead(fHandle, pageNum, 1); // a staged copy of the page is stale now
+
+    // Writing past the last page grows the file
+    if (pageNum >= fHandle->totalNumPages)
+        fHandle->totalNumPages = pageNum + 1;
 
-    fclose(file);
+    setPosition(fHandle, pageNum); // Update current position
+    // return RC_OK if successful, after recording the page's checksum
+    return checkPage(fHandle, pageNum, memPage, 1);
+}
+
+// Write page to a disk using absolute position
+RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    if (handleFd(fHandle) < 0) // Checking if file handle is initialized
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    if (pageNum < 0) // Check page number boundries
+        return RC_WRITE_FAILED;
+
+    lockPages(fHandle, pageNum, 1);
+    RC rc = writePage(pageNum, fHandle, memPage);
+    unlockHandle(fHandle);
     return rc;
 }
 
@@ -245,66 +1146,337 @@ RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 // Increase the number of pages in the file by 1.
 RC appendEmptyBlock(SM_FileHandle *fHandle)
 {
+    if (handleFd(fHandle) < 0) // check if file handle is initialized
+        return RC_FILE_HANDLE_NOT_INIT;
 
-    if (fHandle == NULL) // check if file handle is initialized
+    // A mapped file also has to grow its mapping. Extend the file by one page; no zero page is written, the new
+    // page reads as zeros
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    pthread_rwlock_wrlock(&mgmt->lock);
+    RC rc = mappedFile(fHandle) != NULL ? mapPages(fHandle, fHandle->totalNumPages + 1)
+                                        : extendFile(fHandle, fHandle->totalNumPages + 1);
+    pthread_rwlock_unlock(&mgmt->lock);
+    return rc;
+}
+
+//  Increase the size to numberOfPages if file has less than numberOfPages pages
+RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle)
+{
+    if (handleFd(fHandle) < 0) // check if file handle is initialized
         return RC_FILE_HANDLE_NOT_INIT;
 
-    FILE *file = NULL;
-    // Open the file in read and write mode
-    file = fopen(fHandle->fileName, "r+");
+    // Nothing to do if the file already has the desired capacity, otherwise grow by all the missing pages at
+    // once instead of appending them one by one
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    RC rc = RC_OK;
+    pthread_rwlock_wrlock(&mgmt->lock);
+    if (numberOfPages > fHandle->totalNumPages)
+        rc = mappedFile(fHandle) != NULL ? mapPages(fHandle, numberOfPages) : extendFile(fHandle, numberOfPages);
+    pthread_rwlock_unlock(&mgmt->lock);
+    return rc;
+}
 
-    if (file == NULL) // check if file can be opened
-        return RC_FILE_NOT_FOUND;
+// Change how far ahead of the end of the file appendEmptyBlock and ensureCapacity reserve disk space
+RC setGrowthPolicy(SM_FileHandle *fHandle, SM_GrowthPolicy policy)
+{
+    if (handleFd(fHandle) < 0) // check if file handle is initialized
+        return RC_FILE_HANDLE_NOT_INIT;
 
-    // Now to append data, we will seek to the end of the file
-    fseek(file, 0, SEEK_END);
+    if (policy.chunkPages < 0 || policy.sizeDivisor < 0)
+        return RC_WRITE_FAILED;
 
-    // Increase the total number of pages in the file handle
-    fHandle->totalNumPages += 1;
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    pthread_rwlock_wrlock(&mgmt->lock);
+    mgmt->growth = policy;
+    pthread_rwlock_unlock(&mgmt->lock);
+    return RC_OK;
+}
 
-    // Allocate memory for an empty page using calloc
-    // Allocate block of memory of size = page_size
+// Flush the pages written through the handle, and the mapping of an SM_OPEN_MMAP file, to the disk
+RC syncPageFile(SM_FileHandle *fHandle)
+{
+    if (handleFd(fHandle) < 0) // check if file handle is initialized
+        return RC_FILE_HANDLE_NOT_INIT;
 
-    char *emptyPage = (char *)calloc(PAGE_SIZE, sizeof(char));
-    if (emptyPage == NULL)
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    RC rc = RC_OK;
+    pthread_rwlock_rdlock(&mgmt->lock);
+    if (mgmt->map != NULL && msync(mgmt->map, mgmt->mapSize, MS_SYNC) != 0)
+        rc = RC_WRITE_FAILED;
+    for (int i = 0; i < mgmt->numSegments && rc == RC_OK; i++)
     {
-        // Check if memory allocation fails
-        fclose(file);
-        return RC_READ_NON_EXISTING_PAGE;
+        if (fdatasync(mgmt->segments[i]) != 0) // segments[0] is the page file itself
+            rc = RC_WRITE_FAILED;
+    }
+    if (rc == RC_OK && mgmt->crcMap != NULL && msync(mgmt->crcMap, mgmt->crcMapSize, MS_SYNC) != 0)
+        rc = RC_WRITE_FAILED;
+    if (rc == RC_OK && mgmt->crcFd >= 0 && fdatasync(mgmt->crcFd) != 0)
+        rc = RC_WRITE_FAILED;
+    pthread_rwlock_unlock(&mgmt->lock);
+    return rc;
+}
+
+/* multi-page (vectored) I/O */
+
+// Move the count pages of totalBytes described by iov, starting at page startPage, with the handle's lock held
+static RC transferPages(int startPage, int count, size_t totalBytes, const struct iovec *iov, int iovcnt,
+                        SM_FileHandle *fHandle, int isWrite)
+{
+    int fd;
+    int i;
+
+    // all pages of a read must exist
+    if (!isWrite && startPage + count > fHandle->totalNumPages)
+    {
+        refreshNumPages(fHandle);
+        if (startPage + count > fHandle->totalNumPages)
+            return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    if (isWrite && clearChecksums(fHandle, startPage, count) != RC_OK)
+        return RC_WRITE_FAILED;
+
+    SM_FileMgmt *mapped = mappedFile(fHandle);
+    if (mapped != NULL)
+    {
+        // Copy page runs between the buffers and the mapping, growing it first for writes past its end
+        RC rc = mapPages(fHandle, isWrite ? startPage + count : fHandle->totalNumPages);
+        if (rc != RC_OK)
+            return rc;
+        char *cursor = mappedPage(fHandle, startPage);
+        for (i = 0; i < iovcnt; i++)
+        {
+            if (isWrite)
+                memcpy(cursor, iov[i].iov_base, iov[i].iov_len);
+            else
+                memcpy(iov[i].iov_base, cursor, iov[i].iov_len);
+            cursor += iov[i].iov_len;
+        }
+        setPosition(fHandle, startPage + count - 1);
+        return checkPages(fHandle, startPage, iov, iovcnt, isWrite);
+    }
+
+    // O_DIRECT with an unaligned buffer, or a run crossing into the next segment file:
+    // move the pages one at a time (through the scratch page, or into their own segment)
+    for (i = 0; i < iovcnt && directReady(fHandle, iov[i].iov_base); i++)
+        ;
+    int perFile = segmentPages(fHandle);
+    if (i < iovcnt || startPage / perFile != (startPage + count - 1) / perFile)
+    {
+        int pageNum = startPage;
+        for (i = 0; i < iovcnt; i++)
+        {
+            for (size_t off = 0; off < iov[i].iov_len; off += fHandle->pageSize, pageNum++)
+            {
+                char *page = (char *)iov[i].iov_base + off;
+                RC rc = isWrite ? writePage(pageNum, fHandle, page) : readPage(pageNum, fHandle, page);
+                if (rc != RC_OK)
+                    return rc;
+            }
+        }
+        return RC_OK;
     }
 
-    // write the empty page to the end of file
-    fwrite(emptyPage, sizeof(char), PAGE_SIZE, file);
+    // transferv consumes its iovec list, so work on a copy
+    struct iovec *work = (struct iovec *)malloc(sizeof(struct iovec) * iovcnt);
+    if (work == NULL)
+        return RC_MEMORY_ALLOCATION_FAILED;
+    memcpy(work, iov, sizeof(struct iovec) * iovcnt);
 
-    // free the allocated memory for the empty page
-    free(emptyPage);
+    off_t offset;
+    fd = pageLocation(fHandle, startPage, isWrite, &offset);
+    ssize_t moved = fd < 0 ? -1 : transferv(fd, work, iovcnt, offset, isWrite);
+    free(work);
 
-    // close the file
-    fclose(file);
+    if (moved < 0 || (isWrite && (size_t)moved != totalBytes))
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
 
-    return RC_OK; // return RC_OK if successful
+    // A trailing partial page reads as zeros past the end of the file
+    size_t skip = moved;
+    for (i = 0; i < iovcnt && skip < totalBytes; i++)
+    {
+        if (skip >= iov[i].iov_len)
+        {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+        memset((char *)iov[i].iov_base + skip, 0, iov[i].iov_len - skip);
+        skip = 0;
+    }
+
+    if (isWrite)
+        dropReadahead(fHandle, startPage, count);
+    if (isWrite && startPage + count > fHandle->totalNumPages)
+        fHandle->totalNumPages = startPage + count;
+
+    setPosition(fHandle, startPage + count - 1); // position on the last page transferred
+    return checkPages(fHandle, startPage, iov, iovcnt, isWrite);
 }
 
-//  Increase the size to numberOfPages if file has less than numberOfPages pages
-RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle)
+// Move the pages described by iov, starting at page startPage, with as few preadv/pwritev calls as possible.
+// Every iov_len must be a multiple of the page size; one entry may cover several consecutive pages.
+static RC transferBlocks(int startPage, const struct iovec *iov, int iovcnt, SM_FileHandle *fHandle, int isWrite)
 {
-    int totalPages;
-    if (fHandle == NULL) // check if file handle is initialized
+    size_t totalBytes = 0;
+    int i;
+
+    if (handleFd(fHandle) < 0) // check if file handle is initialized
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    if (iov == NULL || iovcnt <= 0 || startPage < 0)
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len == 0 || iov[i].iov_len % fHandle->pageSize != 0)
+            return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        totalBytes += iov[i].iov_len;
+    }
+    int count = (int)(totalBytes / fHandle->pageSize);
+
+    lockPages(fHandle, startPage, count);
+    RC rc = transferPages(startPage, count, totalBytes, iov, iovcnt, fHandle, isWrite);
+    unlockHandle(fHandle);
+    return rc;
+}
+
+// Gather count page buffers into iovec entries of one page each
+static RC pagesToBlocks(int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle pages[], int isWrite)
+{
+    if (handleFd(fHandle) < 0)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (pages == NULL || count <= 0)
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    struct iovec *iov = (struct iovec *)malloc(sizeof(struct iovec) * count);
+    if (iov == NULL)
+        return RC_MEMORY_ALLOCATION_FAILED;
+
+    for (int i = 0; i < count; i++)
+    {
+        iov[i].iov_base = pages[i];
+        iov[i].iov_len = fHandle->pageSize;
+    }
+
+    RC rc = transferBlocks(startPage, iov, count, fHandle, isWrite);
+    free(iov);
+    return rc;
+}
+
+// Read count consecutive pages starting at startPage into the buffers pages[0..count-1] with one preadv
+RC readBlocks(int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle pages[])
+{
+    return pagesToBlocks(startPage, count, fHandle, pages, 0);
+}
+
+// Write the buffers pages[0..count-1] to count consecutive pages starting at startPage with one pwritev
+RC writeBlocks(int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle pages[])
+{
+    return pagesToBlocks(startPage, count, fHandle, pages, 1);
+}
+
+// Scatter consecutive pages starting at startPage into the buffers of iov (each a multiple of the page size)
+RC readBlocksv(int startPage, const struct iovec *iov, int iovcnt, SM_FileHandle *fHandle)
+{
+    return transferBlocks(startPage, iov, iovcnt, fHandle, 0);
+}
+
+// Gather the buffers of iov (each a multiple of the page size) into consecutive pages starting at startPage
+RC writeBlocksv(int startPage, const struct iovec *iov, int iovcnt, SM_FileHandle *fHandle)
+{
+    return transferBlocks(startPage, iov, iovcnt, fHandle, 1);
+}
+
+/* page checksums */
+
+// Record the checksum of a page written behind the storage manager's back (the asynchronous queue)
+RC storePageChecksum(SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage)
+{
+    if (handleFd(fHandle) < 0)
         return RC_FILE_HANDLE_NOT_INIT;
+    lockPages(fHandle, pageNum, 1);
+    RC rc = checkPage(fHandle, pageNum, memPage, 1);
+    unlockHandle(fHandle);
+    return rc;
+}
+
+// Mark the checksum of a page as not written before the page is written behind the storage manager's back
+RC clearPageChecksum(SM_FileHandle *fHandle, int pageNum)
+{
+    if (handleFd(fHandle) < 0)
+        return RC_FILE_HANDLE_NOT_INIT;
+    lockPages(fHandle, pageNum, 1);
+    RC rc = clearChecksums(fHandle, pageNum, 1);
+    unlockHandle(fHandle);
+    return rc;
+}
 
-    int remPages;
-    totalPages = fHandle->totalNumPages;
-    remPages = numberOfPages - totalPages; // Here, we are calculating remaining pages
+// Check a page against its recorded checksum, whether or not the handle verifies its reads
+RC verifyPageChecksum(SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage)
+{
+    if (handleFd(fHandle) < 0)
+        return RC_FILE_HANDLE_NOT_INIT;
 
-    if (fHandle != NULL)
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if (mgmt->crcFd < 0)
+        return RC_OK;
+    lockPages(fHandle, pageNum, 1);
+    PageChecksum *entry = checksumEntries(mgmt, pageNum, 1);
+    RC rc = RC_OK;
+    if (entry == NULL)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    else if (entry->valid == CHECKSUM_VALID && entry->crc != crc32c(memPage, fHandle->pageSize))
+        rc = RC_PAGE_CHECKSUM_MISMATCH;
+    unlockHandle(fHandle);
+    return rc;
+}
+
+// Walk the whole page file in runs of CHECKSUM_BATCH pages and compare every page with its checksum
+RC scrubPageFile(char *fileName, int openFlags, int *badPages, int maxBad, int *numBad)
+{
+    SM_FileHandle fh;
+    PageChecksum *entries;
+    char *run;
+    RC rc;
+
+    *numBad = 0;
+
+    // plain reads, the pages are compared below; an existing checksum file is opened anyway
+    rc = openPageFileWithFlags(fileName, &fh, openFlags & ~(SM_OPEN_CHECKSUM | SM_OPEN_VERIFY));
+    if (rc != RC_OK)
+        return rc;
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fh.mgmtInfo;
+    if (mgmt->crcFd < 0) // nothing to verify against
     {
-        if (numberOfPages > totalPages) // Check if the desired number of pages is greater than the file's current page count.
+        closePageFile(&fh);
+        return RC_FILE_NOT_FOUND;
+    }
+    size_t pageSize = fh.pageSize;
+    if (posix_memalign((void **)&run, PAGE_SIZE, CHECKSUM_BATCH * pageSize) != 0)
+    {
+        closePageFile(&fh);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    for (int start = 0; start < fh.totalNumPages && rc == RC_OK; start += CHECKSUM_BATCH)
+    {
+        int n = fh.totalNumPages - start < CHECKSUM_BATCH ? fh.totalNumPages - start : CHECKSUM_BATCH;
+        struct iovec iov = {run, n * pageSize};
+
+        rc = readBlocksv(start, &iov, 1, &fh);
+        if (rc == RC_OK && (entries = checksumEntries(mgmt, start, n)) == NULL)
+            rc = RC_READ_NON_EXISTING_PAGE;
+        for (int k = 0; rc == RC_OK && k < n; k++)
         {
-            // Now, append empty new pages until it reaches the desired the capacity.
-            while (remPages > 0)
-                appendEmptyBlock(fHandle); // Attach empty block to the file.
+            if (entries[k].valid != CHECKSUM_VALID || entries[k].crc == crc32c(run + k * pageSize, pageSize))
+                continue;
+            if (*numBad < maxBad)
+                badPages[*numBad] = start + k;
+            (*numBad)++;
         }
-        // return RC_OK if successful
-        return RC_OK;
     }
+
+    free(run);
+    closePageFile(&fh);
+    return rc;
 }
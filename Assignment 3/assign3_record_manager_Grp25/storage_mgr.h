@@ -1,31 +1,107 @@
 #ifndef STORAGE_MGR_H
 #define STORAGE_MGR_H
 
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include "dberror.h"
 
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
+// open modes for openPageFileWithFlags, kept in SM_FileHandle->openFlags
+#define SM_OPEN_DEFAULT 0
+#define SM_OPEN_MMAP 1 // serve pages from a shared mapping of the file instead of pread/pwrite
+#define SM_OPEN_DIRECT 2 // bypass the kernel page cache with O_DIRECT; page buffers should be PAGE_SIZE aligned
+#define SM_OPEN_SEGMENTED 4 // spread the pages over segment files of SM_SEGMENT_BYTES each
+#define SM_OPEN_CHECKSUM 8 // keep a CRC32C per page in "<fileName>.crc", checked by scrubPageFile
+#define SM_OPEN_VERIFY 16 // also verify every page read against its checksum (implies SM_OPEN_CHECKSUM)
+#define SM_OPEN_READAHEAD 32 // stage sequential reads in a readahead window of the handle, see setReadahead
+
+// Page files start with a header block of SM_HEADER_SIZE bytes recording their page size, the pages follow it.
+// Page sizes are powers of two from PAGE_SIZE (the default) up to SM_MAX_PAGE_SIZE
+#define SM_HEADER_SIZE 4096
+#define SM_MAX_PAGE_SIZE (64 * 1024)
+
+// Bytes of pages per segment file of an SM_OPEN_SEGMENTED page file (1 GB), whatever the file's page size: a
+// segment holds SM_SEGMENT_BYTES / pageSize pages. Segment 0 is the page file itself, segment k is the file
+// "<fileName>.k"; only the page file has a header
+#ifndef SM_SEGMENT_BYTES
+#define SM_SEGMENT_BYTES (1024L * 1024 * 1024)
+#endif
+
 typedef struct SM_FileHandle {
 	char *fileName;
 	int totalNumPages;
 	int curPagePos;
+	int openFlags;
+	int pageSize; // bytes per page, read from the page file's header
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// How far past the end of the file disk space is reserved when the file grows: the larger of
+// chunkPages and totalNumPages / sizeDivisor pages. A divisor of 0 turns the proportional part off
+typedef struct SM_GrowthPolicy {
+	int chunkPages;
+	int sizeDivisor;
+} SM_GrowthPolicy;
+
+// default growth: 1 MB chunks, or 12.5% of the file once that is larger
+#define SM_GROWTH_CHUNK_PAGES ((1024 * 1024) / PAGE_SIZE)
+#define SM_GROWTH_SIZE_DIVISOR 8
+
+// Sequential readahead, for handles opened with SM_OPEN_READAHEAD: after two consecutive page reads readBlock
+// fetches a window of pages into a staging buffer of the handle with one preadv. The window starts at
+// SM_READAHEAD_MIN_PAGES and doubles on every refill while the reads stay sequential, up to the handle's limit
+// (SM_READAHEAD_MAX_PAGES, see setReadahead)
+#ifndef SM_READAHEAD_MAX_PAGES
+#define SM_READAHEAD_MAX_PAGES 32
+#endif
+#define SM_READAHEAD_MIN_PAGES 4
+
+// Per-handle state kept in SM_FileHandle->mgmtInfo while the page file is open
+typedef struct SM_FileMgmt {
+	int fd;         // descriptor held for the whole life of the handle, used with pread/pwrite
+	pthread_rwlock_t lock; // shared while pages are moved, exclusive while the page count, segments or mappings change
+	off_t dataOffset; // bytes before page 0 in the page file: the header, 0 for files written without one
+	int *segments;  // descriptors of the segment files opened so far, segments[0] is fd
+	int numSegments;
+	char *map;      // SM_OPEN_MMAP: start of the shared mapping, NULL while nothing is mapped
+	size_t mapSize; // SM_OPEN_MMAP: bytes currently mapped, always whole pages
+	SM_GrowthPolicy growth; // reservation policy used by appendEmptyBlock and ensureCapacity
+	int reservedPages;      // pages of disk space known to be allocated, including past the end of the file
+	int crcFd;              // checksum file, -1 if the page file has none
+	void *crcMap;           // shared mapping of the checksum file
+	size_t crcMapSize;
+	int raMaxPages; // largest readahead window, 0 when readahead is off
+	int raWindow;   // pages fetched by the next refill, 0 while the reads are not sequential
+	int raNextPage; // page a sequential reader asks for next
+	char *raBuf;    // staging buffer of raMaxPages pages, PAGE_SIZE aligned, allocated on the first refill
+	int raStart;    // pages raStart..raStart+raCount-1 are staged
+	int raCount;
+} SM_FileMgmt;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileWithFlags (char *fileName, SM_FileHandle *fHandle, int openFlags);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
-/* reading blocks from disc */
+/* descriptor of the file holding pageNum (a segment file for SM_OPEN_SEGMENTED) and the page's byte offset in it.
+   With create set a missing segment file is created. Returns -1 if there is no such file */
+extern int getPageLocation (SM_FileHandle *fHandle, int pageNum, int create, off_t *offset);
+
+/* reading blocks from disc. readBlock, writeBlock and the multi-page calls below may be called concurrently on
+   one handle that does no readahead: their I/O runs side by side, only a call that grows the file or its mappings
+   runs alone. The handle's position is then that of whichever call set it last */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern int getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -34,10 +110,78 @@ extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 
+/* sequential readahead: maxPages is the largest window of the handle, 0 turns readahead off, any other value on.
+   Staged pages are private to the handle. Writes through the handle (or an asynchronous queue) drop them,
+   writes through other handles are only seen once the window has moved past the page */
+extern RC setReadahead (SM_FileHandle *fHandle, int maxPages);
+extern void dropReadahead (SM_FileHandle *fHandle, int startPage, int count);
+
+/* SM_OPEN_MMAP only: point view at the page inside the mapping instead of copying it.
+   The view stays valid until the file grows or is closed, growing may move the mapping. */
+extern RC mapBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *view);
+
+/* page checksums. Pages written while the page file has a checksum file get their CRC32C recorded there;
+   pages without a recorded checksum (never written with checksums on) always verify. A write clears the page's
+   entry before it stores the page and records the new checksum after; syncPageFile makes the entries durable.
+   Writes through mapBlock views bypass the checksums */
+extern RC clearPageChecksum (SM_FileHandle *fHandle, int pageNum);
+extern RC storePageChecksum (SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage);
+extern RC verifyPageChecksum (SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage);
+/* verify every page of fileName (opened with openFlags, e.g. SM_OPEN_SEGMENTED) against its checksum file.
+   The numbers of the first maxBad failing pages go to badPages, *numBad counts all failing pages */
+extern RC scrubPageFile (char *fileName, int openFlags, int *badPages, int maxBad, int *numBad);
+
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC setGrowthPolicy (SM_FileHandle *fHandle, SM_GrowthPolicy policy);
+/* make everything written through the handle durable: one fdatasync per file (page file, segments, checksums),
+   meant to end a batch of writes rather than follow every page */
+extern RC syncPageFile (SM_FileHandle *fHandle);
+
+/* multi-page transfers: one preadv/pwritev for a run of consecutive pages */
+extern RC readBlocks (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle pages[]);
+extern RC writeBlocks (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle pages[]);
+extern RC readBlocksv (int startPage, const struct iovec *iov, int iovcnt, SM_FileHandle *fHandle);
+extern RC writeBlocksv (int startPage, const struct iovec *iov, int iovcnt, SM_FileHandle *fHandle);
+
+/************************************************************
+ *                    asynchronous page I/O                 *
+ ************************************************************/
+typedef enum SM_AsyncBackend {
+	SM_ASYNC_AUTO = 0,     // io_uring when the kernel allows it, threads otherwise
+	SM_ASYNC_IO_URING = 1,
+	SM_ASYNC_THREADS = 2
+} SM_AsyncBackend;
+
+typedef enum SM_AsyncOp {
+	SM_ASYNC_READ = 0,
+	SM_ASYNC_WRITE = 1
+} SM_AsyncOp;
+
+// one finished request, handed back by reapCompletions
+typedef struct SM_AsyncCompletion {
+	SM_AsyncOp op;
+	int pageNum;
+	SM_PageHandle memPage;
+	void *userData; // tag given when the request was queued
+	RC rc;
+} SM_AsyncCompletion;
+
+typedef struct SM_AsyncQueue SM_AsyncQueue;
+
+/* queue up to depth page reads/writes, submit them together and reap completions in any order */
+extern RC initAsyncQueue (SM_AsyncQueue **queue, int depth, SM_AsyncBackend backend);
+extern RC shutdownAsyncQueue (SM_AsyncQueue *queue);
+extern SM_AsyncBackend getAsyncBackend (SM_AsyncQueue *queue);
+extern int getAsyncInFlight (SM_AsyncQueue *queue);
+// with SM_OPEN_DIRECT handles memPage must be PAGE_SIZE aligned (RC_UNALIGNED_BUFFER otherwise)
+extern RC queueReadBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern RC queueWriteBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+// requests the backend refuses still come back from reapCompletions, with an error rc
+extern RC submitAsyncQueue (SM_AsyncQueue *queue);
+extern int reapCompletions (SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int maxCompletions, int minCompletions);
 
 #endif
@@ -0,0 +1,670 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include "storage_mgr.h"
+
+/*
+   Asynchronous page I/O for the storage manager.
+   Requests are queued with queueReadBlock/queueWriteBlock, handed to the backend together by submitAsyncQueue
+   and collected in completion order by reapCompletions. The io_uring backend talks to the kernel rings directly
+   through the raw system calls; when io_uring is not available a small pool of threads runs pread/pwrite instead.
+*/
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SM_HAVE_IO_URING 1
+#endif
+
+#define MAX_ASYNC_WORKERS 8 // upper bound on threads of the fallback backend
+
+// One queued or in-flight page request; slots are preallocated and chained through next when free
+typedef struct SM_AsyncRequest
+{
+    SM_AsyncOp op;
+    int pageNum;
+    int fd;       // file holding the page, a segment file for segmented page files
+    off_t offset; // byte offset of the page in that file
+    SM_FileHandle *fHandle;
+    SM_PageHandle memPage;
+    void *userData;
+    ssize_t result; // bytes moved, or -errno
+    int next;
+} SM_AsyncRequest;
+
+#ifdef SM_HAVE_IO_URING
+// Submission and completion rings shared with the kernel
+typedef struct IoUring
+{
+    int fd;
+    unsigned entries;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;
+    size_t sqRingSize, cqRingSize, sqesSize;
+} IoUring;
+#endif
+
+struct SM_AsyncQueue
+{
+    SM_AsyncBackend backend;
+    int depth;
+    SM_AsyncRequest *requests;
+    int freeList;    // first free request slot, -1 when all are in use
+    int *staged;     // slots queued since the last submit
+    int numStaged;
+    int numInFlight; // accepted by the backend but not reaped yet
+    int *failed;     // staged slots the backend refused, handed back by reapCompletions with an error
+    int numFailed;
+
+#ifdef SM_HAVE_IO_URING
+    IoUring ring;
+#endif
+
+    // thread pool backend
+    pthread_t workers[MAX_ASYNC_WORKERS];
+    int numWorkers;
+    pthread_mutex_t lock;
+    pthread_cond_t workReady; // signalled when requests are added to pending
+    pthread_cond_t workDone;  // signalled when a request is moved to done
+    int *pending;             // ring of slots waiting for a worker
+    int pendingHead, pendingCount;
+    int *done; // ring of slots whose I/O finished
+    int doneHead, doneCount;
+    int stopping;
+};
+
+/* request slots */
+
+static int allocRequest(SM_AsyncQueue *queue)
+{
+    int slot = queue->freeList;
+    if (slot >= 0)
+        queue->freeList = queue->requests[slot].next;
+    return slot;
+}
+
+static void freeRequest(SM_AsyncQueue *queue, int slot)
+{
+    queue->requests[slot].next = queue->freeList;
+    queue->freeList = slot;
+}
+
+// Perform a request synchronously, from byte done of the page on; used by the worker threads and to finish short
+// io_uring transfers. A read stops early only at the end of the file
+static ssize_t runRequest(SM_AsyncRequest *req, size_t done)
+{
+    off_t offset = req->offset;
+    size_t pageSize = req->fHandle->pageSize;
+    while (done < pageSize)
+    {
+        ssize_t n = req->op == SM_ASYNC_READ
+                        ? pread(req->fd, req->memPage + done, pageSize - done, offset + done)
+                        : pwrite(req->fd, req->memPage + done, pageSize - done, offset + done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EINVAL && done > 0 && req->op == SM_ASYNC_READ) // O_DIRECT: short read ended at EOF
+                break;
+            return -errno;
+        }
+        if (n == 0) // end of file on a read
+            break;
+        done += n;
+    }
+    return done;
+}
+
+// Turn the result of a finished request into a completion record and release its slot
+static void completeRequest(SM_AsyncQueue *queue, int slot, SM_AsyncCompletion *completion)
+{
+    SM_AsyncRequest *req = &queue->requests[slot];
+    ssize_t pageSize = req->fHandle->pageSize;
+    RC rc = RC_OK;
+
+    // finish a short transfer; a read that moved nothing is at the end of the file already
+    int atEnd = req->op == SM_ASYNC_READ && req->result == 0;
+    if (req->result >= 0 && req->result < pageSize && !atEnd)
+        req->result = runRequest(req, req->result);
+
+    if (req->op == SM_ASYNC_READ)
+    {
+        if (req->result <= 0)
+            rc = RC_READ_NON_EXISTING_PAGE;
+        else if (req->result < pageSize) // still short, so the file ends inside the page: the rest reads as zeros
+            memset(req->memPage + req->result, 0, pageSize - req->result);
+    }
+    else if (req->result != pageSize)
+    {
+        rc = RC_WRITE_FAILED;
+    }
+    else if (req->pageNum >= req->fHandle->totalNumPages)
+    {
+        req->fHandle->totalNumPages = req->pageNum + 1; // writing past the last page grows the file
+    }
+
+    if (req->op == SM_ASYNC_WRITE && req->result > 0)
+        dropReadahead(req->fHandle, req->pageNum, 1); // the handle may have staged the old contents
+
+    // record or verify the page's checksum, as writeBlock and readBlock do
+    if (rc == RC_OK && req->op == SM_ASYNC_WRITE)
+        rc = storePageChecksum(req->fHandle, req->pageNum, req->memPage);
+    else if (rc == RC_OK && (req->fHandle->openFlags & SM_OPEN_VERIFY))
+        rc = verifyPageChecksum(req->fHandle, req->pageNum, req->memPage);
+
+    completion->op = req->op;
+    completion->pageNum = req->pageNum;
+    completion->memPage = req->memPage;
+    completion->userData = req->userData;
+    completion->rc = rc;
+
+    freeRequest(queue, slot);
+}
+
+/* io_uring backend */
+
+#ifdef SM_HAVE_IO_URING
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static void closeIoUring(IoUring *ring)
+{
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != NULL && ring->cqRing != MAP_FAILED && ring->cqRing != ring->sqRing)
+        munmap(ring->cqRing, ring->cqRingSize);
+    if (ring->sqRing != NULL && ring->sqRing != MAP_FAILED)
+        munmap(ring->sqRing, ring->sqRingSize);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(IoUring));
+    ring->fd = -1;
+}
+
+// Kernels before 5.6 set up rings but fail IORING_OP_READ/WRITE with -EINVAL, so ask which opcodes exist
+static int probeIoUring(int fd)
+{
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, size);
+    if (probe == NULL)
+        return 0;
+
+    int supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) >= 0 &&
+                    probe->last_op >= IORING_OP_WRITE &&
+                    (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                    (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+static RC openIoUring(IoUring *ring, int depth)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(IoUring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if (ring->fd < 0)
+    {
+        ring->fd = -1;
+        return RC_ASYNC_BACKEND_UNAVAILABLE;
+    }
+    if (!probeIoUring(ring->fd))
+    {
+        closeIoUring(ring);
+        return RC_ASYNC_BACKEND_UNAVAILABLE;
+    }
+    ring->entries = params.sq_entries;
+
+    // map the submission ring, the completion ring (shared with it on newer kernels) and the SQE array
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cqRingSize > ring->sqRingSize)
+            ring->sqRingSize = ring->cqRingSize;
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED)
+    {
+        closeIoUring(ring);
+        return RC_ASYNC_BACKEND_UNAVAILABLE;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cqRing = ring->sqRing;
+    else
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cqRing == MAP_FAILED)
+    {
+        closeIoUring(ring);
+        return RC_ASYNC_BACKEND_UNAVAILABLE;
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        closeIoUring(ring);
+        return RC_ASYNC_BACKEND_UNAVAILABLE;
+    }
+
+    char *sq = (char *)ring->sqRing;
+    char *cq = (char *)ring->cqRing;
+    ring->sqHead = (unsigned *)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return RC_OK;
+}
+
+// Place the staged requests on the submission ring and tell the kernel about them;
+// accepted is set to the number of staged requests the kernel consumed, always a prefix of staged
+static RC submitIoUring(SM_AsyncQueue *queue, int *accepted)
+{
+    IoUring *ring = &queue->ring;
+    unsigned tail = *ring->sqTail;
+
+    for (int i = 0; i < queue->numStaged; i++)
+    {
+        int slot = queue->staged[i];
+        SM_AsyncRequest *req = &queue->requests[slot];
+        unsigned index = tail & *ring->sqMask;
+        struct io_uring_sqe *sqe = &ring->sqes[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = req->op == SM_ASYNC_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = req->fd;
+        sqe->off = (__u64)req->offset;
+        sqe->addr = (__u64)(unsigned long)req->memPage;
+        sqe->len = req->fHandle->pageSize;
+        sqe->user_data = slot;
+        ring->sqArray[index] = index;
+        tail++;
+    }
+    __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+
+    RC rc = RC_OK;
+    unsigned toSubmit = queue->numStaged;
+    while (toSubmit > 0)
+    {
+        int n = ioUringEnter(ring->fd, toSubmit, 0, 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY))
+            continue;
+        if (n <= 0)
+        {
+            rc = RC_WRITE_FAILED;
+            break;
+        }
+        toSubmit -= n;
+    }
+
+    // take back the entries the kernel never consumed so a later submit does not issue them
+    if (toSubmit > 0)
+        __atomic_store_n(ring->sqTail, tail - toSubmit, __ATOMIC_RELEASE);
+    *accepted = queue->numStaged - toSubmit;
+    return rc;
+}
+
+static int reapIoUring(SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int maxCompletions, int minCompletions)
+{
+    IoUring *ring = &queue->ring;
+    int reaped = 0;
+
+    while (reaped < maxCompletions)
+    {
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+        if (head == tail)
+        {
+            // nothing ready; block only while the caller still wants more and something is outstanding
+            if (reaped >= minCompletions || queue->numInFlight == 0)
+                break;
+            if (ioUringEnter(ring->fd, 0, minCompletions - reaped, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                break;
+            continue;
+        }
+
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+        int slot = (int)cqe->user_data;
+        queue->requests[slot].result = cqe->res;
+        __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+        queue->numInFlight--;
+        completeRequest(queue, slot, &completions[reaped++]);
+    }
+    return reaped;
+}
+#endif
+
+/* thread pool backend */
+
+static void *asyncWorker(void *arg)
+{
+    SM_AsyncQueue *queue = (SM_AsyncQueue *)arg;
+
+    pthread_mutex_lock(&queue->lock);
+    while (1)
+    {
+        while (queue->pendingCount == 0 && !queue->stopping)
+            pthread_cond_wait(&queue->workReady, &queue->lock);
+        if (queue->pendingCount == 0) // stopping and nothing left to do
+            break;
+
+        int slot = queue->pending[queue->pendingHead];
+        queue->pendingHead = (queue->pendingHead + 1) % queue->depth;
+        queue->pendingCount--;
+
+        // do the I/O without holding the lock
+        pthread_mutex_unlock(&queue->lock);
+        SM_AsyncRequest *req = &queue->requests[slot];
+        req->result = runRequest(req, 0);
+        pthread_mutex_lock(&queue->lock);
+
+        queue->done[(queue->doneHead + queue->doneCount) % queue->depth] = slot;
+        queue->doneCount++;
+        pthread_cond_signal(&queue->workDone);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static RC startWorkers(SM_AsyncQueue *queue)
+{
+    queue->pending = (int *)malloc(sizeof(int) * queue->depth);
+    queue->done = (int *)malloc(sizeof(int) * queue->depth);
+    if (queue->pending == NULL || queue->done == NULL)
+        return RC_MEMORY_ALLOCATION_FAILED;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->workReady, NULL);
+    pthread_cond_init(&queue->workDone, NULL);
+
+    int wanted = queue->depth < MAX_ASYNC_WORKERS ? queue->depth : MAX_ASYNC_WORKERS;
+    for (queue->numWorkers = 0; queue->numWorkers < wanted; queue->numWorkers++)
+    {
+        if (pthread_create(&queue->workers[queue->numWorkers], NULL, asyncWorker, queue) != 0)
+            break;
+    }
+    return queue->numWorkers > 0 ? RC_OK : RC_ASYNC_BACKEND_UNAVAILABLE;
+}
+
+static void stopWorkers(SM_AsyncQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    pthread_cond_broadcast(&queue->workReady);
+    pthread_mutex_unlock(&queue->lock);
+
+    for (int i = 0; i < queue->numWorkers; i++)
+        pthread_join(queue->workers[i], NULL);
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->workReady);
+    pthread_cond_destroy(&queue->workDone);
+}
+
+static RC submitThreads(SM_AsyncQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    for (int i = 0; i < queue->numStaged; i++)
+    {
+        queue->pending[(queue->pendingHead + queue->pendingCount) % queue->depth] = queue->staged[i];
+        queue->pendingCount++;
+    }
+    pthread_cond_broadcast(&queue->workReady);
+    pthread_mutex_unlock(&queue->lock);
+    return RC_OK;
+}
+
+static int reapThreads(SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int maxCompletions, int minCompletions)
+{
+    int reaped = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    while (reaped < maxCompletions)
+    {
+        if (queue->doneCount == 0)
+        {
+            if (reaped >= minCompletions || queue->numInFlight == 0)
+                break;
+            pthread_cond_wait(&queue->workDone, &queue->lock);
+            continue;
+        }
+
+        int slot = queue->done[queue->doneHead];
+        queue->doneHead = (queue->doneHead + 1) % queue->depth;
+        queue->doneCount--;
+
+        queue->numInFlight--;
+        completeRequest(queue, slot, &completions[reaped++]);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return reaped;
+}
+
+/* interface */
+
+RC initAsyncQueue(SM_AsyncQueue **queue, int depth, SM_AsyncBackend backend)
+{
+    if (queue == NULL || depth <= 0)
+        return RC_ERROR;
+
+    SM_AsyncQueue *q = (SM_AsyncQueue *)calloc(1, sizeof(SM_AsyncQueue));
+    if (q == NULL)
+        return RC_MEMORY_ALLOCATION_FAILED;
+
+    q->depth = depth;
+    q->requests = (SM_AsyncRequest *)calloc(depth, sizeof(SM_AsyncRequest));
+    q->staged = (int *)malloc(sizeof(int) * depth);
+    q->failed = (int *)malloc(sizeof(int) * depth);
+    if (q->requests == NULL || q->staged == NULL || q->failed == NULL)
+    {
+        free(q->requests);
+        free(q->staged);
+        free(q->failed);
+        free(q);
+        return RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    // chain all request slots into the free list
+    for (int i = 0; i < depth; i++)
+        q->requests[i].next = i + 1 < depth ? i + 1 : -1;
+    q->freeList = 0;
+
+    RC rc = RC_ASYNC_BACKEND_UNAVAILABLE;
+#ifdef SM_HAVE_IO_URING
+    q->ring.fd = -1;
+    if (backend == SM_ASYNC_AUTO || backend == SM_ASYNC_IO_URING)
+    {
+        rc = openIoUring(&q->ring, depth);
+        if (rc == RC_OK)
+            q->backend = SM_ASYNC_IO_URING;
+    }
+#endif
+    if (rc != RC_OK && (backend == SM_ASYNC_AUTO || backend == SM_ASYNC_THREADS))
+    {
+        rc = startWorkers(q);
+        q->backend = SM_ASYNC_THREADS;
+        if (rc != RC_OK)
+            stopWorkers(q);
+    }
+
+    if (rc != RC_OK)
+    {
+        free(q->pending);
+        free(q->done);
+        free(q->requests);
+        free(q->staged);
+        free(q->failed);
+        free(q);
+        return rc;
+    }
+
+    *queue = q;
+    return RC_OK;
+}
+
+// Wait for every submitted request, drop the ones that were never submitted and release the queue
+RC shutdownAsyncQueue(SM_AsyncQueue *queue)
+{
+    if (queue == NULL)
+        return RC_OK;
+
+    SM_AsyncCompletion completion;
+    while (queue->numInFlight + queue->numFailed > 0)
+        reapCompletions(queue, &completion, 1, 1);
+
+#ifdef SM_HAVE_IO_URING
+    if (queue->backend == SM_ASYNC_IO_URING)
+        closeIoUring(&queue->ring);
+#endif
+    if (queue->backend == SM_ASYNC_THREADS)
+        stopWorkers(queue);
+
+    free(queue->pending);
+    free(queue->done);
+    free(queue->requests);
+    free(queue->staged);
+    free(queue->failed);
+    free(queue);
+    return RC_OK;
+}
+
+SM_AsyncBackend getAsyncBackend(SM_AsyncQueue *queue)
+{
+    return queue->backend;
+}
+
+// Requests queued or submitted that have not been reaped yet
+int getAsyncInFlight(SM_AsyncQueue *queue)
+{
+    return queue->numStaged + queue->numInFlight + queue->numFailed;
+}
+
+static RC queueRequest(SM_AsyncQueue *queue, SM_AsyncOp op, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData)
+{
+    if (queue == NULL || fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum < 0)
+        return op == SM_ASYNC_READ ? RC_READ_NON_EXISTING_PAGE : RC_WRITE_FAILED;
+    if ((fHandle->openFlags & SM_OPEN_DIRECT) && (uintptr_t)memPage % PAGE_SIZE != 0)
+        return RC_UNALIGNED_BUFFER; // O_DIRECT transfers straight into memPage, there is no bounce buffer here
+
+    off_t offset;
+    int fd = getPageLocation(fHandle, pageNum, op == SM_ASYNC_WRITE, &offset);
+    if (fd < 0)
+        return op == SM_ASYNC_READ ? RC_READ_NON_EXISTING_PAGE : RC_WRITE_FAILED;
+
+    int slot = allocRequest(queue);
+    if (slot < 0)
+        return RC_ASYNC_QUEUE_FULL; // reap some completions first
+    // the checksum is recorded again when the write completes
+    if (op == SM_ASYNC_WRITE && clearPageChecksum(fHandle, pageNum) != RC_OK)
+    {
+        freeRequest(queue, slot);
+        return RC_WRITE_FAILED;
+    }
+
+    SM_AsyncRequest *req = &queue->requests[slot];
+    req->op = op;
+    req->pageNum = pageNum;
+    req->fd = fd;
+    req->offset = offset;
+    req->fHandle = fHandle;
+    req->memPage = memPage;
+    req->userData = userData;
+    req->result = 0;
+
+    queue->staged[queue->numStaged++] = slot;
+    return RC_OK;
+}
+
+// Queue a read of page pageNum into memPage; nothing is issued until submitAsyncQueue
+RC queueReadBlock(SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData)
+{
+    return queueRequest(queue, SM_ASYNC_READ, pageNum, fHandle, memPage, userData);
+}
+
+// Queue a write of memPage to page pageNum; memPage must stay untouched until its completion is reaped
+RC queueWriteBlock(SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData)
+{
+    return queueRequest(queue, SM_ASYNC_WRITE, pageNum, fHandle, memPage, userData);
+}
+
+// Hand every queued request to the backend in one go. Requests the backend refuses are not lost:
+// they come back from reapCompletions with an error RC, and the error is also returned here.
+RC submitAsyncQueue(SM_AsyncQueue *queue)
+{
+    RC rc = RC_OK;
+    int accepted = queue == NULL ? 0 : queue->numStaged;
+
+    if (queue == NULL)
+        return RC_ERROR;
+    if (queue->numStaged == 0)
+        return RC_OK;
+
+#ifdef SM_HAVE_IO_URING
+    if (queue->backend == SM_ASYNC_IO_URING)
+        rc = submitIoUring(queue, &accepted);
+#endif
+    if (queue->backend == SM_ASYNC_THREADS)
+        rc = submitThreads(queue);
+
+    // completions are only counted by the reaping thread, which is this one, so counting after submit is safe
+    queue->numInFlight += accepted;
+    for (int i = accepted; i < queue->numStaged; i++)
+    {
+        queue->requests[queue->staged[i]].result = -EIO;
+        queue->failed[queue->numFailed++] = queue->staged[i];
+    }
+    queue->numStaged = 0;
+    return rc;
+}
+
+// Collect finished requests into completions; blocks until at least minCompletions are available
+// (or nothing is left in flight). Returns the number of completions stored.
+int reapCompletions(SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int maxCompletions, int minCompletions)
+{
+    if (queue == NULL || completions == NULL || maxCompletions <= 0)
+        return 0;
+    if (minCompletions > maxCompletions)
+        minCompletions = maxCompletions;
+
+    // refused requests are already finished, hand them back first
+    int reaped = 0;
+    while (reaped < maxCompletions && queue->numFailed > 0)
+    {
+        int slot = queue->failed[--queue->numFailed];
+        completeRequest(queue, slot, &completions[reaped++]);
+    }
+    if (reaped == maxCompletions)
+        return reaped;
+
+    completions += reaped;
+    maxCompletions -= reaped;
+    minCompletions = minCompletions > reaped ? minCompletions - reaped : 0;
+#ifdef SM_HAVE_IO_URING
+    if (queue->backend == SM_ASYNC_IO_URING)
+        return reaped + reapIoUring(queue, completions, maxCompletions, minCompletions);
+#endif
+    return reaped + reapThreads(queue, completions, maxCompletions, minCompletions);
+}
@@ -57,6 +57,7 @@ static void testScans(void);
 static void testScansTwo(void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testTwoOpenTables(void);
 
 // struct for test records
 typedef struct TestRecord
@@ -86,6 +87,7 @@ int main(void)
 	testScans();
 	testScansTwo();
 	testMultipleScans();
+	testTwoOpenTables();
 
 	return 0;
 }
@@ -701,4 +703,73 @@ testRecord(Schema *schema, int a, char *b, int c)
 	freeVal(value);
 
 	return result;
-}
\ No newline at end of file
+}
+
+// ************************************************************
+// two tables open at the same time keep their own records
+void testTwoOpenTables(void)
+{
+	RM_TableData *first = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *second = (RM_TableData *)malloc(sizeof(RM_TableData));
+	TestRecord firstInserts[] = {
+		{1, "aaaa", 3},
+		{2, "bbbb", 2}};
+	TestRecord secondInserts[] = {
+		{7, "gggg", 3},
+		{8, "hhhh", 3}};
+	int numInserts = 2, i;
+	Record *r;
+	RID firstRids[2], secondRids[2];
+	Schema *schema;
+	testName = "test two open tables";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r", schema));
+	TEST_CHECK(openTable(first, "test_table_r"));
+	TEST_CHECK(createTable("test_table_t", schema));
+	TEST_CHECK(openTable(second, "test_table_t"));
+
+	// insert into both tables in turn
+	for (i = 0; i < numInserts; i++)
+	{
+		r = fromTestRecord(schema, firstInserts[i]);
+		TEST_CHECK(insertRecord(first, r));
+		firstRids[i] = r->id;
+		freeRecord(r);
+		r = fromTestRecord(schema, secondInserts[i]);
+		TEST_CHECK(insertRecord(second, r));
+		secondRids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// closing one table leaves the other open
+	TEST_CHECK(closeTable(first));
+	for (i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(createRecord(&r, schema));
+		TEST_CHECK(getRecord(second, secondRids[i], r));
+		ASSERT_EQUALS_RECORDS(fromTestRecord(schema, secondInserts[i]), r, schema, "compare records of the open table");
+		freeRecord(r);
+	}
+
+	TEST_CHECK(openTable(first, "test_table_r"));
+	for (i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(createRecord(&r, schema));
+		TEST_CHECK(getRecord(first, firstRids[i], r));
+		ASSERT_EQUALS_RECORDS(fromTestRecord(schema, firstInserts[i]), r, schema, "compare records of the reopened table");
+		freeRecord(r);
+	}
+
+	// deleting a table that is still open detaches it first
+	TEST_CHECK(closeTable(first));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(deleteTable("test_table_t"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(first);
+	free(second);
+	freeSchema(schema);
+	TEST_DONE();
+}
@@ -0,0 +1,1443 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "dberror.h"
+#include "dt.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_buffer_pagefile.bin"
+#define TESTPF2 "test_buffer_pagefile2.bin"
+
+/* prototypes for test functions */
+static void testPageLookup(ReplacementStrategy strategy);
+static void testLargePool(void);
+static void testAllPinned(ReplacementStrategy strategy);
+static void testLRUK(void);
+static void testScanResistance(ReplacementStrategy strategy);
+static void testLFUAging(void);
+static void testConcurrentPins(ReplacementStrategy strategy);
+static void testPartitionedPool(ReplacementStrategy strategy);
+static void testClockSweep(void);
+static void testBackgroundWriter(void);
+static void testPrefetch(ReplacementStrategy strategy);
+static void testBulkAccess(ReplacementStrategy strategy, BM_AccessStrategy access);
+static void testFlushPool(void);
+static void testSharedPool(ReplacementStrategy strategy);
+static void testResizeBufferPool(ReplacementStrategy strategy);
+static void testWarmRestart(ReplacementStrategy strategy);
+static void testVerifiedReads(void);
+
+/* main function running all tests */
+int main(void)
+{
+	testName = "";
+
+	initStorageManager();
+
+	testPageLookup(RS_FIFO);
+	testPageLookup(RS_LRU);
+	testPageLookup(RS_CLOCK);
+	testPageLookup(RS_LFU);
+	testPageLookup(RS_LRU_K);
+	testPageLookup(RS_ARC);
+	testPageLookup(RS_2Q);
+	testPageLookup(RS_CLOCK_SWEEP);
+	testLargePool();
+	testAllPinned(RS_FIFO);
+	testAllPinned(RS_LRU);
+	testAllPinned(RS_CLOCK);
+	testAllPinned(RS_LFU);
+	testAllPinned(RS_LRU_K);
+	testAllPinned(RS_ARC);
+	testAllPinned(RS_2Q);
+	testAllPinned(RS_CLOCK_SWEEP);
+	testLRUK();
+	testScanResistance(RS_ARC);
+	testScanResistance(RS_2Q);
+	testLFUAging();
+	testConcurrentPins(RS_FIFO);
+	testConcurrentPins(RS_CLOCK);
+	testConcurrentPins(RS_LRU_K);
+	testConcurrentPins(RS_ARC);
+	testConcurrentPins(RS_CLOCK_SWEEP);
+	testPartitionedPool(RS_CLOCK);
+	testPartitionedPool(RS_LFU);
+	testPartitionedPool(RS_CLOCK_SWEEP);
+	testClockSweep();
+	testBackgroundWriter();
+	testPrefetch(RS_LRU);
+	testPrefetch(RS_CLOCK_SWEEP);
+	testBulkAccess(RS_FIFO, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_LRU, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_CLOCK, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_LFU, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_LRU_K, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_ARC, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_2Q, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_CLOCK_SWEEP, BM_ACCESS_BULKREAD);
+	testBulkAccess(RS_CLOCK, BM_ACCESS_BULKWRITE);
+	testBulkAccess(RS_ARC, BM_ACCESS_BULKWRITE);
+	testFlushPool();
+	testSharedPool(RS_LRU);
+	testSharedPool(RS_LFU);
+	testSharedPool(RS_LRU_K);
+	testSharedPool(RS_ARC);
+	testSharedPool(RS_CLOCK_SWEEP);
+	testResizeBufferPool(RS_FIFO);
+	testResizeBufferPool(RS_LRU);
+	testResizeBufferPool(RS_CLOCK);
+	testResizeBufferPool(RS_LFU);
+	testResizeBufferPool(RS_LRU_K);
+	testResizeBufferPool(RS_ARC);
+	testResizeBufferPool(RS_2Q);
+	testResizeBufferPool(RS_CLOCK_SWEEP);
+	testWarmRestart(RS_FIFO);
+	testWarmRestart(RS_LRU);
+	testWarmRestart(RS_CLOCK);
+	testWarmRestart(RS_LFU);
+	testWarmRestart(RS_LRU_K);
+	testWarmRestart(RS_ARC);
+	testWarmRestart(RS_2Q);
+	testWarmRestart(RS_CLOCK_SWEEP);
+	testVerifiedReads();
+
+	return 0;
+}
+
+/* create page file fileName whose pages start with their own page number plus first */
+static void createNamedTestFile(char *fileName, int numPages, int first)
+{
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)calloc(PAGE_SIZE, 1);
+
+	TEST_CHECK(createPageFile(fileName));
+	TEST_CHECK(openPageFile(fileName, &fh));
+	for (int i = 0; i < numPages; i++)
+	{
+		*(int *)page = first + i;
+		TEST_CHECK(writeBlock(i, &fh, page));
+	}
+	TEST_CHECK(closePageFile(&fh));
+	free(page);
+}
+
+/* create a page file whose pages start with their own page number */
+static void createTestFile(int numPages)
+{
+	createNamedTestFile(TESTPF, numPages, 0);
+}
+
+/* check that every frame holding a page is found again by pinPage, without reading it */
+static bool framesResident(BM_BufferPool *bm)
+{
+	BM_PageHandle h;
+	PageNumber *contents = getFrameContents(bm);
+	int reads = getNumReadIO(bm);
+	bool ok = true;
+
+	for (int i = 0; i < bm->numPages && ok; i++)
+	{
+		if (contents[i] == NO_PAGE)
+			continue;
+		ok = pinPage(bm, &h, contents[i]) == RC_OK && *(int *)h.data == contents[i];
+		unpinPage(bm, &h);
+	}
+	free(contents);
+	return ok && getNumReadIO(bm) == reads;
+}
+
+/* pin, dirty and force pages of a small pool while evictions move pages between frames */
+void testPageLookup(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int i, round;
+
+	testName = "page table lookups under evictions";
+	createTestFile(20);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, strategy, NULL));
+
+	// every round pins all pages once, in a different order
+	for (round = 0; round < 3; round++)
+	{
+		for (i = 0; i < 20; i++)
+		{
+			int pageNum = (i * (2 * round + 1)) % 20;
+			TEST_CHECK(pinPage(bm, h, pageNum));
+			ASSERT_EQUALS_INT(pageNum, *(int *)h->data, "pinned page has the right contents");
+			if (i % 5 == 0)
+			{
+				// bump the page's contents past the number of rounds, written back on eviction
+				((int *)h->data)[1] += 1;
+				TEST_CHECK(markDirty(bm, h));
+			}
+			TEST_CHECK(unpinPage(bm, h));
+		}
+		ASSERT_TRUE(framesResident(bm), "resident pages are found without I/O");
+	}
+
+	// a page that is not resident can neither be marked dirty nor unpinned
+	PageNumber *contents = getFrameContents(bm);
+	for (i = 0; i < 20; i++)
+	{
+		bool resident = false;
+		for (int j = 0; j < 4; j++)
+			resident = resident || contents[j] == i;
+		if (!resident)
+			break;
+	}
+	free(contents);
+	h->pageNum = i;
+	ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, markDirty(bm, h), "markDirty of a page not in the pool");
+	ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, unpinPage(bm, h), "unpinPage of a page not in the pool");
+
+	// forcePage writes a resident page right away
+	TEST_CHECK(pinPage(bm, h, 7));
+	((int *)h->data)[2] = 77;
+	TEST_CHECK(markDirty(bm, h));
+	int writes = getNumWriteIO(bm);
+	TEST_CHECK(forcePage(bm, h));
+	ASSERT_EQUALS_INT(writes + 1, getNumWriteIO(bm), "forcePage wrote the page");
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// the dirty pages made it to disk
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	TEST_CHECK(readBlock(7, &fh, page));
+	ASSERT_EQUALS_INT(77, ((int *)page)[2], "forced page on disk");
+	TEST_CHECK(readBlock(0, &fh, page));
+	ASSERT_EQUALS_INT(3, ((int *)page)[1], "page dirtied every round on disk");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+	free(h);
+
+	TEST_DONE();
+}
+
+/* a pool large enough for the whole file reads every page exactly once */
+void testLargePool(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int i, round;
+
+	testName = "large pool hits";
+	createTestFile(5000);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 5000, RS_LRU, NULL));
+	for (round = 0; round < 2; round++)
+	{
+		for (i = 0; i < 5000; i++)
+		{
+			TEST_CHECK(pinPage(bm, h, (i * 7) % 5000));
+			TEST_CHECK(unpinPage(bm, h));
+		}
+	}
+	ASSERT_EQUALS_INT(5000, getNumReadIO(bm), "every page read once");
+	ASSERT_TRUE(framesResident(bm), "all pages resident");
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+
+	TEST_DONE();
+}
+
+/* a pool whose pages are all pinned refuses another page, and frames are reused in place */
+void testAllPinned(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h[4];
+	char *frameData[3];
+	int i;
+
+	testName = "all frames pinned";
+	createTestFile(10);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, strategy, NULL));
+	for (i = 0; i < 3; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h[i], i));
+		frameData[i] = h[i].data;
+	}
+	ASSERT_ERROR(pinPage(bm, &h[3], 5), "no frame to evict");
+	ASSERT_TRUE(framesResident(bm), "pinned pages stay resident");
+
+	// once a page is unpinned its frame takes the new page, in the same memory
+	TEST_CHECK(unpinPage(bm, &h[1]));
+	TEST_CHECK(pinPage(bm, &h[3], 5));
+	ASSERT_TRUE(h[3].data == frameData[1], "the unpinned frame is reused");
+	ASSERT_EQUALS_INT(5, *(int *)h[3].data, "page read into the reused frame");
+	ASSERT_EQUALS_INT(0, *(int *)h[0].data, "other pinned pages untouched");
+	ASSERT_EQUALS_INT(2, *(int *)h[2].data, "other pinned pages untouched");
+
+	TEST_CHECK(unpinPage(bm, &h[0]));
+	TEST_CHECK(unpinPage(bm, &h[2]));
+	TEST_CHECK(unpinPage(bm, &h[3]));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* pin every page of [first, last) once */
+static void scanPages(BM_BufferPool *bm, int first, int last)
+{
+	BM_PageHandle h;
+
+	for (int i = first; i < last; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+}
+
+/* pages referenced twice survive scans under LRU-K, also when their history was kept over an eviction */
+void testLRUK(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_LRUKParams params = {2, 0, 64};
+	int reads;
+
+	testName = "LRU-K";
+	createTestFile(100);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU_K, &params));
+
+	// pages 0 and 1 are referenced twice, then a scan runs over many more pages than the pool holds
+	scanPages(bm, 0, 2);
+	scanPages(bm, 0, 2);
+	scanPages(bm, 10, 40);
+	reads = getNumReadIO(bm);
+	scanPages(bm, 0, 2);
+	ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "twice referenced pages survive the scan");
+
+	// page 2 is referenced once and evicted; its first reference is retained, so the second makes it
+	// as hot as pages 0 and 1
+	scanPages(bm, 2, 3);
+	scanPages(bm, 40, 50);
+	reads = getNumReadIO(bm);
+	scanPages(bm, 2, 3);
+	ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "page 2 was evicted by the scan");
+	scanPages(bm, 50, 80);
+	reads = getNumReadIO(bm);
+	scanPages(bm, 0, 3);
+	ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "retained history keeps page 2 over the scan");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// with a correlated reference period the repeated pins of a page in a row count as one reference
+	params.correlatedPeriod = 4;
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU_K, &params));
+	scanPages(bm, 0, 1);
+	scanPages(bm, 0, 1);
+	scanPages(bm, 0, 1);
+	scanPages(bm, 10, 20);
+	reads = getNumReadIO(bm);
+	scanPages(bm, 0, 1);
+	ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "correlated pins do not make a page hot");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// invalid parameters are refused
+	params.k = 0;
+	ASSERT_ERROR(initBufferPool(bm, TESTPF, 4, RS_LRU_K, &params), "K of 0");
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* a hot set that keeps being referenced between the pages of a scan stays in the pool */
+void testScanResistance(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	int round, reads;
+
+	testName = "scan resistance";
+	createTestFile(200);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategy, NULL));
+	scanPages(bm, 0, 4);
+	scanPages(bm, 0, 4);
+	for (round = 0; round < 30; round++)
+	{
+		reads = getNumReadIO(bm);
+		scanPages(bm, 0, 4);
+		if (round >= 3)
+			ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "hot pages stay resident");
+		scanPages(bm, 10 + 6 * round, 16 + 6 * round);
+	}
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* run the shifted workload of testLFUAging: pages 10 to 12 and page 0 */
+static int lfuShiftedReads(BM_BufferPool *bm)
+{
+	int reads, round;
+
+	for (round = 0; round < 40; round++)
+	{
+		scanPages(bm, 10, 13);
+		scanPages(bm, 0, 1);
+	}
+	reads = getNumReadIO(bm);
+	scanPages(bm, 10, 13);
+	scanPages(bm, 0, 1);
+	return getNumReadIO(bm) - reads;
+}
+
+/* pages that were hot once give way to the current working set only when LFU ages its counts */
+void testLFUAging(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_LFUParams params = {16};
+	int round;
+
+	testName = "LFU aging";
+	createTestFile(100);
+
+	// pages 0 to 3 are pinned often, then the workload moves on to pages 10 to 12 and keeps page 0
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LFU, &params));
+	for (round = 0; round < 20; round++)
+		scanPages(bm, 0, 4);
+	ASSERT_EQUALS_INT(0, lfuShiftedReads(bm), "the new working set is resident");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// without aging the old counts keep pages 1 to 3, and the shifted pages, page 0 included, compete for the one
+	// frame left
+	params.agingPeriod = 0;
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LFU, &params));
+	for (round = 0; round < 20; round++)
+		scanPages(bm, 0, 4);
+	ASSERT_EQUALS_INT(4, lfuShiftedReads(bm), "the shifted pages replace each other");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// invalid parameters are refused
+	params.agingPeriod = -1;
+	ASSERT_ERROR(initBufferPool(bm, TESTPF, 4, RS_LFU, &params), "negative aging period");
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+#define CONCURRENT_THREADS 8
+#define CONCURRENT_PINS 2000
+
+typedef struct ConcurrentWorker
+{
+	BM_BufferPool *bm;
+	int numPages;
+	unsigned int seed;
+	int increments; // page counters this thread incremented
+	bool ok;
+} ConcurrentWorker;
+
+/* pin random pages, check their contents and increment the page's counter under the exclusive frame latch */
+static void *concurrentWorker(void *arg)
+{
+	ConcurrentWorker *w = (ConcurrentWorker *)arg;
+	BM_PageHandle h;
+
+	for (int i = 0; i < CONCURRENT_PINS && w->ok; i++)
+	{
+		int pageNum = rand_r(&w->seed) % w->numPages;
+		// a thread holds one pin at a time, so a pool with more frames than threads always has a frame to give
+		w->ok = pinPage(w->bm, &h, pageNum) == RC_OK && *(int *)h.data == pageNum;
+		if (w->ok && i % 3 == 0)
+		{
+			latchPage(w->bm, &h, true);
+			((int *)h.data)[1] += 1;
+			markDirty(w->bm, &h);
+			unlatchPage(w->bm, &h);
+			w->increments++;
+		}
+		unpinPage(w->bm, &h);
+	}
+	return NULL;
+}
+
+/* run the workers on a pool and return the number of increments they made, or -1 if one saw a wrong page */
+static int runConcurrentWorkers(BM_BufferPool *bm, int numPages)
+{
+	pthread_t threads[CONCURRENT_THREADS];
+	ConcurrentWorker workers[CONCURRENT_THREADS];
+	int increments = 0;
+
+	for (int t = 0; t < CONCURRENT_THREADS; t++)
+	{
+		workers[t] = (ConcurrentWorker){bm, numPages, t + 1, 0, true};
+		pthread_create(&threads[t], NULL, concurrentWorker, &workers[t]);
+	}
+	for (int t = 0; t < CONCURRENT_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		increments = workers[t].ok && increments >= 0 ? increments + workers[t].increments : -1;
+	}
+	return increments;
+}
+
+/* several threads pin, dirty and unpin pages of one pool; no update is lost and a page missed by several
+   threads at once is read only once */
+void testConcurrentPins(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	int i, increments, total = 0;
+
+	testName = "concurrent pins";
+	createTestFile(64);
+
+	// a pool that holds the whole file reads each page once, however many threads miss on it together
+	TEST_CHECK(initBufferPool(bm, TESTPF, 64, strategy, NULL));
+	increments = runConcurrentWorkers(bm, 64);
+	ASSERT_TRUE(increments > 0, "threads saw the right pages");
+	ASSERT_EQUALS_INT(64, getNumReadIO(bm), "every page read once");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// a small pool evicts dirty pages while other threads pin them again
+	TEST_CHECK(initBufferPool(bm, TESTPF, 12, strategy, NULL));
+	i = runConcurrentWorkers(bm, 64);
+	ASSERT_TRUE(i > 0, "threads saw the right pages under evictions");
+	increments += i;
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// every increment made it to disk
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 0; i < 64; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, page));
+		total += ((int *)page)[1];
+	}
+	ASSERT_EQUALS_INT(increments, total, "no increment lost");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* a pool split into sub-pools behaves like one pool of all their frames */
+void testPartitionedPool(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int i, increments, total = 0;
+
+	testName = "partitioned pool";
+	createTestFile(64);
+
+	// there must be a frame for every sub-pool
+	ASSERT_ERROR(initBufferPoolPartitioned(bm, TESTPF, 3, strategy, NULL, SM_OPEN_DEFAULT, 4), "more partitions than frames");
+
+	// with room for the whole file, each page is read once and listed once among the frames
+	TEST_CHECK(initBufferPoolPartitioned(bm, TESTPF, 70, strategy, NULL, SM_OPEN_DEFAULT, 4));
+	ASSERT_EQUALS_INT(70, bm->numPages, "pool size");
+	for (i = 0; i < 128; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i % 64));
+		ASSERT_EQUALS_INT(i % 64, *(int *)h->data, "pinned page has the right contents");
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_INT(64, getNumReadIO(bm), "every page read once");
+	PageNumber *contents = getFrameContents(bm);
+	int listed = 0;
+	for (i = 0; i < 70; i++)
+		listed += contents[i] != NO_PAGE;
+	free(contents);
+	ASSERT_EQUALS_INT(64, listed, "every page in one frame");
+	ASSERT_TRUE(framesResident(bm), "resident pages are found without I/O");
+
+	// a pinned page in any sub-pool keeps the pool from shutting down
+	TEST_CHECK(pinPage(bm, h, 5));
+	ASSERT_EQUALS_INT(RC_PINNED_PAGES_IN_BUFFER, shutdownBufferPool(bm), "shutdown with a pinned page");
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// threads pinning through small sub-pools lose no update; each sub-pool has a frame for every thread
+	TEST_CHECK(initBufferPoolPartitioned(bm, TESTPF, 40, strategy, NULL, SM_OPEN_DEFAULT, 4));
+	increments = runConcurrentWorkers(bm, 64);
+	ASSERT_TRUE(increments > 0, "threads saw the right pages");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 0; i < 64; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, page));
+		total += ((int *)page)[1];
+	}
+	ASSERT_EQUALS_INT(increments, total, "no increment lost");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+	free(h);
+
+	TEST_DONE();
+}
+
+/* CLOCK_SWEEP keeps a page whose usage count is up while a scan passes through the other frames */
+void testClockSweep(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	int i, reads;
+
+	testName = "CLOCK sweep usage counts";
+	createTestFile(20);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_CLOCK_SWEEP, NULL));
+	for (i = 0; i < BM_SWEEP_MAX_USAGE; i++)
+		scanPages(bm, 0, 1);
+	scanPages(bm, 1, 8);
+	reads = getNumReadIO(bm);
+	scanPages(bm, 0, 1);
+	ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "the hot page outlived the scan");
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* the background writer cleans the frames CLOCK evicts next, in one batch of consecutive pages */
+void testBackgroundWriter(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h;
+	BM_WriterParams params = {0.5, 5, 64};
+	int i, wait;
+
+	testName = "background writer";
+	createTestFile(64);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 16, RS_CLOCK, NULL));
+	ASSERT_ERROR(startBackgroundWriter(bm, &(BM_WriterParams){1.5, 5, 64}), "clean fraction above 1");
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		((int *)h.data)[1] = 100 + i;
+		TEST_CHECK(markDirty(bm, &h));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+
+	// half of the frames from the clock hand on, i.e. pages 0 to 7, are written with one writeBlocks call
+	TEST_CHECK(startBackgroundWriter(bm, &params));
+	for (wait = 0; wait < 2000 && getNumWriterPages(bm) < 8; wait++)
+		usleep(1000);
+	ASSERT_EQUALS_INT(8, getNumWriterPages(bm), "writer pages");
+	ASSERT_EQUALS_INT(1, getNumWriterBatches(bm), "writer batches");
+	bool *dirty = getDirtyFlags(bm);
+	ASSERT_TRUE(!dirty[0] && !dirty[7] && dirty[8] && dirty[15], "frames ahead of the hand are clean");
+	free(dirty);
+
+	// the pages that replace them do not wait for a write
+	for (i = 16; i < 24; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(0, getNumEvictionWrites(bm), "no victim written back by a pin");
+	TEST_CHECK(stopBackgroundWriter(bm));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, page));
+		ASSERT_EQUALS_INT(100 + i, ((int *)page)[1], "written page on disk");
+	}
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* prefetchPages and pinPageAsync read pages without pinning them; pins wait for reads under way */
+void testPrefetch(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h;
+	PageNumber pages[8];
+	int i, wait;
+	RC rc;
+
+	testName = "prefetch";
+	createTestFile(64);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategy, NULL));
+	ASSERT_ERROR(prefetchPages(bm, pages, -1), "negative page count");
+	for (i = 0; i < 8; i++)
+		pages[i] = i;
+	TEST_CHECK(prefetchPages(bm, pages, 8));
+	for (i = 0; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		ASSERT_EQUALS_INT(i, *(int *)h.data, "prefetched page content");
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(8, getNumReadIO(bm), "each page read once");
+	ASSERT_EQUALS_INT(8, getNumPrefetchReads(bm), "by the prefetcher");
+	int *fixCounts = getFixCounts(bm);
+	for (i = 0; i < 8; i++)
+		ASSERT_EQUALS_INT(0, fixCounts[i], "prefetched pages are not pinned");
+	free(fixCounts);
+
+	// a dirty page replaced by a prefetched one is written back first
+	TEST_CHECK(pinPage(bm, &h, 0));
+	((int *)h.data)[1] = 1000;
+	TEST_CHECK(markDirty(bm, &h));
+	TEST_CHECK(unpinPage(bm, &h));
+
+	rc = pinPageAsync(bm, &h, 20);
+	ASSERT_TRUE(rc == RC_PAGE_NOT_READY, "page not in the pool is not ready");
+	for (wait = 0; wait < 2000 && rc == RC_PAGE_NOT_READY; wait++)
+	{
+		usleep(1000);
+		rc = pinPageAsync(bm, &h, 20);
+	}
+	TEST_CHECK(rc);
+	ASSERT_EQUALS_INT(20, *(int *)h.data, "page pinned once read");
+	TEST_CHECK(unpinPage(bm, &h));
+
+	for (i = 0; i < 8; i++)
+		pages[i] = 30 + i;
+	TEST_CHECK(prefetchPages(bm, pages, 8));
+
+	TEST_CHECK(pinPage(bm, &h, 0));
+	ASSERT_EQUALS_INT(1000, ((int *)h.data)[1], "evicted page was written back");
+	TEST_CHECK(unpinPage(bm, &h));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* a bulk scan over a file much larger than the pool replaces only the pages of its ring's frames */
+void testBulkAccess(ReplacementStrategy strategy, BM_AccessStrategy access)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h;
+	int i, resident;
+
+	testName = access == BM_ACCESS_BULKREAD ? "bulk read ring" : "bulk write ring";
+	createTestFile(200);
+
+	// 32 frames, so the ring gets 4 of them
+	TEST_CHECK(initBufferPool(bm, TESTPF, 32, strategy, NULL));
+	ASSERT_ERROR(pinPageWithAccess(bm, &h, 0, (BM_AccessStrategy)3), "unknown access strategy");
+	scanPages(bm, 0, 32);
+	scanPages(bm, 0, 32);
+	for (i = 100; i < 200; i++)
+	{
+		TEST_CHECK(pinPageWithAccess(bm, &h, i, access));
+		ASSERT_EQUALS_INT(i, *(int *)h.data, "bulk page content");
+		if (access == BM_ACCESS_BULKWRITE)
+		{
+			((int *)h.data)[1] = 1000 + i;
+			TEST_CHECK(markDirty(bm, &h));
+		}
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	PageNumber *contents = getFrameContents(bm);
+	for (i = 0, resident = 0; i < 32; i++)
+		resident += contents[i] >= 0 && contents[i] < 32;
+	free(contents);
+	ASSERT_TRUE(resident >= 28, "at most the ring's pages were replaced");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	if (access == BM_ACCESS_BULKWRITE)
+	{
+		SM_FileHandle fh;
+		SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+		TEST_CHECK(openPageFile(TESTPF, &fh));
+		for (i = 100; i < 200; i++)
+		{
+			TEST_CHECK(readBlock(i, &fh, page));
+			ASSERT_EQUALS_INT(1000 + i, ((int *)page)[1], "bulk written page on disk");
+		}
+		TEST_CHECK(closePageFile(&fh));
+		free(page);
+	}
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* forceFlushPool writes the dirty unpinned pages, held by frames in the reverse of page order, and skips a pinned one */
+void testFlushPool(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h, pinned;
+	int dirtyPages[] = {0, 1, 2, 5, 6, 9, 15};
+	int i, k;
+
+	testName = "flush pool";
+	createTestFile(16);
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 16, RS_CLOCK, NULL));
+	for (i = 15; i >= 0; i--)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	for (k = 0; k < 7; k++)
+	{
+		TEST_CHECK(pinPage(bm, &h, dirtyPages[k]));
+		((int *)h.data)[1] = 100 + dirtyPages[k];
+		TEST_CHECK(markDirty(bm, &h));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	TEST_CHECK(pinPage(bm, &pinned, 3));
+	((int *)pinned.data)[1] = 103;
+	TEST_CHECK(markDirty(bm, &pinned));
+
+	TEST_CHECK(forceFlushPool(bm));
+	ASSERT_EQUALS_INT(7, getNumWriteIO(bm), "dirty unpinned pages written");
+	PageNumber *contents = getFrameContents(bm);
+	bool *dirty = getDirtyFlags(bm);
+	for (i = 0; i < 16; i++)
+		ASSERT_TRUE(dirty[i] == (contents[i] == 3), "only the pinned page is still dirty");
+	free(contents);
+	free(dirty);
+
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (k = 0; k < 7; k++)
+	{
+		TEST_CHECK(readBlock(dirtyPages[k], &fh, page));
+		ASSERT_EQUALS_INT(100 + dirtyPages[k], ((int *)page)[1], "flushed page on disk");
+	}
+	TEST_CHECK(readBlock(3, &fh, page));
+	ASSERT_EQUALS_INT(0, ((int *)page)[1], "pinned page not flushed");
+
+	TEST_CHECK(unpinPage(bm, &pinned));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(readBlock(3, &fh, page));
+	ASSERT_EQUALS_INT(103, ((int *)page)[1], "shutdown flushes the rest");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+
+	TEST_DONE();
+}
+
+/* two files attached to one shared pool: their pages are kept apart, and each file is flushed, dropped and detached
+   without touching the pages of the other */
+void testSharedPool(ReplacementStrategy strategy)
+{
+	BM_BufferPool *pool = MAKE_POOL(), *a = MAKE_POOL(), *b = MAKE_POOL(), *c = MAKE_POOL();
+	BM_PageHandle h, b1, b2;
+	PageNumber *contents;
+	bool *dirty;
+	int i, n;
+
+	testName = "shared pool";
+	createNamedTestFile(TESTPF, 8, 0);
+	createNamedTestFile(TESTPF2, 8, 1000);
+
+	TEST_CHECK(initSharedBufferPool(pool, 6, strategy, NULL));
+	TEST_CHECK(attachBufferPool(a, pool, TESTPF, SM_OPEN_DEFAULT));
+	TEST_CHECK(attachBufferPool(b, pool, TESTPF2, SM_OPEN_DEFAULT));
+
+	// the same page number of two files is two pages
+	TEST_CHECK(pinPage(a, &h, 3));
+	ASSERT_EQUALS_INT(3, *(int *)h.data, "page 3 of the first file");
+	TEST_CHECK(unpinPage(a, &h));
+	TEST_CHECK(pinPage(b, &h, 3));
+	ASSERT_EQUALS_INT(1003, *(int *)h.data, "page 3 of the second file");
+	ASSERT_EQUALS_INT(3, h.pageNum, "a view hands out the file's page numbers");
+	TEST_CHECK(unpinPage(b, &h));
+	ASSERT_EQUALS_INT(1, getNumReadIO(a), "reads of the first file");
+	ASSERT_EQUALS_INT(1, getNumReadIO(b), "reads of the second file");
+
+	// both files draw on the six frames
+	for (i = 0; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(a, &h, i));
+		ASSERT_EQUALS_INT(i, *(int *)h.data, "page of the first file");
+		TEST_CHECK(unpinPage(a, &h));
+	}
+	contents = getFrameContents(pool);
+	for (i = 0, n = 0; i < 6; i++)
+		n += contents[i] != NO_PAGE;
+	ASSERT_EQUALS_INT(6, n, "the pool holds six pages");
+	free(contents);
+
+	// flushing one file leaves the other file's dirty page alone
+	TEST_CHECK(pinPage(a, &h, 0));
+	((int *)h.data)[1] = 100;
+	TEST_CHECK(markDirty(a, &h));
+	TEST_CHECK(unpinPage(a, &h));
+	TEST_CHECK(pinPage(b, &b1, 1));
+	((int *)b1.data)[1] = 101;
+	TEST_CHECK(markDirty(b, &b1));
+	TEST_CHECK(forceFlushPool(a));
+	ASSERT_EQUALS_INT(1, getNumWriteIO(a), "the first file's page written");
+	ASSERT_EQUALS_INT(0, getNumWriteIO(b), "the second file's page not written");
+	dirty = getDirtyFlags(b);
+	contents = getFrameContents(b);
+	for (i = 0, n = 0; i < 6; i++)
+		n += dirty[i] && contents[i] == 1;
+	ASSERT_EQUALS_INT(1, n, "the second file's page still dirty");
+	free(dirty);
+	free(contents);
+
+	// dropping the second file's pages discards the change, but not a pinned page
+	TEST_CHECK(pinPage(b, &b2, 2));
+	ASSERT_ERROR(dropFilePages(b), "pinned pages are not dropped");
+	TEST_CHECK(unpinPage(b, &b1));
+	ASSERT_ERROR(dropFilePages(b), "one page still pinned");
+	contents = getFrameContents(b);
+	for (i = 0, n = 0; i < 6; i++)
+		n += contents[i] != NO_PAGE;
+	ASSERT_EQUALS_INT(1, n, "only the pinned page is left");
+	free(contents);
+	TEST_CHECK(unpinPage(b, &b2));
+	TEST_CHECK(dropFilePages(b));
+	TEST_CHECK(pinPage(b, &h, 1));
+	ASSERT_EQUALS_INT(0, ((int *)h.data)[1], "the dropped change was not written");
+	ASSERT_EQUALS_INT(0, getNumWriteIO(b), "dropped pages are not written back");
+	TEST_CHECK(unpinPage(b, &h));
+
+	// the frames of dropped pages are filled before pages of the first file are evicted
+	int readsA = getNumReadIO(a);
+	for (i = 0; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(a, &h, i));
+		TEST_CHECK(unpinPage(a, &h));
+	}
+	contents = getFrameContents(a);
+	for (i = 0, n = 0; i < 6; i++)
+		n += contents[i] != NO_PAGE;
+	ASSERT_TRUE(n >= 5, "the first file's pages fill the free frames");
+	ASSERT_TRUE(getNumReadIO(a) - readsA <= 8, "each page read at most once");
+	free(contents);
+
+	// a file of another page size cannot share the frames
+	TEST_CHECK(createPageFileWithPageSize("test_buffer_pagefile3.bin", 2 * PAGE_SIZE));
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, attachBufferPool(c, pool, "test_buffer_pagefile3.bin", SM_OPEN_DEFAULT), "page size differs");
+	TEST_CHECK(destroyPageFile("test_buffer_pagefile3.bin"));
+
+	// detaching the first file writes back its dirty page and leaves only the second file's pages
+	TEST_CHECK(pinPage(a, &h, 5));
+	((int *)h.data)[1] = 105;
+	TEST_CHECK(markDirty(a, &h));
+	TEST_CHECK(unpinPage(a, &h));
+	TEST_CHECK(shutdownBufferPool(a));
+	contents = getFrameContents(pool);
+	for (i = 0, n = 0; i < 6; i++)
+		n += contents[i] != NO_PAGE;
+	free(contents);
+	contents = getFrameContents(b);
+	for (i = 0; i < 6; i++)
+		n -= contents[i] != NO_PAGE;
+	ASSERT_EQUALS_INT(0, n, "no page of the detached file");
+	free(contents);
+	TEST_CHECK(pinPage(b, &h, 7));
+	ASSERT_EQUALS_INT(1007, *(int *)h.data, "the second file is still attached");
+	TEST_CHECK(unpinPage(b, &h));
+
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	TEST_CHECK(readBlock(0, &fh, page));
+	ASSERT_EQUALS_INT(100, ((int *)page)[1], "flushed page on disk");
+	TEST_CHECK(readBlock(5, &fh, page));
+	ASSERT_EQUALS_INT(105, ((int *)page)[1], "detaching writes back");
+	TEST_CHECK(closePageFile(&fh));
+
+	TEST_CHECK(shutdownBufferPool(b));
+	TEST_CHECK(shutdownBufferPool(pool));
+	TEST_CHECK(destroyPageFile(TESTPF));
+	TEST_CHECK(destroyPageFile(TESTPF2));
+
+	free(page);
+	free(pool);
+	free(a);
+	free(b);
+	free(c);
+
+	TEST_DONE();
+}
+
+/* count the frames of a pool that hold a page */
+static int residentPages(BM_BufferPool *bm)
+{
+	PageNumber *contents = getFrameContents(bm);
+	int n = 0;
+
+	for (int i = 0; i < bm->numPages; i++)
+		n += contents[i] != NO_PAGE;
+	free(contents);
+	return n;
+}
+
+typedef struct Resizer
+{
+	BM_BufferPool *bm;
+	int stop;
+	bool ok;
+} Resizer;
+
+/* move the pool between sizes until stopped; every size leaves a frame for each worker */
+static void *resizer(void *arg)
+{
+	Resizer *r = (Resizer *)arg;
+	int sizes[] = {40, 12, 24, 16, 64, 12};
+
+	for (int i = 0; !__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE) && r->ok; i++)
+		r->ok = resizeBufferPool(r->bm, sizes[i % 6]) == RC_OK && r->bm->numPages == sizes[i % 6];
+	return NULL;
+}
+
+/* resizeBufferPool grows a pool that keeps its pages, and shrinks one with pinned and dirty pages in the frames it
+   gives up: those are written back and dropped once unpinned, while the pool is in use */
+void testResizeBufferPool(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL(), *view = MAKE_POOL();
+	BM_PageHandle h, pinned;
+	int i, reads, increments, total = 0;
+
+	testName = "resize buffer pool";
+	createTestFile(64);
+
+	// growing keeps the resident pages, and the new frames take the next pages without evictions
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategy, NULL));
+	for (i = 0; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	TEST_CHECK(resizeBufferPool(bm, 16));
+	ASSERT_EQUALS_INT(16, bm->numPages, "pool grown");
+	ASSERT_EQUALS_INT(8, residentPages(bm), "resident pages kept");
+	ASSERT_TRUE(framesResident(bm), "resident pages are found without I/O");
+	for (i = 8; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		ASSERT_EQUALS_INT(i, *(int *)h.data, "page read into a new frame");
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(16, residentPages(bm), "new frames filled");
+	ASSERT_EQUALS_INT(16, getNumReadIO(bm), "every page read once");
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(16, getNumReadIO(bm), "nothing evicted");
+
+	// shrinking writes back and drops the unpinned pages past the new size; a pinned one stays usable until unpinned
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		((int *)h.data)[1] = 100 + i;
+		TEST_CHECK(markDirty(bm, &h));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &pinned, i));
+		if (i < 15)
+			TEST_CHECK(unpinPage(bm, &pinned));
+	}
+	TEST_CHECK(resizeBufferPool(bm, 4));
+	ASSERT_EQUALS_INT(4, bm->numPages, "pool shrunk");
+	ASSERT_EQUALS_INT(4, residentPages(bm), "the remaining frames keep their pages");
+	reads = getNumReadIO(bm);
+	TEST_CHECK(pinPage(bm, &h, 15));
+	ASSERT_EQUALS_INT(115, ((int *)h.data)[1], "the pinned page is still in the pool");
+	TEST_CHECK(unpinPage(bm, &h));
+	ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "found without I/O");
+	ASSERT_EQUALS_INT(RC_PINNED_PAGES_IN_BUFFER, shutdownBufferPool(bm), "the retiring frame's pin keeps the pool up");
+	TEST_CHECK(unpinPage(bm, &pinned));
+	TEST_CHECK(forceFlushPool(bm));
+	ASSERT_EQUALS_INT(16, getNumWriteIO(bm), "every dirty page written once");
+	TEST_CHECK(pinPage(bm, &h, 15));
+	ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "the unpinned page left the pool");
+	ASSERT_EQUALS_INT(115, ((int *)h.data)[1], "and was written back");
+	TEST_CHECK(unpinPage(bm, &h));
+
+	// the pool grows back over the frames it retired
+	TEST_CHECK(resizeBufferPool(bm, 12));
+	reads = getNumReadIO(bm);
+	for (i = 20; i < 28; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(12, residentPages(bm), "retired frames reused");
+	ASSERT_TRUE(framesResident(bm), "resident pages are found without I/O");
+	ASSERT_EQUALS_INT(reads + 8, getNumReadIO(bm), "each new page read once");
+
+	// sizes out of range are refused
+	ASSERT_ERROR(resizeBufferPool(bm, 0), "empty pool");
+	ASSERT_ERROR(resizeBufferPool(bm, BM_MAX_POOL_PAGES + 1), "more frames than reserved");
+	ASSERT_EQUALS_INT(12, bm->numPages, "size unchanged");
+
+	// threads pin and dirty pages while the pool is resized under them, and lose no update
+	Resizer r = {bm, 0, true};
+	pthread_t thread;
+	pthread_create(&thread, NULL, resizer, &r);
+	increments = runConcurrentWorkers(bm, 64);
+	__atomic_store_n(&r.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(thread, NULL);
+	ASSERT_TRUE(r.ok, "every resize succeeded");
+	ASSERT_TRUE(increments > 0, "threads saw the right pages");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)malloc(PAGE_SIZE);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 0; i < 64; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, page));
+		total += ((int *)page)[1] - (i < 16 ? 100 + i : 0);
+	}
+	ASSERT_EQUALS_INT(increments, total, "no increment lost");
+	TEST_CHECK(closePageFile(&fh));
+
+	// a partitioned pool spreads the new size over its sub-pools
+	TEST_CHECK(initBufferPoolPartitioned(bm, TESTPF, 16, strategy, NULL, SM_OPEN_DEFAULT, 4));
+	ASSERT_ERROR(resizeBufferPool(bm, 3), "fewer frames than sub-pools");
+	TEST_CHECK(resizeBufferPool(bm, 66));
+	ASSERT_EQUALS_INT(66, bm->numPages, "partitioned pool grown");
+	for (i = 0; i < 64; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(64, residentPages(bm), "every page in one frame");
+	ASSERT_TRUE(framesResident(bm), "resident pages are found without I/O");
+	TEST_CHECK(resizeBufferPool(bm, 8));
+	ASSERT_EQUALS_INT(8, bm->numPages, "partitioned pool shrunk");
+	ASSERT_EQUALS_INT(8, residentPages(bm), "each sub-pool keeps its remaining pages");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// a view is resized through its shared pool
+	TEST_CHECK(initSharedBufferPool(bm, 4, strategy, NULL));
+	TEST_CHECK(attachBufferPool(view, bm, TESTPF, SM_OPEN_DEFAULT));
+	ASSERT_ERROR(resizeBufferPool(view, 8), "a view has no frames of its own");
+	TEST_CHECK(resizeBufferPool(bm, 8));
+	for (i = 0; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(view, &h, i));
+		TEST_CHECK(unpinPage(view, &h));
+	}
+	ASSERT_EQUALS_INT(8, residentPages(view), "the view fills the shared pool's new frames");
+	TEST_CHECK(shutdownBufferPool(view));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+	free(view);
+
+	TEST_DONE();
+}
+
+#define WARM_FILE TESTPF ".warm"
+
+/* pin the pages of the warm restart tests, some of them more than once */
+static void warmAccesses(BM_BufferPool *bm)
+{
+	int pages[] = {20, 3, 17, 9, 5, 30, 12, 1, 3, 9, 3, 20, 3};
+	BM_PageHandle h;
+
+	for (int i = 0; i < 13; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, pages[i]));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+}
+
+/* wait until the prefetcher has read n pages */
+static void waitForPrefetches(BM_BufferPool *bm, int n)
+{
+	while (getNumPrefetchReads(bm) < n)
+		usleep(1000);
+}
+
+/* record the pages of a cold pool after the accesses */
+static void warmRecord(BM_BufferPool *bm, ReplacementStrategy strategy)
+{
+	remove(WARM_FILE);
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 8, strategy, NULL, BM_OPEN_WARM_RESTART));
+	warmAccesses(bm);
+	TEST_CHECK(shutdownBufferPool(bm));
+}
+
+/* pin pages not in the pool, which evict some, and return the pool's pages sorted */
+static PageNumber *warmEvictions(BM_BufferPool *bm)
+{
+	PageNumber *contents;
+	BM_PageHandle h;
+	int i, j;
+
+	for (i = 25; i < 28; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	contents = getFrameContents(bm);
+	for (i = 1; i < bm->numPages; i++)
+		for (j = i; j > 0 && contents[j - 1] > contents[j]; j--)
+		{
+			PageNumber t = contents[j];
+			contents[j] = contents[j - 1];
+			contents[j - 1] = t;
+		}
+	return contents;
+}
+
+/* a pool opened with BM_OPEN_WARM_RESTART records its pages at shutdown, and the next one reads them back before
+   they are pinned and gives up the same pages as a pool that saw the accesses itself */
+void testWarmRestart(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL(), *view = MAKE_POOL();
+	BM_PageHandle h;
+	PageNumber *warm, *cold;
+	BM_WarmHeader header;
+	int residents[] = {1, 3, 5, 9, 12, 17, 20, 30};
+	int i;
+	FILE *file;
+
+	testName = "warm restart";
+	createTestFile(32);
+	remove(WARM_FILE);
+
+	// a pool without the flag records nothing, the first one with it starts cold
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategy, NULL));
+	warmAccesses(bm);
+	TEST_CHECK(shutdownBufferPool(bm));
+	file = fopen(WARM_FILE, "rb");
+	ASSERT_TRUE(file == NULL, "no warm restart file");
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 8, strategy, NULL, BM_OPEN_WARM_RESTART));
+	ASSERT_EQUALS_INT(0, getNumReadIO(bm), "nothing preloaded");
+	warmAccesses(bm);
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	file = fopen(WARM_FILE, "rb");
+	ASSERT_TRUE(file != NULL && fread(&header, sizeof(header), 1, file) == 1, "warm restart file written");
+	fclose(file);
+	ASSERT_EQUALS_INT(BM_WARM_MAGIC, header.magic, "warm restart file");
+	ASSERT_EQUALS_INT(8, header.numPages, "every resident page recorded");
+
+	// the restarted pool reads the pages without a pin, and has them when they are pinned
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 8, strategy, NULL, BM_OPEN_WARM_RESTART));
+	for (i = 0; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, residents[i]));
+		ASSERT_EQUALS_INT(residents[i], *(int *)h.data, "preloaded page");
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(8, getNumPrefetchReads(bm), "pages preloaded");
+	ASSERT_EQUALS_INT(8, getNumReadIO(bm), "no page read on demand");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// it evicts what the pool that saw the accesses would; ARC, 2Q and LRU-K get back only the order of the pages
+	warmRecord(bm, strategy);
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 8, strategy, NULL, BM_OPEN_WARM_RESTART));
+	waitForPrefetches(bm, 8);
+	warm = warmEvictions(bm);
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategy, NULL));
+	warmAccesses(bm);
+	cold = warmEvictions(bm);
+	TEST_CHECK(shutdownBufferPool(bm));
+	if (strategy != RS_ARC && strategy != RS_2Q && strategy != RS_LRU_K)
+		for (i = 0; i < 8; i++)
+			ASSERT_EQUALS_INT(cold[i], warm[i], "same pages evicted");
+	free(warm);
+	free(cold);
+
+	// a smaller pool, here of another strategy, preloads the pages recorded last, the most recently referenced
+	warmRecord(bm, strategy);
+	BM_WarmPage recorded[8];
+	file = fopen(WARM_FILE, "rb");
+	ASSERT_TRUE(fread(&header, sizeof(header), 1, file) == 1 && fread(recorded, sizeof(BM_WarmPage), 8, file) == 8, "pages recorded");
+	fclose(file);
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 3, strategy == RS_FIFO ? RS_LRU : RS_FIFO, NULL, BM_OPEN_WARM_RESTART));
+	waitForPrefetches(bm, 3);
+	for (i = 5; i < 8; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, recorded[i].pageNum));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(3, getNumPrefetchReads(bm), "three pages preloaded");
+	ASSERT_EQUALS_INT(3, getNumReadIO(bm), "the last three recorded");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// a partitioned pool records the pages of all sub-pools, and each gets its own back
+	remove(WARM_FILE);
+	TEST_CHECK(initBufferPoolPartitioned(bm, TESTPF, 24, strategy, NULL, BM_OPEN_WARM_RESTART, 4));
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(initBufferPoolPartitioned(bm, TESTPF, 24, strategy, NULL, BM_OPEN_WARM_RESTART, 4));
+	for (i = 0; i < 16; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(16, getNumPrefetchReads(bm), "pages preloaded into the sub-pools");
+	ASSERT_EQUALS_INT(16, getNumReadIO(bm), "no page read on demand");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// a file that is not whole is ignored
+	file = fopen(WARM_FILE, "r+b");
+	header.numPages = 1000;
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 8, strategy, NULL, BM_OPEN_WARM_RESTART));
+	ASSERT_EQUALS_INT(0, getNumReadIO(bm), "cold start");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// the files of a shared pool are not recorded
+	TEST_CHECK(initSharedBufferPool(bm, 4, strategy, NULL));
+	ASSERT_ERROR(attachBufferPool(view, bm, TESTPF, BM_OPEN_WARM_RESTART), "warm restart of an attached file");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// dropping the warm state of the destroyed page file removes its warm restart file, so a new file of the same
+	// name starts cold
+	TEST_CHECK(destroyPageFile(TESTPF));
+	file = fopen(WARM_FILE, "rb");
+	ASSERT_TRUE(file != NULL, "the storage manager leaves the warm restart file to the buffer manager");
+	fclose(file);
+	TEST_CHECK(dropWarmState(TESTPF));
+	file = fopen(WARM_FILE, "rb");
+	ASSERT_TRUE(file == NULL, "warm restart file removed");
+
+	free(bm);
+	free(view);
+
+	TEST_DONE();
+}
+
+/* a page that fails verification on read is not pinned and does not stay in the pool, where a later write-back
+   would record a checksum of the damaged page */
+void testVerifiedReads(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h;
+	SM_FileHandle fh;
+	SM_PageHandle page = (SM_PageHandle)calloc(PAGE_SIZE, 1);
+	PageNumber *contents;
+	int *fixCounts;
+	int i, n;
+	RC rc;
+	FILE *file;
+
+	testName = "verified reads";
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_VERIFY));
+	for (i = 0; i < 8; i++)
+	{
+		*(int *)page = i;
+		TEST_CHECK(writeBlock(i, &fh, page));
+	}
+	TEST_CHECK(closePageFile(&fh));
+	file = fopen(TESTPF, "r+");
+	fseek(file, SM_HEADER_SIZE + 3L * PAGE_SIZE + 100, SEEK_SET);
+	fputc('#', file);
+	fclose(file);
+
+	// the miss fails and leaves its frame free
+	TEST_CHECK(initBufferPoolWithFlags(bm, TESTPF, 4, RS_LRU, NULL, SM_OPEN_VERIFY));
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, pinPage(bm, &h, 3), "damaged page not pinned");
+	for (i = 0; i < 8; i++)
+	{
+		if (i == 3 || i > 4)
+			continue;
+		TEST_CHECK(pinPage(bm, &h, i));
+		ASSERT_EQUALS_INT(i, *(int *)h.data, "other pages read");
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(4, residentPages(bm), "the freed frame was used again");
+
+	// a miss that evicted a page to read it frees the frame as well
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, pinPage(bm, &h, 3), "damaged page not pinned");
+	contents = getFrameContents(bm);
+	fixCounts = getFixCounts(bm);
+	for (i = 0, n = 0; i < 4; i++)
+	{
+		ASSERT_TRUE(contents[i] != 3, "damaged page not resident");
+		ASSERT_EQUALS_INT(0, fixCounts[i], "no frame left pinned");
+		n += contents[i] == NO_PAGE;
+	}
+	ASSERT_EQUALS_INT(1, n, "one frame free");
+	free(contents);
+	free(fixCounts);
+
+	// a failed read of the prefetcher is counted and reported by the next pinPageAsync
+	// (pinPageAsync starts a read, so its RC is taken once)
+	rc = pinPageAsync(bm, &h, 3);
+	ASSERT_EQUALS_INT(RC_PAGE_NOT_READY, rc, "read started");
+	while (getNumPrefetchErrors(bm) < 1)
+		usleep(1000);
+	rc = pinPageAsync(bm, &h, 3);
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, rc, "the read's error reported");
+	ASSERT_EQUALS_INT(0, getNumPrefetchReads(bm), "nothing prefetched");
+	rc = pinPageAsync(bm, &h, 3);
+	ASSERT_EQUALS_INT(RC_PAGE_NOT_READY, rc, "read again");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// the page is still damaged on disk, no checksum was written over it
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_VERIFY));
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, readBlock(3, &fh, page), "damage still detected");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(bm);
+
+	TEST_DONE();
+}
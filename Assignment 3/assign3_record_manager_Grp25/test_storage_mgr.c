@@ -0,0 +1,865 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "storage_mgr.h"
+#include "crc32c.h"
+#include "dberror.h"
+#include "dt.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_storage_pagefile.bin"
+#define TESTSEG1 TESTPF ".1"
+#define TESTSEG2 TESTPF ".2"
+
+/* prototypes for test functions */
+static void testMultiPageIO(void);
+static void testAsyncIO(SM_AsyncBackend backend);
+static void testMappedFile(void);
+static void testDirectIO(void);
+static void testFileGrowth(void);
+static void testLargeFile(void);
+static void testSegmentedFile(void);
+static void testChecksums(void);
+static void testReadahead(void);
+static void testPageSizes(void);
+
+/* main function running all tests */
+int main(void)
+{
+	testName = "";
+
+	initStorageManager();
+
+	testMultiPageIO();
+	testAsyncIO(SM_ASYNC_AUTO);
+	testAsyncIO(SM_ASYNC_THREADS);
+	testMappedFile();
+	testDirectIO();
+	testFileGrowth();
+	testLargeFile();
+	testSegmentedFile();
+	testChecksums();
+	testReadahead();
+	testPageSizes();
+
+	return 0;
+}
+
+/* fill a page with a byte pattern derived from its page number */
+static void fillPage(SM_PageHandle page, int pageNum)
+{
+	memset(page, 'a' + (pageNum % 26), PAGE_SIZE);
+	*(int *)page = pageNum;
+}
+
+/* check that a page holds the pattern written by fillPage */
+static bool checkPage(SM_PageHandle page, int pageNum)
+{
+	if (*(int *)page != pageNum)
+		return false;
+	for (int i = sizeof(int); i < PAGE_SIZE; i++)
+		if (page[i] != 'a' + (pageNum % 26))
+			return false;
+	return true;
+}
+
+/* write and read runs of pages with readBlocks/writeBlocks and their iovec variants */
+void testMultiPageIO(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle pages[8];
+	struct iovec iov[2];
+	char *extent;
+	int i;
+
+	testName = "test multi-page read and write";
+
+	for (i = 0; i < 8; i++)
+		pages[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+	extent = (char *)malloc(6 * PAGE_SIZE);
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+
+	// write pages 1..8 in one call; the file grows to 9 pages
+	for (i = 0; i < 8; i++)
+		fillPage(pages[i], i + 1);
+	TEST_CHECK(writeBlocks(1, 8, &fh, pages));
+	ASSERT_EQUALS_INT(9, fh.totalNumPages, "writeBlocks grows the file");
+	ASSERT_EQUALS_INT(8, getBlockPos(&fh), "position is on the last page written");
+
+	// single page reads see what the vectored write stored
+	TEST_CHECK(readBlock(5, &fh, pages[0]));
+	ASSERT_TRUE(checkPage(pages[0], 5), "page 5 written by writeBlocks");
+
+	// read the run back into separate frames
+	for (i = 0; i < 8; i++)
+		memset(pages[i], 0, PAGE_SIZE);
+	TEST_CHECK(readBlocks(1, 8, &fh, pages));
+	for (i = 0; i < 8; i++)
+		ASSERT_TRUE(checkPage(pages[i], i + 1), "readBlocks returns the pages in order");
+
+	// scatter pages 2..7 into one contiguous extent and a separate page
+	iov[0].iov_base = extent;
+	iov[0].iov_len = 5 * PAGE_SIZE;
+	iov[1].iov_base = pages[0];
+	iov[1].iov_len = PAGE_SIZE;
+	TEST_CHECK(readBlocksv(2, iov, 2, &fh));
+	for (i = 0; i < 5; i++)
+		ASSERT_TRUE(checkPage(extent + i * PAGE_SIZE, i + 2), "extent holds consecutive pages");
+	ASSERT_TRUE(checkPage(pages[0], 7), "last iovec entry holds page 7");
+
+	// gather an extent back to pages 10..15
+	iov[0].iov_base = extent;
+	iov[0].iov_len = 6 * PAGE_SIZE;
+	for (i = 0; i < 6; i++)
+		fillPage(extent + i * PAGE_SIZE, i + 10);
+	TEST_CHECK(writeBlocksv(10, iov, 1, &fh));
+	ASSERT_EQUALS_INT(16, fh.totalNumPages, "writeBlocksv grows the file");
+	TEST_CHECK(readBlock(12, &fh, pages[0]));
+	ASSERT_TRUE(checkPage(pages[0], 12), "page 12 written by writeBlocksv");
+	TEST_CHECK(syncPageFile(&fh));
+
+	// invalid requests
+	ASSERT_ERROR(readBlocks(10, 8, &fh, pages), "reading past the end of the file");
+	iov[0].iov_len = PAGE_SIZE / 2;
+	ASSERT_ERROR(readBlocksv(0, iov, 1, &fh), "iovec entries must be whole pages");
+
+	TEST_CHECK(closePageFile(&fh));
+	ASSERT_ERROR(syncPageFile(&fh), "syncing a closed handle");
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	for (i = 0; i < 8; i++)
+		free(pages[i]);
+	free(extent);
+
+	TEST_DONE();
+}
+
+/* queue many page writes and reads, submit them together and reap the completions */
+void testAsyncIO(SM_AsyncBackend backend)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue *queue;
+	SM_AsyncCompletion done[16];
+	SM_PageHandle pages[16];
+	bool seen[16];
+	int i, n, reaped;
+
+	testName = backend == SM_ASYNC_THREADS ? "test async page I/O (threads)" : "test async page I/O";
+
+	for (i = 0; i < 16; i++)
+		pages[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	TEST_CHECK(initAsyncQueue(&queue, 16, backend));
+	if (backend == SM_ASYNC_THREADS)
+		ASSERT_TRUE(getAsyncBackend(queue) == SM_ASYNC_THREADS, "thread pool backend selected");
+
+	// write 16 pages at queue depth 16
+	for (i = 0; i < 16; i++)
+	{
+		fillPage(pages[i], i);
+		TEST_CHECK(queueWriteBlock(queue, i, &fh, pages[i], pages[i]));
+	}
+	ASSERT_EQUALS_INT(RC_ASYNC_QUEUE_FULL, queueWriteBlock(queue, 16, &fh, pages[0], NULL), "queue holds at most depth requests");
+	TEST_CHECK(submitAsyncQueue(queue));
+
+	for (reaped = 0; reaped < 16; reaped += n)
+	{
+		n = reapCompletions(queue, done, 16, 1);
+		ASSERT_TRUE(n > 0, "completions arrive");
+		for (i = 0; i < n; i++)
+		{
+			TEST_CHECK(done[i].rc);
+			ASSERT_TRUE(done[i].userData == done[i].memPage, "user data is handed back");
+		}
+	}
+	ASSERT_EQUALS_INT(0, getAsyncInFlight(queue), "all writes reaped");
+	ASSERT_EQUALS_INT(16, fh.totalNumPages, "async writes grow the file");
+
+	// read them back in reverse order and match completions to pages
+	for (i = 0; i < 16; i++)
+	{
+		memset(pages[i], 0, PAGE_SIZE);
+		seen[i] = false;
+		TEST_CHECK(queueReadBlock(queue, 15 - i, &fh, pages[15 - i], NULL));
+	}
+	TEST_CHECK(submitAsyncQueue(queue));
+	n = reapCompletions(queue, done, 16, 16);
+	ASSERT_EQUALS_INT(16, n, "waiting for all reads returns all of them");
+	for (i = 0; i < n; i++)
+	{
+		TEST_CHECK(done[i].rc);
+		ASSERT_TRUE(done[i].op == SM_ASYNC_READ, "completion of a read");
+		ASSERT_TRUE(checkPage(done[i].memPage, done[i].pageNum), "async read returns the written page");
+		seen[done[i].pageNum] = true;
+	}
+	for (i = 0; i < 16; i++)
+		ASSERT_TRUE(seen[i], "every page completed once");
+
+	// reading past the end of the file completes with an error
+	TEST_CHECK(queueReadBlock(queue, 100, &fh, pages[0], NULL));
+	TEST_CHECK(submitAsyncQueue(queue));
+	n = reapCompletions(queue, done, 1, 1);
+	ASSERT_EQUALS_INT(1, n, "one completion");
+	ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, done[0].rc, "read past the end of the file fails");
+
+	TEST_CHECK(shutdownAsyncQueue(queue));
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	for (i = 0; i < 16; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+/* serve pages from a shared mapping and grow it with appendEmptyBlock, ensureCapacity and writes past the end */
+void testMappedFile(void)
+{
+	SM_FileHandle fh, plain;
+	SM_PageHandle page, view;
+	SM_PageHandle pages[4];
+	int i;
+
+	testName = "test memory-mapped page file";
+
+	page = (SM_PageHandle)malloc(PAGE_SIZE);
+	for (i = 0; i < 4; i++)
+		pages[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_MMAP));
+	ASSERT_EQUALS_INT(1, fh.totalNumPages, "new file has one page");
+
+	// the first page of a new file is zeros, also through a view
+	TEST_CHECK(mapBlock(0, &fh, &view));
+	for (i = 0; i < PAGE_SIZE; i++)
+		if (view[i] != 0)
+			break;
+	ASSERT_EQUALS_INT(PAGE_SIZE, i, "view of the empty first page");
+
+	// writes grow the mapping
+	TEST_CHECK(appendEmptyBlock(&fh));
+	ASSERT_EQUALS_INT(2, fh.totalNumPages, "appendEmptyBlock grows the mapping");
+	TEST_CHECK(ensureCapacity(6, &fh));
+	ASSERT_EQUALS_INT(6, fh.totalNumPages, "ensureCapacity grows the mapping");
+	for (i = 0; i < 4; i++)
+		fillPage(pages[i], i + 8);
+	TEST_CHECK(writeBlocks(8, 4, &fh, pages));
+	ASSERT_EQUALS_INT(12, fh.totalNumPages, "writeBlocks past the end grows the mapping");
+	fillPage(page, 3);
+	TEST_CHECK(writeBlock(3, &fh, page));
+	TEST_CHECK(syncPageFile(&fh));
+
+	// copies and views see the same data
+	memset(page, 0, PAGE_SIZE);
+	TEST_CHECK(readBlock(3, &fh, page));
+	ASSERT_TRUE(checkPage(page, 3), "readBlock copies from the mapping");
+	TEST_CHECK(mapBlock(10, &fh, &view));
+	ASSERT_TRUE(checkPage(view, 10), "mapBlock returns a view of the page");
+	ASSERT_EQUALS_INT(10, getBlockPos(&fh), "mapBlock moves the position");
+	ASSERT_ERROR(mapBlock(12, &fh, &view), "view past the end of the file");
+
+	// the mapping is shared, so a plain handle sees the pages without a flush
+	TEST_CHECK(openPageFile(TESTPF, &plain));
+	ASSERT_EQUALS_INT(12, plain.totalNumPages, "mapped file grew on disk");
+	TEST_CHECK(readBlock(9, &plain, page));
+	ASSERT_TRUE(checkPage(page, 9), "pread sees pages stored through the mapping");
+	ASSERT_ERROR(mapBlock(0, &plain, &view), "views need SM_OPEN_MMAP");
+
+	// and the mapping follows growth done through the plain handle
+	fillPage(page, 14);
+	TEST_CHECK(writeBlock(14, &plain, page));
+	TEST_CHECK(mapBlock(14, &fh, &view));
+	ASSERT_TRUE(checkPage(view, 14), "mapping grows to pages written by another handle");
+	TEST_CHECK(closePageFile(&plain));
+
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	for (i = 0; i < 4; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+/* O_DIRECT page I/O with aligned buffers and, through the scratch page, unaligned ones */
+void testDirectIO(void)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue *queue;
+	SM_AsyncCompletion done[1];
+	SM_PageHandle aligned, unaligned, pages[3];
+	char *raw;
+	int i;
+
+	testName = "test O_DIRECT page file";
+
+	ASSERT_TRUE(posix_memalign((void **)&aligned, PAGE_SIZE, PAGE_SIZE) == 0, "aligned page");
+	raw = (char *)malloc(PAGE_SIZE + 1);
+	unaligned = raw + 1;
+	for (i = 0; i < 3; i++)
+		pages[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	// a mapped file always goes through the page cache
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_MMAP | SM_OPEN_DIRECT));
+	ASSERT_EQUALS_INT(SM_OPEN_MMAP, fh.openFlags, "O_DIRECT is dropped for mapped files");
+	TEST_CHECK(closePageFile(&fh));
+
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_DIRECT));
+	if (!(fh.openFlags & SM_OPEN_DIRECT))
+		printf("file system does not support O_DIRECT, testing the buffered fallback\n");
+
+	// aligned and unaligned buffers both reach the file
+	fillPage(aligned, 1);
+	TEST_CHECK(writeBlock(1, &fh, aligned));
+	fillPage(unaligned, 2);
+	TEST_CHECK(writeBlock(2, &fh, unaligned));
+	TEST_CHECK(appendEmptyBlock(&fh));
+	ASSERT_EQUALS_INT(4, fh.totalNumPages, "file grows to four pages");
+
+	TEST_CHECK(readBlock(2, &fh, aligned));
+	ASSERT_TRUE(checkPage(aligned, 2), "aligned read of a page written from an unaligned buffer");
+	TEST_CHECK(readBlock(1, &fh, unaligned));
+	ASSERT_TRUE(checkPage(unaligned, 1), "unaligned read of a page written from an aligned buffer");
+
+	// vectored I/O with malloc buffers falls back to one page at a time
+	for (i = 0; i < 3; i++)
+		fillPage(pages[i], i + 4);
+	TEST_CHECK(writeBlocks(4, 3, &fh, pages));
+	for (i = 0; i < 3; i++)
+		memset(pages[i], 0, PAGE_SIZE);
+	TEST_CHECK(readBlocks(4, 3, &fh, pages));
+	for (i = 0; i < 3; i++)
+		ASSERT_TRUE(checkPage(pages[i], i + 4), "readBlocks with unaligned buffers");
+
+	// asynchronous requests need aligned buffers
+	TEST_CHECK(initAsyncQueue(&queue, 1, SM_ASYNC_AUTO));
+	if (fh.openFlags & SM_OPEN_DIRECT)
+		ASSERT_EQUALS_INT(RC_UNALIGNED_BUFFER, queueReadBlock(queue, 1, &fh, unaligned, NULL), "async O_DIRECT read into an unaligned buffer");
+	memset(aligned, 0, PAGE_SIZE);
+	TEST_CHECK(queueReadBlock(queue, 5, &fh, aligned, NULL));
+	TEST_CHECK(submitAsyncQueue(queue));
+	ASSERT_EQUALS_INT(1, reapCompletions(queue, done, 1, 1), "one completion");
+	TEST_CHECK(done[0].rc);
+	ASSERT_TRUE(checkPage(aligned, 5), "async O_DIRECT read");
+	TEST_CHECK(shutdownAsyncQueue(queue));
+
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(aligned);
+	free(raw);
+	for (i = 0; i < 3; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+/* grow files with ensureCapacity and appendEmptyBlock under different growth policies */
+void testFileGrowth(void)
+{
+	SM_FileHandle fh;
+	SM_GrowthPolicy policy;
+	SM_PageHandle page;
+	struct stat st;
+	int i;
+
+	testName = "test file growth";
+
+	page = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+
+	// one call grows the file by all missing pages, reserved space past the end does not count
+	TEST_CHECK(ensureCapacity(1000, &fh));
+	ASSERT_EQUALS_INT(1000, fh.totalNumPages, "ensureCapacity grows the file");
+	ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == SM_HEADER_SIZE + 1000 * PAGE_SIZE, "file size is exactly 1000 pages");
+	memset(page, 1, PAGE_SIZE);
+	TEST_CHECK(readBlock(999, &fh, page));
+	for (i = 0; i < PAGE_SIZE && page[i] == 0; i++)
+		;
+	ASSERT_EQUALS_INT(PAGE_SIZE, i, "new pages read as zeros");
+	TEST_CHECK(ensureCapacity(10, &fh));
+	ASSERT_EQUALS_INT(1000, fh.totalNumPages, "ensureCapacity never shrinks the file");
+
+	// appends without any reservation ahead
+	policy.chunkPages = 0;
+	policy.sizeDivisor = 0;
+	TEST_CHECK(setGrowthPolicy(&fh, policy));
+	for (i = 0; i < 3; i++)
+		TEST_CHECK(appendEmptyBlock(&fh));
+	ASSERT_EQUALS_INT(1003, fh.totalNumPages, "appendEmptyBlock adds one page");
+	policy.chunkPages = -1;
+	ASSERT_ERROR(setGrowthPolicy(&fh, policy), "negative growth chunk");
+	TEST_CHECK(closePageFile(&fh));
+
+	// the size seen after reopening is the size that was asked for
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	ASSERT_EQUALS_INT(1003, fh.totalNumPages, "reopened file keeps its page count");
+	TEST_CHECK(closePageFile(&fh));
+
+	// mapped files grow their mapping along with the file
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_MMAP));
+	TEST_CHECK(ensureCapacity(1100, &fh));
+	ASSERT_EQUALS_INT(1100, fh.totalNumPages, "ensureCapacity grows a mapped file");
+	TEST_CHECK(readBlock(1099, &fh, page));
+	TEST_CHECK(closePageFile(&fh));
+
+	TEST_CHECK(destroyPageFile(TESTPF));
+	free(page);
+
+	TEST_DONE();
+}
+
+/* pages past the 2 GB and 4 GB marks of a single (sparse) page file */
+void testLargeFile(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle page;
+	int far = (int)((5L * 1024 * 1024 * 1024) / PAGE_SIZE); // first page after 5 GB
+
+	testName = "test page offsets past 4 GB";
+
+	page = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+
+	fillPage(page, far);
+	TEST_CHECK(writeBlock(far, &fh, page));
+	ASSERT_EQUALS_INT(far + 1, fh.totalNumPages, "file grows past 5 GB");
+	memset(page, 0, PAGE_SIZE);
+	TEST_CHECK(readBlock(far, &fh, page));
+	ASSERT_TRUE(checkPage(page, far), "page past 5 GB reads back");
+	TEST_CHECK(readBlock(far - 1, &fh, page));
+	ASSERT_EQUALS_INT(0, *(int *)page, "hole before it reads as zeros");
+	TEST_CHECK(readFirstBlock(&fh, page));
+	ASSERT_EQUALS_INT(0, *(int *)page, "first page is not overwritten by a wrapped offset");
+
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	ASSERT_EQUALS_INT(far + 1, fh.totalNumPages, "page count of a file larger than 4 GB");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+
+	TEST_DONE();
+}
+
+/* a page file spread over several segment files */
+void testSegmentedFile(void)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue *queue;
+	SM_AsyncCompletion done[1];
+	SM_PageHandle page, pages[4], big;
+	struct stat st;
+	int seg = SM_SEGMENT_BYTES / PAGE_SIZE;
+	int i;
+
+	testName = "test segmented page file";
+
+	page = (SM_PageHandle)malloc(PAGE_SIZE);
+	for (i = 0; i < 4; i++)
+		pages[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_SEGMENTED | SM_OPEN_MMAP));
+	ASSERT_EQUALS_INT(SM_OPEN_SEGMENTED, fh.openFlags, "segmented files are not mapped");
+
+	// a page of the second segment goes to its own file
+	fillPage(page, seg + 5);
+	TEST_CHECK(writeBlock(seg + 5, &fh, page));
+	ASSERT_EQUALS_INT(seg + 6, fh.totalNumPages, "pages of earlier segments count as present");
+	ASSERT_TRUE(stat(TESTSEG1, &st) == 0 && st.st_size == 6 * PAGE_SIZE, "second segment holds six pages");
+	ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == SM_HEADER_SIZE + PAGE_SIZE, "first segment is untouched");
+	TEST_CHECK(readBlock(100, &fh, page));
+	ASSERT_EQUALS_INT(0, *(int *)page, "missing pages of the first segment read as zeros");
+
+	// a run across the segment boundary
+	for (i = 0; i < 4; i++)
+		fillPage(pages[i], seg - 2 + i);
+	TEST_CHECK(writeBlocks(seg - 2, 4, &fh, pages));
+	for (i = 0; i < 4; i++)
+		memset(pages[i], 0, PAGE_SIZE);
+	TEST_CHECK(readBlocks(seg - 2, 4, &fh, pages));
+	for (i = 0; i < 4; i++)
+		ASSERT_TRUE(checkPage(pages[i], seg - 2 + i), "run across segments reads back");
+	ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == SM_HEADER_SIZE + (off_t)seg * PAGE_SIZE, "first segment is full");
+
+	// the third segment is created by an async write
+	TEST_CHECK(initAsyncQueue(&queue, 1, SM_ASYNC_AUTO));
+	fillPage(page, 2 * seg);
+	TEST_CHECK(queueWriteBlock(queue, 2 * seg, &fh, page, NULL));
+	TEST_CHECK(submitAsyncQueue(queue));
+	ASSERT_EQUALS_INT(1, reapCompletions(queue, done, 1, 1), "one completion");
+	TEST_CHECK(done[0].rc);
+	TEST_CHECK(shutdownAsyncQueue(queue));
+	ASSERT_TRUE(stat(TESTSEG2, &st) == 0, "third segment exists");
+	TEST_CHECK(appendEmptyBlock(&fh));
+	ASSERT_EQUALS_INT(2 * seg + 2, fh.totalNumPages, "append to the last segment");
+	TEST_CHECK(closePageFile(&fh));
+
+	// reopening finds all segments
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_SEGMENTED));
+	ASSERT_EQUALS_INT(2 * seg + 2, fh.totalNumPages, "page count over all segments");
+	TEST_CHECK(readBlock(2 * seg, &fh, page));
+	ASSERT_TRUE(checkPage(page, 2 * seg), "page of the third segment");
+	TEST_CHECK(readBlock(seg + 5, &fh, page));
+	ASSERT_TRUE(checkPage(page, seg + 5), "page of the second segment");
+	TEST_CHECK(closePageFile(&fh));
+
+	// destroying the page file removes its segments
+	TEST_CHECK(destroyPageFile(TESTPF));
+	ASSERT_TRUE(stat(TESTSEG1, &st) != 0 && stat(TESTSEG2, &st) != 0, "segment files removed");
+
+	// segments of larger pages hold fewer of them, every segment stays SM_SEGMENT_BYTES
+	TEST_CHECK(createPageFileWithPageSize(TESTPF, SM_MAX_PAGE_SIZE));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_SEGMENTED));
+	big = (SM_PageHandle)calloc(1, SM_MAX_PAGE_SIZE);
+	TEST_CHECK(writeBlock(SM_SEGMENT_BYTES / SM_MAX_PAGE_SIZE, &fh, big));
+	ASSERT_TRUE(stat(TESTSEG1, &st) == 0 && st.st_size == SM_MAX_PAGE_SIZE, "first page of the second segment");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_SEGMENTED));
+	ASSERT_EQUALS_INT(SM_SEGMENT_BYTES / SM_MAX_PAGE_SIZE + 1, fh.totalNumPages, "page count of large pages");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+	free(big);
+
+	free(page);
+	for (i = 0; i < 4; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+/* flip one byte of a page behind the storage manager's back */
+static void corruptPage(int pageNum)
+{
+	FILE *file = fopen(TESTPF, "r+");
+	fseek(file, SM_HEADER_SIZE + (long)pageNum * PAGE_SIZE + 100, SEEK_SET);
+	fputc('#', file);
+	fclose(file);
+}
+
+/* CRC32C page checksums: recorded on write, verified on read or by the scrubber */
+void testChecksums(void)
+{
+	SM_FileHandle fh, plain;
+	SM_AsyncQueue *queue;
+	SM_AsyncCompletion done[1];
+	SM_PageHandle page, pages[4];
+	int bad[4], numBad, i;
+
+	testName = "test page checksums";
+
+	page = (SM_PageHandle)malloc(PAGE_SIZE);
+	for (i = 0; i < 4; i++)
+		pages[i] = (SM_PageHandle)malloc(PAGE_SIZE);
+
+	// the hardware and table driven versions agree, on the standard check value as well
+	ASSERT_TRUE(crc32c("123456789", 9) == 0xE3069283, "CRC-32C check value");
+	ASSERT_TRUE(crc32cPortable("123456789", 9) == 0xE3069283, "portable CRC-32C check value");
+	for (i = 0; i < PAGE_SIZE; i++)
+		page[i] = (char)(i * 7 + i / 13);
+	ASSERT_TRUE(crc32c(page, PAGE_SIZE) == crc32cPortable(page, PAGE_SIZE), "both versions agree on a page");
+	ASSERT_TRUE(crc32c(page + 3, 1001) == crc32cPortable(page + 3, 1001), "both versions agree on odd lengths");
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_VERIFY));
+	ASSERT_TRUE((fh.openFlags & SM_OPEN_CHECKSUM) != 0, "verifying implies keeping checksums");
+	for (i = 0; i < 4; i++)
+		fillPage(pages[i], i);
+	TEST_CHECK(writeBlocks(0, 4, &fh, pages));
+	TEST_CHECK(appendEmptyBlock(&fh));
+	TEST_CHECK(readBlocks(0, 4, &fh, pages));
+	TEST_CHECK(readBlock(4, &fh, page));
+
+	// a damaged page fails verification, the others still read
+	corruptPage(2);
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, readBlock(2, &fh, page), "corrupt page detected by readBlock");
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, readBlocks(0, 4, &fh, pages), "corrupt page detected by readBlocks");
+	TEST_CHECK(readBlock(3, &fh, page));
+
+	TEST_CHECK(initAsyncQueue(&queue, 1, SM_ASYNC_AUTO));
+	TEST_CHECK(queueReadBlock(queue, 2, &fh, page, NULL));
+	TEST_CHECK(submitAsyncQueue(queue));
+	ASSERT_EQUALS_INT(1, reapCompletions(queue, done, 1, 1), "one completion");
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, done[0].rc, "corrupt page detected by an async read");
+	TEST_CHECK(shutdownAsyncQueue(queue));
+
+	// without verification reads pass, but a plain handle still records checksums
+	TEST_CHECK(openPageFile(TESTPF, &plain));
+	ASSERT_TRUE((plain.openFlags & SM_OPEN_CHECKSUM) != 0, "an existing checksum file is kept up to date");
+	TEST_CHECK(readBlock(2, &plain, page));
+	ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, verifyPageChecksum(&plain, 2, page), "explicit verification");
+
+	// the scrubber finds the damaged page
+	TEST_CHECK(scrubPageFile(TESTPF, SM_OPEN_DEFAULT, bad, 4, &numBad));
+	ASSERT_EQUALS_INT(1, numBad, "one bad page");
+	ASSERT_EQUALS_INT(2, bad[0], "page 2 is bad");
+
+	// the entry a write clears until the page is stored is not checked: a write cut short leaves the page unverified
+	TEST_CHECK(clearPageChecksum(&plain, 2));
+	TEST_CHECK(verifyPageChecksum(&plain, 2, page));
+
+	// rewriting the page repairs it
+	fillPage(page, 2);
+	TEST_CHECK(writeBlock(2, &plain, page));
+	TEST_CHECK(closePageFile(&plain));
+	TEST_CHECK(readBlock(2, &fh, page));
+	TEST_CHECK(scrubPageFile(TESTPF, SM_OPEN_DEFAULT, bad, 4, &numBad));
+	ASSERT_EQUALS_INT(0, numBad, "no bad pages after the rewrite");
+	TEST_CHECK(closePageFile(&fh));
+
+	// a new page file starts without checksums
+	TEST_CHECK(createPageFile(TESTPF));
+	ASSERT_ERROR(scrubPageFile(TESTPF, SM_OPEN_DEFAULT, bad, 4, &numBad), "nothing to scrub");
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	for (i = 0; i < 4; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+/* sequential reads are served from the readahead window; writes and jumps are honoured */
+void testReadahead(void)
+{
+	SM_FileHandle fh;
+	SM_FileMgmt *mgmt;
+	SM_AsyncQueue *queue;
+	SM_AsyncCompletion done[1];
+	SM_PageHandle page, unaligned;
+	char *raw;
+	int seg = SM_SEGMENT_BYTES / PAGE_SIZE;
+	int i;
+
+	testName = "test sequential readahead";
+
+	page = (SM_PageHandle)malloc(PAGE_SIZE);
+	raw = (char *)malloc(PAGE_SIZE + 1);
+	unaligned = raw + 1;
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 0; i < 100; i++)
+	{
+		fillPage(page, i);
+		TEST_CHECK(writeBlock(i, &fh, page));
+	}
+
+	// readahead is asked for at open, a handle opened without it reads every page itself
+	for (i = 0; i < 10; i++)
+		TEST_CHECK(readBlock(i, &fh, page));
+	ASSERT_EQUALS_INT(0, ((SM_FileMgmt *)fh.mgmtInfo)->raCount, "no readahead by default");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_READAHEAD));
+	mgmt = (SM_FileMgmt *)fh.mgmtInfo;
+
+	// a scan grows the window up to the limit
+	TEST_CHECK(readFirstBlock(&fh, page));
+	ASSERT_EQUALS_INT(0, mgmt->raCount, "a single read stages nothing");
+	for (i = 1; i < 100; i++)
+	{
+		TEST_CHECK(readNextBlock(&fh, page));
+		ASSERT_TRUE(checkPage(page, i), "sequential read");
+	}
+	ASSERT_EQUALS_INT(SM_READAHEAD_MAX_PAGES, mgmt->raWindow, "window grew to the limit");
+	ASSERT_EQUALS_INT(99, getBlockPos(&fh), "position follows the reads");
+
+	// pages written while staged read back with their new contents
+	for (i = 10; i < 20; i++)
+		TEST_CHECK(readBlock(i, &fh, page));
+	ASSERT_TRUE(mgmt->raCount > 0 && mgmt->raStart <= 20 && mgmt->raStart + mgmt->raCount > 20, "page 20 is staged");
+	fillPage(page, 1020);
+	TEST_CHECK(writeBlock(20, &fh, page));
+	TEST_CHECK(readBlock(20, &fh, page));
+	ASSERT_TRUE(checkPage(page, 1020), "write through the handle drops the staged page");
+
+	TEST_CHECK(initAsyncQueue(&queue, 1, SM_ASYNC_AUTO));
+	for (i = 30; i < 40; i++)
+		TEST_CHECK(readBlock(i, &fh, page));
+	fillPage(page, 1041);
+	TEST_CHECK(queueWriteBlock(queue, 41, &fh, page, NULL));
+	TEST_CHECK(submitAsyncQueue(queue));
+	ASSERT_EQUALS_INT(1, reapCompletions(queue, done, 1, 1), "one completion");
+	TEST_CHECK(done[0].rc);
+	TEST_CHECK(shutdownAsyncQueue(queue));
+	TEST_CHECK(readBlock(41, &fh, page));
+	ASSERT_TRUE(checkPage(page, 1041), "async write drops the staged page");
+
+	// jumping around resets the window
+	TEST_CHECK(readBlock(70, &fh, page));
+	TEST_CHECK(readBlock(5, &fh, page));
+	ASSERT_TRUE(checkPage(page, 5), "backward jump");
+	ASSERT_EQUALS_INT(0, mgmt->raWindow, "no window after a jump");
+
+	// readahead can be turned off
+	ASSERT_ERROR(setReadahead(&fh, -1), "negative readahead");
+	TEST_CHECK(setReadahead(&fh, 0));
+	for (i = 0; i < 10; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, page));
+		ASSERT_TRUE(checkPage(page, i), "read without readahead");
+	}
+	ASSERT_EQUALS_INT(0, mgmt->raCount, "nothing staged without readahead");
+	TEST_CHECK(closePageFile(&fh));
+
+	// O_DIRECT handles stage into an aligned buffer, any caller buffer works
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_DIRECT | SM_OPEN_READAHEAD));
+	for (i = 50; i < 100; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, unaligned));
+		ASSERT_TRUE(checkPage(unaligned, i == 20 ? 1020 : i), "O_DIRECT sequential read");
+	}
+	ASSERT_TRUE(((SM_FileMgmt *)fh.mgmtInfo)->raCount > 0, "O_DIRECT reads are staged");
+	TEST_CHECK(closePageFile(&fh));
+
+	// the window stops at the end of a segment file
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, SM_OPEN_SEGMENTED | SM_OPEN_READAHEAD));
+	for (i = seg - 3; i < seg + 3; i++)
+	{
+		fillPage(page, i);
+		TEST_CHECK(writeBlock(i, &fh, page));
+	}
+	for (i = seg - 6; i < seg + 3; i++)
+		TEST_CHECK(readBlock(i, &fh, page));
+	ASSERT_TRUE(checkPage(page, seg + 2), "scan across the segment boundary");
+	TEST_CHECK(readBlock(seg - 1, &fh, page));
+	ASSERT_TRUE(checkPage(page, seg - 1), "last page of the first segment");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+	free(raw);
+
+	TEST_DONE();
+}
+
+/* fill a page of pageSize bytes with a pattern derived from its page number */
+static void fillSizedPage(SM_PageHandle page, int pageNum, int pageSize)
+{
+	memset(page, 'a' + (pageNum % 26), pageSize);
+	*(int *)page = pageNum;
+	*(int *)(page + pageSize - sizeof(int)) = pageNum;
+}
+
+static bool checkSizedPage(SM_PageHandle page, int pageNum, int pageSize)
+{
+	return *(int *)page == pageNum && *(int *)(page + pageSize - sizeof(int)) == pageNum &&
+		   page[pageSize / 2] == 'a' + (pageNum % 26);
+}
+
+/* page files with pages larger than PAGE_SIZE, in every open mode, and files without a header */
+void testPageSizes(void)
+{
+	static const int modes[] = {SM_OPEN_DEFAULT, SM_OPEN_MMAP, SM_OPEN_DIRECT, SM_OPEN_SEGMENTED | SM_OPEN_VERIFY};
+	SM_FileHandle fh;
+	SM_AsyncQueue *queue;
+	SM_AsyncCompletion done[1];
+	SM_PageHandle page, view;
+	struct stat st;
+	FILE *file;
+	int pageSize, m, i;
+
+	testName = "test page sizes";
+
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize(TESTPF, 1024), "pages smaller than PAGE_SIZE");
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize(TESTPF, 3 * PAGE_SIZE), "page size not a power of two");
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize(TESTPF, 2 * SM_MAX_PAGE_SIZE), "pages larger than SM_MAX_PAGE_SIZE");
+
+	posix_memalign((void **)&page, PAGE_SIZE, SM_MAX_PAGE_SIZE);
+	for (pageSize = 2 * PAGE_SIZE; pageSize <= SM_MAX_PAGE_SIZE; pageSize *= 8)
+	{
+		TEST_CHECK(createPageFileWithPageSize(TESTPF, pageSize));
+		ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == SM_HEADER_SIZE + pageSize, "header and one empty page");
+
+		for (m = 0; m < 4; m++)
+		{
+			TEST_CHECK(openPageFileWithFlags(TESTPF, &fh, modes[m]));
+			ASSERT_EQUALS_INT(pageSize, fh.pageSize, "page size read from the header");
+
+			// every mode writes a few pages and reads all of them back
+			for (i = 4 * m; i < 4 * m + 4; i++)
+			{
+				fillSizedPage(page, i, pageSize);
+				TEST_CHECK(writeBlock(i, &fh, page));
+			}
+			ASSERT_EQUALS_INT(4 * m + 4, fh.totalNumPages, "pages counted in the file's page size");
+			for (i = 0; i < 4 * m + 4; i++)
+			{
+				TEST_CHECK(readBlock(i, &fh, page));
+				ASSERT_TRUE(checkSizedPage(page, i, pageSize), "large page reads back");
+			}
+			if (modes[m] == SM_OPEN_MMAP)
+			{
+				TEST_CHECK(mapBlock(2, &fh, &view));
+				ASSERT_TRUE(checkSizedPage(view, 2, pageSize), "view of a large page");
+			}
+			TEST_CHECK(closePageFile(&fh));
+		}
+		ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == SM_HEADER_SIZE + 16 * (off_t)pageSize, "file holds 16 pages");
+
+		// whole runs and async requests move whole large pages
+		TEST_CHECK(openPageFile(TESTPF, &fh));
+		TEST_CHECK(appendEmptyBlock(&fh));
+		ASSERT_EQUALS_INT(17, fh.totalNumPages, "append a large page");
+		TEST_CHECK(initAsyncQueue(&queue, 1, SM_ASYNC_AUTO));
+		TEST_CHECK(queueReadBlock(queue, 13, &fh, page, NULL));
+		TEST_CHECK(submitAsyncQueue(queue));
+		ASSERT_EQUALS_INT(1, reapCompletions(queue, done, 1, 1), "one completion");
+		TEST_CHECK(done[0].rc);
+		ASSERT_TRUE(checkSizedPage(page, 13, pageSize), "async read of a large page");
+		TEST_CHECK(shutdownAsyncQueue(queue));
+		TEST_CHECK(closePageFile(&fh));
+	}
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	// a file without a header has PAGE_SIZE pages from offset 0
+	file = fopen(TESTPF, "w");
+	for (i = 0; i < 2; i++)
+	{
+		fillPage(page, i);
+		fwrite(page, 1, PAGE_SIZE, file);
+	}
+	fclose(file);
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "headerless file has the default page size");
+	ASSERT_EQUALS_INT(2, fh.totalNumPages, "headerless file holds two pages");
+	TEST_CHECK(readBlock(1, &fh, page));
+	ASSERT_TRUE(checkPage(page, 1), "page of a headerless file");
+	TEST_CHECK(closePageFile(&fh));
+
+	// a header with an impossible page size is refused
+	memset(page, 0, SM_HEADER_SIZE);
+	((int *)page)[0] = 0x31464750;
+	((int *)page)[1] = 1;
+	((int *)page)[2] = 5000;
+	file = fopen(TESTPF, "w");
+	fwrite(page, 1, SM_HEADER_SIZE, file);
+	fclose(file);
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, openPageFile(TESTPF, &fh), "bad page size in the header");
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(page);
+
+	TEST_DONE();
+}